@@ -0,0 +1,83 @@
+#ifndef CACHEPROGRAMAS_H
+#define CACHEPROGRAMAS_H
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+#include <glad/glad.h>
+
+// Criação dos programas de GPU com cache dos binários linkados. Depois do
+// primeiro link, o programa é lido com glGetProgramBinary() e gravado em
+// "<diretorio>/<nome>.programa"; nas execuções seguintes ele é carregado com
+// glProgramBinary(), sem compilar nem linkar o GLSL.
+//
+// A chave do cache é um hash do código dos dois shaders e das strings do
+// driver (fabricante, renderer e versões): um binário de outro código ou de
+// outro driver é ignorado. Um binário recusado pelo driver também é
+// ignorado, em silêncio; o programa é compilado e o arquivo regravado.
+//
+// glGetProgramBinary() é do OpenGL 4.1 (ou ARB_get_program_binary), acima do
+// 3.3 carregado pelo glad: as funções são buscadas com glfwGetProcAddress().
+// Sem elas, cria() só compila.
+//
+// Um programa também pode ser criado em etapas, sem parar o quadro:
+// inicia() dispara a compilação e o link, pronto() diz se o driver terminou
+// e termina() confere o resultado. Com GL_KHR_parallel_shader_compile o
+// driver compila em threads próprias e pronto() não bloqueia; sem a
+// extensão, o trabalho todo acontece na primeira consulta ao resultado.
+struct CriacaoPrograma
+{
+    std::string nome;
+    GLuint program_id;
+    GLuint vertex_shader_id, fragment_shader_id; // 0 se veio do cache
+    uint64_t chave;
+};
+
+class CacheProgramas
+{
+    public:
+        CacheProgramas();
+        virtual ~CacheProgramas();
+
+        // Precisa de um contexto OpenGL
+        void inicializa(const char* diretorio);
+        bool ativo() const;
+
+        // "nome" identifica o arquivo do cache e aparece nas mensagens de erro
+        GLuint cria(const char* nome, const std::string& fonte_vertex, const std::string& fonte_fragment);
+        // Lê o GLSL dos arquivos; termina o programa se algum não existir
+        GLuint criaDeArquivos(const char* nome, const char* arquivo_vertex, const char* arquivo_fragment);
+
+        CriacaoPrograma inicia(const char* nome, const std::string& fonte_vertex, const std::string& fonte_fragment);
+        bool pronto(const CriacaoPrograma& criacao) const;
+        // Imprime os erros e grava o binário no cache. Devolve false se a
+        // compilação ou o link falharam; o programa continua em
+        // criacao.program_id, para quem quiser apagá-lo.
+        bool termina(CriacaoPrograma* criacao);
+
+        unsigned int getCarregados() const;  // Vindos do cache
+        unsigned int getCompilados() const;
+
+    protected:
+
+    private:
+        std::string diretorio;
+        std::string driver;  // Fabricante, renderer e versões, parte da chave
+        bool usa_binarios;
+        bool compilacao_paralela; // GL_KHR_parallel_shader_compile
+        unsigned int carregados, compilados;
+
+        uint64_t chave(const std::string& fonte_vertex, const std::string& fonte_fragment) const;
+        std::string caminho(const char* nome) const;
+        GLuint carrega(const std::string& arquivo, uint64_t chave) const;
+        void salva(const std::string& arquivo, uint64_t chave, GLuint program_id) const;
+
+        CacheProgramas(const CacheProgramas&);
+        CacheProgramas& operator=(const CacheProgramas&);
+};
+
+extern CacheProgramas g_CacheProgramas;
+
+// Lê um arquivo GLSL inteiro; devolve false se ele não pode ser aberto
+bool LeArquivoShader(const char* arquivo, std::string* conteudo);
+
+#endif // CACHEPROGRAMAS_H
@@ -0,0 +1,71 @@
+#ifndef CARFLEET_H
+#define CARFLEET_H
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+#include <glm/mat4x4.hpp>
+#include "Pista.h"
+#include "Rigida.h"
+
+// Bits da entrada de cada carro da frota em um passo de CarFleet::step().
+enum EntradaFrota
+{
+    ENTRADA_ACELERAR = 1,
+    ENTRADA_RE       = 2,
+    ENTRADA_ESQUERDA = 4,
+    ENTRADA_DIREITA  = 8
+};
+
+// Frota de carros (fantasmas, adversários controlados por IA) guardada como
+// estrutura de arrays: cada grandeza fica em um vetor contíguo de floats, e
+// um único laço em step() atualiza todos os carros. Diferente de Carro, não
+// mantemos uma glm::mat4 por carro; a matriz "model" só é montada em
+// calculaMatrizes(), quando alguém vai desenhar a frota.
+class CarFleet
+{
+private:
+    std::vector<float> x;
+    std::vector<float> z;
+    std::vector<float> heading; // Ângulo no plano XZ: sentido = (sin, 0, cos)
+    std::vector<float> dir_x;   // sin(heading), atualizado junto com o ângulo
+    std::vector<float> dir_z;   // cos(heading)
+    std::vector<float> speed;   // Unidades por segundo
+    TransformacaoRigida base;   // Parte constante da matriz "model" de Carro, antes da escala
+    float escala;               // Escala do modelo de Carro
+    float altura;               // Coordenada Y da posição de Carro
+    unsigned int passos;
+
+    // Colisão com a pista, com as mesmas dimensões de Carro
+    const Pista* pista;
+    float meio_comprimento;
+    float meio_largura;
+
+    // Áreas de trabalho de step(), reaproveitadas entre passos para que o
+    // passo não aloque memória depois que a frota parou de crescer.
+    std::vector<float> cand_x, cand_z, cand_dx, cand_dz;
+    std::vector<uint8_t> colisao, colisao_giro;
+
+    void ressincronizaDirecoes();
+    void escreveMatriz(size_t i, glm::mat4* destino) const;
+
+public:
+    static const float VELOCIDADE_PADRAO; // Mesmo deslocamento de Carro::moveCarro a 30 passos/s
+    static const float TAXA_GIRO;         // Mesmo ângulo de Carro::turnLeft a 30 passos/s
+
+    CarFleet();
+    size_t adiciona(float px, float pz, float angulo, float velocidade = VELOCIDADE_PADRAO);
+    void limpa();
+    size_t tamanho() const;
+    void step(float dt, const uint8_t* inputs);
+    glm::mat4 matrizModelo(size_t i) const;
+    void calculaMatrizes(glm::mat4* destino) const;
+    void setPista(const Pista* pista);
+
+    const float* getX() const { return x.data(); }
+    const float* getZ() const { return z.data(); }
+    const float* getHeading() const { return heading.data(); }
+    const float* getSpeed() const { return speed.data(); }
+    const uint8_t* getColisoes() const { return colisao.data(); } // Bits de ResultadoColisao do último passo
+};
+
+#endif // CARFLEET_H
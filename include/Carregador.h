@@ -0,0 +1,125 @@
+#ifndef CARREGADOR_H
+#define CARREGADOR_H
+#include <cstddef>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <glad/glad.h>
+#include "CenaVirtual.h"
+#include "Malha.h"
+
+// Carregamento de texturas e malhas em segundo plano. O pedido devolve na
+// hora um objeto utilizável, com um substituto: a textura começa com um
+// pixel cinza e a malha com uma caixa cinza de lado 1 centrada na origem.
+// Threads de trabalho decodificam as imagens (stb_image) e abrem o cache da
+// malha ou convertem o OBJ; a thread do OpenGL envia os dados prontos em
+// blocos de tamanho fixo, dentro de um orçamento de tempo por quadro, e só
+// então troca o substituto pelo objeto real.
+//
+// Uma malha é reservada com MAXIMO_NIVEIS_OBJETO níveis, um VAO por nível,
+// todos com o substituto. Quando ela chega, os mesmos VAOs passam a apontar
+// para os buffers reais e o número de níveis é corrigido. Os VAOs não mudam:
+// os LoteInstancias inicializados com eles continuam valendo.
+//
+// Se um arquivo não pode ser lido, o erro é impresso e o substituto fica.
+class Carregador
+{
+    public:
+        Carregador();
+        virtual ~Carregador();
+
+        // Precisa de um contexto OpenGL. num_threads <= 0 usa um núcleo a
+        // menos que os disponíveis (pelo menos uma thread).
+        void inicializa(CenaVirtual* cena, int num_threads = 0);
+        // Espera as threads terminarem o que estão fazendo e descarta o resto
+        void encerra();
+
+        // A textura fica presa à unidade dada, com um sampler com mipmaps.
+        // Devolve a textura que ocupará a unidade quando chegar.
+        GLuint carregaTextura(const char* arquivo, GLuint unidade);
+        // Adiciona a malha na cena com o nome dado (os níveis simplificados
+        // como "nome#1", "nome#2", ...) e devolve o IdObjeto do nível 0. Usa o
+        // cache binário (ver ArquivoMalha) e o regrava se estiver velho. O
+        // nome precisa durar tanto quanto a cena (SceneObject::name).
+        IdObjeto carregaMalha(const char* arquivo_obj, const char* nome, bool recalcula_normais, FormatoVertice formato);
+
+        // Chamada uma vez por quadro, na thread do OpenGL. Envia pelo menos
+        // um bloco e para quando passa de orcamento_ms.
+        void envia(double orcamento_ms);
+
+        size_t pendentes() const; // Pedidos ainda não enviados à GPU
+
+    protected:
+
+    private:
+        enum TipoTarefa
+        {
+            TAREFA_TEXTURA,
+            TAREFA_MALHA
+        };
+
+        // Pedido, da fila das threads até o fim do envio. As threads de
+        // trabalho preenchem os dados de CPU; o resto é da thread do OpenGL.
+        struct Tarefa
+        {
+            TipoTarefa tipo;
+            std::string arquivo;
+            const char* nome; // Vai para SceneObject::name, que guarda só o ponteiro
+            std::chrono::steady_clock::time_point pedido;
+            bool ok;
+
+            // Textura
+            GLuint texture_id, unidade;
+            unsigned char* pixels;
+            int largura, altura;
+
+            // Malha: os vértices e índices apontam para o cache mapeado ou
+            // para a malha convertida do OBJ
+            bool recalcula_normais;
+            FormatoVertice formato;
+            IdObjeto ids[MAXIMO_NIVEIS_OBJETO];
+            ArquivoMalha cache;
+            Malha malha;
+            std::vector<VerticeCompacto> compactos;
+            const void* vertices;
+            const void* indices;
+            size_t bytes_vertices, bytes_indices, bytes_por_indice;
+            LimitesMalha limites;
+            std::vector<NivelMalha> niveis;
+
+            // Envio
+            GLuint VBO_id, EBO_id;
+            size_t enviados; // Bytes (ou, na textura, linhas) já enviados
+        };
+
+        CenaVirtual* cena;
+        std::vector<std::thread> threads;
+        mutable std::mutex mutex;
+        std::condition_variable condicao;
+        std::deque<Tarefa*> fila;     // Esperando uma thread de trabalho
+        std::deque<Tarefa*> prontos;  // Dados de CPU prontos, esperando o envio
+        std::deque<Tarefa*> enviando; // Só da thread do OpenGL
+        size_t em_andamento;          // Pedidos ainda não concluídos
+        bool encerrando;
+
+        GLuint textura_substituta_id;                // Pixel cinza das texturas ainda não carregadas
+        GLuint VBO_substituto_id, EBO_substituto_id; // Caixa das malhas ainda não carregadas
+
+        void trabalha();
+        void processa(Tarefa* tarefa);
+        bool enviaTextura(Tarefa* tarefa);
+        bool enviaMalha(Tarefa* tarefa);
+        void conclui(Tarefa* tarefa);
+        void criaSubstituto();
+
+        Carregador(const Carregador&);
+        Carregador& operator=(const Carregador&);
+};
+
+extern Carregador g_Carregador;
+
+#endif // CARREGADOR_H
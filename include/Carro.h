@@ -3,6 +3,8 @@
 #include <glm/mat4x4.hpp>
 #include <glm/vec4.hpp>
 #include <vector>
+#include "Pista.h"
+#include "Rigida.h"
 
 
 using namespace std;
@@ -10,21 +12,20 @@ using namespace std;
 class Carro
 {
 private:
-    glm::mat4 matrix;
+    // A matriz "model" é Rigida_Matriz(transformacao, escala): todo
+    // movimento do carro é rígido, só a escala do modelo não é
+    TransformacaoRigida transformacao;
+    float escala;
     float speed = 0.1f;
     float comprimento = 23.0f;
     float largura = 12.0f;
     double last_time;
     glm::vec4 ahead = glm::vec4(0.0,0.0,1.0,0.0);
     glm::vec4 position = glm::vec4(0.0,0.0,0.0,1.0);
+    const Pista* pista;
     bool testeColisao(glm::vec4 position, glm::vec4 sentido);
-    bool cruzouLimites(vector <glm::vec4> pontos);
-    bool trapaceou(vector <glm::vec4> pontos);
-    bool algumAntesDaChegada(vector <glm::vec4> pontos);
-    bool algumDepoisDaChegada(vector <glm::vec4> pontos);
-    bool algumAntesDaSaida(vector <glm::vec4> pontos);
-    bool algumDepoisDaSaida(vector <glm::vec4> pontos);
-    bool estaoNaRetaFinal(vector <glm::vec4> pontos);
+    bool deslizaNaParede(glm::vec4 deslocamento, glm::vec4 sentido);
+    void gira(float c, float s);
 
 public:
     bool Naoinicializado = true;
@@ -32,12 +33,20 @@ public:
     virtual ~Carro();
     void moveCarro(double tempoagora);
     bool cruzouChegada();
+    bool cruzouCheckpoint(size_t i);
+    void setPista(const Pista* pista);
+    void posiciona(float x, float z, float angulo);
     glm::mat4 getMatrix();
+    const TransformacaoRigida& getTransformacao();
+    float getEscala();
     void turnRight();
     void turnLeft();
     void moveCarBack();
     glm::vec4 getCameraPosition();
     glm::vec4 getCameraView();
+    glm::vec4 getPosition();
+    float getMeioComprimento();
+    float getMeioLargura();
 };
 
 #endif // CARRO_H
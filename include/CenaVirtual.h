@@ -0,0 +1,83 @@
+#ifndef CENAVIRTUAL_H
+#define CENAVIRTUAL_H
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/vec3.hpp>
+
+// Hash FNV-1a de 32 bits de um nome. É constexpr: HashNome("carro") em uma
+// constante ou em um case é calculado pelo compilador.
+constexpr uint32_t HashNome(const char* nome, uint32_t hash = 2166136261u)
+{
+    return *nome ? HashNome(nome + 1, (hash ^ (uint8_t)*nome) * 16777619u) : hash;
+}
+
+// Como o objeto é iluminado; vai para o uniform "isGourard" dos shaders.
+enum MaterialObjeto
+{
+    MATERIAL_PHONG   = 0, // Iluminação por fragmento
+    MATERIAL_GOURAUD = 1  // Iluminação por vértice
+};
+
+// Identificador de um objeto da cena: índice no vetor de registros, estável
+// enquanto a cena existir.
+typedef int IdObjeto;
+static const IdObjeto ID_INVALIDO = -1;
+
+static const int MAXIMO_NIVEIS_OBJETO = 4;
+
+// Registro de desenho de um objeto: tudo o que glDrawElements() precisa.
+struct SceneObject
+{
+    const char*  name;        // Nome do objeto
+    uint32_t     hash;        // HashNome(name), preenchido por CenaVirtual::adiciona()
+    GLuint       vertex_array_object_id; // VAO com os atributos e os índices do objeto
+    void*        first_index; // Índice do primeiro vértice dentro do vetor indices[] definido em BuildTriangles()
+    int          num_indices; // Número de índices do objeto dentro do vetor indices[] definido em BuildTriangles()
+    GLenum       rendering_mode; // Modo de rasterização (GL_TRIANGLES, GL_TRIANGLE_STRIP, etc.)
+    GLenum       index_type;  // GL_UNSIGNED_INT ou, nas malhas do cache binário, possivelmente GL_UNSIGNED_SHORT
+    int          material;    // MaterialObjeto
+    glm::vec3    bbox_min;    // Caixa envolvente do objeto, em coordenadas do modelo
+    glm::vec3    bbox_max;
+    glm::vec3    centro_esfera; // Esfera envolvente da caixa, calculada por CenaVirtual::adiciona()
+    float        raio_esfera;
+    // Níveis de detalhe, do mais ao menos detalhado; niveis[0] é o próprio
+    // objeto. CenaVirtual::adiciona() cria o objeto com um nível só.
+    int          num_niveis;
+    IdObjeto     niveis[MAXIMO_NIVEIS_OBJETO];
+};
+
+// Cena virtual: os registros de desenho ficam contíguos em um vetor e são
+// acessados pelo IdObjeto devolvido ao adicioná-los, sem busca nenhuma no
+// laço de renderização. A busca pelo nome (por hash) é para ferramentas e
+// para a inicialização.
+class CenaVirtual
+{
+    public:
+        CenaVirtual();
+        virtual ~CenaVirtual();
+
+        // Um nome repetido substitui o registro anterior e mantém o IdObjeto
+        IdObjeto adiciona(const char* nome, const SceneObject& objeto);
+
+        const SceneObject& operator[](IdObjeto id) const { return objetos[id]; }
+        SceneObject& operator[](IdObjeto id) { return objetos[id]; }
+
+        IdObjeto procura(uint32_t hash) const;
+        IdObjeto procura(const char* nome) const;
+
+        size_t tamanho() const;
+        const std::vector<SceneObject>& getObjetos() const;
+
+    protected:
+
+    private:
+        std::vector<SceneObject> objetos;
+        std::vector<std::string> nomes; // Chaves dadas a adiciona()
+        std::unordered_map<uint32_t, IdObjeto> por_hash;
+};
+
+#endif // CENAVIRTUAL_H
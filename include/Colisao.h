@@ -0,0 +1,40 @@
+#ifndef COLISAO_H
+#define COLISAO_H
+#include <cstddef>
+#include <stdint.h>
+
+// Bits retornados pelos testes de colisão abaixo.
+enum ResultadoColisao
+{
+    COLISAO_PAREDE  = 1, // Carro encostou em uma parede
+    COLISAO_TRAPACA = 2, // Carro sobre uma barreira (a linha de saída: andou de ré até a chegada)
+    COLISAO_CHEGADA = 4  // Carro sobre a linha de chegada
+};
+
+// Descrição da pista usada pelo teste vetorizado: a área dirigível é o
+// retângulo externo menos o retângulo interno, e a reta final é a parte da
+// pista com z <= reta_final_max_z. Preenchida por Pista quando o arquivo da
+// pista tem esse formato (ver Pista::detectaRetangulos).
+struct LimitesPista
+{
+    float externo_min_x, externo_max_x, externo_min_z, externo_max_z;
+    float interno_min_x, interno_max_x, interno_min_z, interno_max_z;
+    float chegada_x;
+    float saida_x;
+    float reta_final_max_z;
+};
+
+// Testa a caixa orientada de um carro centrado em (x, z), com sentido
+// (dir_x, dir_z) e meias dimensões meio_comprimento x meio_largura. Retorna
+// uma combinação dos bits de ResultadoColisao.
+uint32_t TestaColisaoCarro(const LimitesPista& pista, float x, float z, float dir_x, float dir_z,
+                           float meio_comprimento, float meio_largura);
+
+// Mesmo teste para n carros em estrutura de arrays. Os quatro cantos de 4
+// (SSE2) ou 8 (AVX) carros são testados por instrução; nenhuma memória é
+// alocada. flags[i] recebe os bits de ResultadoColisao do carro i.
+void TestaColisaoLote(const LimitesPista& pista, const float* x, const float* z,
+                      const float* dir_x, const float* dir_z, size_t n,
+                      float meio_comprimento, float meio_largura, uint8_t* flags);
+
+#endif // COLISAO_H
@@ -0,0 +1,125 @@
+#ifndef FILARENDER_H
+#define FILARENDER_H
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/mat3x3.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+#include "CenaVirtual.h"
+#include "Frustum.h"
+#include "Instancias.h"
+
+// Contagem do que a fila fez no último envia(), para o resumo do profiler.
+struct ContadoresFila
+{
+    unsigned int itens;
+    unsigned int descartados;      // Fora do volume de visão ou além da distância máxima
+    unsigned int desenhos;         // glDrawElements*() emitidos
+    unsigned int triangulos;       // Somando todas as instâncias
+    unsigned int trocas_programa;  // glUseProgram()
+    unsigned int trocas_vao;       // glBindVertexArray()
+    unsigned int trocas_uniform;   // Uniforms de estado (isGourard, usaInstancias)
+    unsigned int evitadas;         // Trocas descartadas por serem redundantes
+};
+
+// Fila de desenho de um quadro. Durante o quadro os objetos são só
+// coletados, cada um com uma chave de ordenação; envia() ordena as chaves e
+// emite os desenhos em ordem, pulando as trocas de estado que repetiriam o
+// estado atual. Da parte mais para a menos significativa, a chave tem:
+//
+//     programa (8 bits) | material (8) | instanciado (1) | VAO (15) | profundidade (32)
+//
+// O material é o modo de iluminação (MaterialObjeto). A profundidade é a
+// distância até a câmera, em float: para valores positivos a ordem dos bits
+// é a mesma dos números, e os objetos de mesmo estado saem da frente para
+// trás.
+//
+// adiciona() descarta os objetos cuja esfera envolvente está fora do volume
+// de visão ou, se há uma distância máxima, além dela.
+//
+// Objetos com níveis de detalhe (SceneObject::niveis) são desenhados no nível
+// escolhido pelo diâmetro que a esfera envolvente ocupa na tela, com
+// histerese: cada cópia guarda o nível do quadro anterior, e só troca de
+// nível depois de passar do limiar por uma margem, para não alternar entre
+// dois níveis a cada quadro perto do limiar.
+//
+// Os programas usados precisam ser registrados antes, com registraPrograma().
+class FilaRender
+{
+    public:
+        FilaRender();
+        virtual ~FilaRender();
+
+        // Guarda as locations de "model", "normal_matrix", "isGourard" e
+        // "usaInstancias" do programa
+        void registraPrograma(GLuint program_id);
+        // Depois de recarregar um programa: o novo ocupa o lugar do antigo
+        void substituiPrograma(GLuint antigo, GLuint novo);
+
+        // distancia_maxima <= 0 desenha a qualquer distância
+        void limpa(const glm::vec4& posicao_camera, const glm::mat4& view_projection, float distancia_maxima);
+        // Altura da tela em pixels e projeção, para o tamanho dos objetos na tela
+        void defineTela(const glm::mat4& projection, int altura);
+
+        // Também usada para descartar cópias de um lote antes de montá-lo;
+        // cada objeto invisível conta como descartado
+        bool visivel(const SceneObject& objeto, const glm::mat4& model);
+        int nivelDeDetalhe(const SceneObject& objeto, const glm::mat4& model, int nivel_anterior) const;
+
+        // Cópias de um objeto com níveis de detalhe: "lotes" tem um lote por
+        // nível, cada um inicializado com o VAO do nível. adicionaInstancia()
+        // descarta a cópia ou a põe no lote do nível escolhido, atualizando
+        // "nivel"; adicionaLotes() envia os lotes e os põe na fila.
+        void adicionaInstancia(const SceneObject& objeto, const glm::mat4& model, const glm::vec4& cor,
+                               LoteInstancias* lotes, int* nivel);
+        void adicionaLotes(GLuint program_id, const CenaVirtual& cena, const SceneObject& objeto, LoteInstancias* lotes);
+        void adiciona(GLuint program_id, const SceneObject& objeto, const glm::mat4& model, const glm::mat3& normal_matrix);
+        // O lote precisa já ter sido enviado e usar o VAO do objeto
+        void adicionaLote(GLuint program_id, const SceneObject& objeto, const LoteInstancias* lote);
+        void envia();
+
+        const ContadoresFila& getContadores() const;
+
+    protected:
+
+    private:
+        struct Programa
+        {
+            GLuint id;
+            GLint model_uniform;
+            GLint normal_matrix_uniform;
+            GLint material_uniform;
+            GLint usa_instancias_uniform;
+            // Valores atuais dos uniforms de estado; -1 se desconhecidos
+            int material;
+            int usa_instancias;
+        };
+
+        struct Item
+        {
+            int programa;                 // Índice em "programas"
+            SceneObject objeto;
+            const LoteInstancias* lote;   // NULL se não é instanciado
+            glm::mat4 model;
+            glm::mat3 normal_matrix;
+        };
+
+        std::vector<Programa> programas;
+        std::vector<Item> itens;
+        std::vector<std::pair<uint64_t, uint32_t> > chaves; // (chave, índice em "itens")
+        glm::vec4 posicao_camera;
+        Frustum frustum;
+        float distancia_maxima;
+        float pixels_por_unidade; // Tamanho na tela de 1 unidade a 1 unidade de distância
+        ContadoresFila contadores;
+
+        int indicePrograma(GLuint program_id) const;
+        void localizaUniforms(Programa* programa);
+        void esferaNoMundo(const SceneObject& objeto, const glm::mat4& model, glm::vec3* centro, float* raio) const;
+        uint64_t chave(const Item& item, float profundidade) const;
+        void defineUniform(GLint location, int valor, int* atual);
+};
+
+#endif // FILARENDER_H
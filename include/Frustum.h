@@ -0,0 +1,30 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+// Os seis planos do volume de visão, extraídos da matriz projection * view
+// (método de Gribb e Hartmann): cada plano é uma combinação das linhas da
+// matriz, com a normal apontando para dentro do volume. Vale para as matrizes
+// de Matrix_Perspective() e Matrix_Orthographic(), já que só usa a
+// condição -w <= x, y, z <= w das coordenadas de recorte.
+class Frustum
+{
+    public:
+        Frustum();
+        virtual ~Frustum();
+
+        void extrai(const glm::mat4& view_projection);
+
+        // Falso só se a esfera está inteira fora de algum plano; esferas
+        // perto dos cantos podem passar sem estar visíveis.
+        bool contemEsfera(const glm::vec3& centro, float raio) const;
+
+    protected:
+
+    private:
+        glm::vec4 planos[6]; // (a, b, c, d), com (a, b, c) unitário
+};
+
+#endif // FRUSTUM_H
@@ -0,0 +1,54 @@
+#ifndef INSTANCIAS_H
+#define INSTANCIAS_H
+#include <cstddef>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/mat3x3.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+// Matriz que leva as normais do modelo para o mundo: a inversa transposta da
+// parte 3x3 de "model". Se "model" é uma semelhança (só rotações, translações
+// e escala uniforme), a própria parte 3x3 serve, já que o shader normaliza a
+// normal, e a inversa não é calculada.
+glm::mat3 MatrizNormal(const glm::mat4& model, bool semelhanca);
+
+// Dados de uma cópia de um objeto desenhada por instanciamento. O vertex
+// shader lê "model" nas locations 3 a 6 (uma coluna por location), "cor" na
+// location 7 e "normal_matrix" nas locations 8 a 10; ver shader_vertex.glsl.
+struct DadosInstancia
+{
+    glm::mat4 model;
+    glm::vec4 cor; // Multiplica a cor dos vértices
+    glm::mat3 normal_matrix;
+};
+
+// Lote de instâncias de um mesmo VAO: em vez de um glUniformMatrix4fv() e um
+// glDrawElements() por cópia do objeto, as matrizes e cores de todas as
+// cópias vão para um VBO de instâncias e são desenhadas com um único
+// glDrawElementsInstanced(), emitido pela FilaRender (ver adicionaLote()).
+class LoteInstancias
+{
+    public:
+        LoteInstancias();
+        virtual ~LoteInstancias();
+
+        // Se todas as matrizes do lote são semelhanças (ver MatrizNormal),
+        // passe semelhancas = true e a inversa não é calculada por instância.
+        void inicializa(GLuint vertex_array_object_id, bool semelhancas = false);
+        void limpa();
+        void adiciona(const glm::mat4& model, const glm::vec4& cor);
+        size_t tamanho() const;
+        void envia();
+
+    protected:
+
+    private:
+        GLuint vertex_array_object_id;
+        GLuint VBO_instancias_id;
+        size_t capacidade; // Em instâncias, do armazenamento alocado na GPU
+        bool semelhancas;
+        std::vector<DadosInstancia> dados;
+};
+
+#endif // INSTANCIAS_H
@@ -0,0 +1,201 @@
+#ifndef MALHA_H
+#define MALHA_H
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <tiny_obj_loader.h>
+
+struct ObjModel
+{
+    tinyobj::attrib_t                 attrib;
+    std::vector<tinyobj::shape_t>     shapes;
+    std::vector<tinyobj::material_t>  materials;
+
+    // Este construtor lê o modelo de um arquivo com LeObjParalelo(), que
+    // produz as mesmas estruturas da biblioteca tinyobjloader.
+    // Veja: https://github.com/syoyo/tinyobjloader
+    ObjModel(const char* filename, const char* basepath = NULL, bool triangulate = true);
+
+    // Modelo vazio, preenchido por quem chama (malhas sintéticas do benchmark)
+    ObjModel() {}
+};
+
+// Substituto de tinyobj::LoadObj() para arquivos grandes (ver
+// "LeituraObj.cpp"): o arquivo é mapeado em memória e dividido em pedaços,
+// nos fins de linha, interpretados em paralelo. Os registros v, vn, vt e f
+// vão para as mesmas estruturas, com as mesmas regras de índices, de
+// triangulação em leque, de formas ("o" e "g") e de materiais ("usemtl" e
+// "mtllib", lido pela tinyobjloader). num_threads <= 0 usa todos os núcleos.
+bool LeObjParalelo(tinyobj::attrib_t* attrib, std::vector<tinyobj::shape_t>* shapes,
+                   std::vector<tinyobj::material_t>* materials, std::string* err,
+                   const char* filename, const char* mtl_basepath = NULL, bool triangulate = true,
+                   int num_threads = 0);
+
+// Como cada face pesa na normal dos seus vértices em ComputeNormals()
+enum PesoNormais
+{
+    PESO_AREA = 0,  // Normal da face proporcional à área (a média de sempre)
+    PESO_ANGULO = 1 // Normal unitária vezes o ângulo do canto; não depende de como a face foi triangulada
+};
+
+// Se o modelo não tem normais, calcula uma por vértice (ver "Normais.cpp")
+// e aponta o normal_index de cada canto para ela. O modelo precisa estar
+// triangulado. num_threads <= 0 usa todos os núcleos.
+void ComputeNormals(ObjModel* model, PesoNormais peso = PESO_AREA, int num_threads = 0);
+
+// Núcleo de ComputeNormals(): normais unitárias dos num_vertices vértices
+// (xyz intercalados, como em attrib.vertices), somando as faces dos
+// num_triangulos triângulos (três índices cada). Vértices sem triângulo
+// ficam com normal nula.
+void CalculaNormaisVertices(const float* posicoes, size_t num_vertices, const uint32_t* triangulos,
+                            size_t num_triangulos, PesoNormais peso, int num_threads, float* normais);
+
+// A implementação escalar anterior, só por área; referência do benchmark
+void ComputeNormalsEscalar(ObjModel* model);
+
+// Vértice intercalado, na ordem das locations de "shader_vertex.glsl":
+// posição (location 0), cor (location 1) e normal (location 2). A quarta
+// coordenada da posição é completada com 1 pelo OpenGL; a da normal não é
+// usada pelo shader.
+struct VerticeMalha
+{
+    float posicao[3];
+    float cor[4];
+    float normal[3];
+};
+
+// Formato compacto do mesmo vértice, com 20 bytes em vez de 40: a normal vai
+// em GL_INT_2_10_10_10_REV (três componentes de 10 bits com sinal) e a cor em
+// RGBA8, ambas normalizadas pelo OpenGL para o vec4 que o shader espera.
+struct VerticeCompacto
+{
+    float posicao[3];
+    uint32_t normal;
+    uint8_t cor[4];
+};
+
+// Formato dos vértices de uma malha na GPU (e no cache binário). O compacto
+// tem metade da banda de leitura de vértices; o float é exato.
+enum FormatoVertice
+{
+    VERTICE_FLOAT = 0,    // VerticeMalha
+    VERTICE_COMPACTO = 1  // VerticeCompacto
+};
+
+size_t BytesPorVertice(FormatoVertice formato);
+uint32_t EmpacotaNormal(const float normal[3]);
+void CompactaVertices(const std::vector<VerticeMalha>& vertices, std::vector<VerticeCompacto>* compactos);
+
+// Caixa envolvente alinhada aos eixos, em coordenadas do modelo.
+struct LimitesMalha
+{
+    float min[3];
+    float max[3];
+};
+
+// Nível de detalhe de uma malha: um trecho de Malha::indices. Todos os
+// níveis usam os mesmos vértices; o nível 0 é a malha completa.
+struct NivelMalha
+{
+    uint32_t primeiro_indice;
+    uint32_t num_indices;
+};
+
+static const int MAXIMO_NIVEIS_MALHA = 4;
+
+// Malhas com menos triângulos que isto ficam só com o nível 0
+static const size_t MINIMO_TRIANGULOS_NIVEIS = 1000;
+
+// Malha indexada pronta para ser enviada à GPU.
+struct Malha
+{
+    std::vector<VerticeMalha> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<NivelMalha> niveis; // Vazio equivale a um só nível, com todos os índices
+    LimitesMalha limites;
+};
+
+// Números de OtimizaMalha(). O ACMR ("average cache miss ratio") é o número
+// médio de vértices transformados pelo vertex shader por triângulo, simulando
+// um cache pós-transformação FIFO de TAMANHO_CACHE_VERTICES entradas: 3 sem
+// reaproveitamento nenhum, perto de 0.5 no melhor caso para uma malha fechada.
+struct RelatorioMalha
+{
+    size_t vertices_antes, vertices_depois;
+    float acmr_antes;   // Com um vértice por canto de triângulo
+    float acmr_soldado; // Depois da soldagem, na ordem original dos triângulos
+    float acmr_depois;  // Depois da reordenação
+};
+
+static const int TAMANHO_CACHE_VERTICES = 32;
+
+// Lê um OBJ com a tinyobjloader e monta a malha que BuildCar() e BuildCow()
+// enviam para a GPU, já otimizada por OtimizaMalha() e com os níveis de
+// detalhe de GeraNiveisDeDetalhe(). Com recalcula_normais,
+// as normais do arquivo são descartadas e recalculadas por ComputeNormals().
+// Como ObjModel, lança std::runtime_error se o arquivo não puder ser lido.
+void ConverteObj(const char* arquivo_obj, bool recalcula_normais, Malha* malha, RelatorioMalha* relatorio = NULL);
+
+// Etapas de OtimizaMalha(), na ordem em que são aplicadas:
+//  - SoldaVertices() junta vértices idênticos (posição, cor e normal);
+//  - OtimizaCacheVertices() reordena os triângulos para o cache
+//    pós-transformação da GPU (algoritmo de Tom Forsyth, "Linear-Speed Vertex
+//    Cache Optimisation");
+//  - OtimizaBuscaVertices() renumera os vértices na ordem do primeiro uso,
+//    para que a leitura do VBO seja quase sequencial.
+void OtimizaMalha(Malha* malha, RelatorioMalha* relatorio = NULL);
+void SoldaVertices(Malha* malha);
+void OtimizaCacheVertices(std::vector<uint32_t>* indices, size_t num_vertices);
+void OtimizaBuscaVertices(Malha* malha);
+float CalculaAcmr(const std::vector<uint32_t>& indices, size_t num_vertices, int tamanho_cache = TAMANHO_CACHE_VERTICES);
+
+// Acrescenta a uma malha já otimizada (só com o nível 0) até
+// MAXIMO_NIVEIS_MALHA - 1 níveis simplificados, com metade dos triângulos do
+// anterior cada, por colapsos de aresta guiados por quádricas de erro (ver
+// "Simplificacao.cpp"). Os índices de cada nível são reordenados para o cache
+// de vértices.
+void GeraNiveisDeDetalhe(Malha* malha);
+
+// Cache binário de uma malha convertida de OBJ (Car.obj -> Car.malha). O
+// arquivo é mapeado em memória e os vértices e índices vão da página mapeada
+// direto para glBufferData(), sem nenhuma interpretação de texto. O cabeçalho
+// guarda o tamanho e a data de modificação do OBJ de origem: se o OBJ mudou,
+// ou se o cache foi gravado em outro formato de vértice, abre() falha e quem
+// chamou deve voltar ao OBJ (e regravar o cache).
+class ArquivoMalha
+{
+    public:
+        ArquivoMalha();
+        virtual ~ArquivoMalha();
+
+        bool abre(const char* arquivo, const char* arquivo_obj, bool recalcula_normais, FormatoVertice formato);
+        void fecha();
+
+        const void* getVertices() const;
+        uint32_t numeroDeVertices() const;
+        FormatoVertice formato() const;
+        const void* getIndices() const;
+        uint32_t numeroDeIndices() const;
+        uint32_t bytesPorIndice() const; // 2 (até 65536 vértices) ou 4
+        uint32_t numeroDeNiveis() const;
+        NivelMalha getNivel(uint32_t nivel) const; // Em índices a partir de getIndices()
+        const LimitesMalha& getLimites() const;
+
+        static bool Salva(const char* arquivo, const char* arquivo_obj, bool recalcula_normais, const Malha& malha,
+                          FormatoVertice formato);
+        static std::string CaminhoCache(const char* arquivo_obj);
+
+    protected:
+
+    private:
+        const unsigned char* dados;
+        size_t tamanho;
+        std::vector<unsigned char> copia; // Sem mmap (Windows), o arquivo é lido para cá
+        LimitesMalha limites;
+
+        ArquivoMalha(const ArquivoMalha&);
+        ArquivoMalha& operator=(const ArquivoMalha&);
+};
+
+#endif // MALHA_H
@@ -1,16 +1,125 @@
 #ifndef PISTA_H
 #define PISTA_H
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <glm/vec2.hpp>
+#include "Colisao.h"
 
+// Segmento de reta no plano XZ.
+struct Segmento
+{
+    float x0, z0, x1, z1;
+};
+
+// Bloco desenhado para uma parede: um cubo unitário escalado em X por
+// "comprimento", girado de "angulo" em torno de Y e centrado em
+// (centro_x, centro_z). Ver o laço das paredes em main().
+struct BlocoParede
+{
+    float centro_x, centro_z;
+    float comprimento;
+    float angulo;
+};
 
+// Vaca decorativa, sem colisão, desenhada com o modelo de BuildCow().
+struct Vaca
+{
+    float x, z;
+    float angulo;
+    float escala;
+};
+
+// Pista carregada de um arquivo texto (ver utilities/pista.txt). É a única
+// fonte da geometria do circuito: a colisão dos carros, a lógica de voltas
+// (checkpoints e chegada) e as malhas desenhadas em main.cpp são todas
+// derivadas daqui.
 class Pista
 {
     public:
         Pista();
         virtual ~Pista();
 
+        bool carrega(const char* arquivo);
+
+        // Bits de ResultadoColisao para a caixa de um carro (ver Colisao.h)
+        uint32_t testaCarro(float x, float z, float dir_x, float dir_z,
+                            float meio_comprimento, float meio_largura) const;
+        void testaLote(const float* x, const float* z, const float* dir_x, const float* dir_z, size_t n,
+                       float meio_comprimento, float meio_largura, uint8_t* flags) const;
+        bool cruzouCheckpoint(size_t i, float x, float z, float dir_x, float dir_z,
+                              float meio_comprimento, float meio_largura) const;
+        size_t numeroDeCheckpoints() const;
+
+        const std::vector< std::vector<glm::vec2> >& getAreas() const;
+        const std::vector<BlocoParede>& getBlocosParede() const;
+        const std::vector<Vaca>& getVacas() const;
+        float getLargadaX() const;
+        float getLargadaZ() const;
+        float getLargadaAngulo() const;
+        void getLimites(float* min_x, float* min_z, float* max_x, float* max_z) const;
+
+        // Quando a pista é a de dois retângulos alinhados aos eixos (como a
+        // original), os testes usam o kernel vetorizado de Colisao.cpp em vez
+        // da grade. Desligar o atalho força o caminho genérico.
+        bool ehRetangular() const;
+        void setUsaAtalhoRetangular(bool usa);
+
+        // Campo de distância com sinal (SDF) das paredes, amostrado em uma
+        // grade regular: positivo no asfalto, negativo fora, zero sobre as
+        // paredes. Quando presente, as paredes deixam de ser testadas
+        // segmento a segmento e cada amostra da caixa do carro custa uma
+        // interpolação bilinear. carrega() lê automaticamente o arquivo
+        // CaminhoSdf(arquivo) se ele existir e corresponder à pista.
+        bool assaSdf(float passo);
+        bool salvaSdf(const char* arquivo) const;
+        bool carregaSdf(const char* arquivo);
+        bool temSdf() const; // Carregado (ou assado) e não desligado por setUsaSdf(false)
+        void setUsaSdf(bool usa);
+        float distanciaParede(float x, float z) const;
+        void normalParede(float x, float z, float* nx, float* nz) const; // Aponta para o asfalto
+        static std::string CaminhoSdf(const char* arquivo_pista);
+
     protected:
 
     private:
+        enum TipoSegmento { SEGMENTO_PAREDE = 0, SEGMENTO_BARREIRA = 1 };
+
+        std::vector<Segmento> segmentos; // Paredes e barreiras, indexados pela grade
+        std::vector<uint8_t> tipos;      // TipoSegmento de cada segmento
+        std::vector<unsigned int> barreiras; // Índices das barreiras em segmentos
+        std::vector<Segmento> checkpoints;
+        std::vector<Segmento> chegadas;
+        std::vector< std::vector<glm::vec2> > areas;
+        std::vector<BlocoParede> blocos;
+        std::vector<Vaca> vacas;
+        float largada_x, largada_z, largada_angulo;
+        float min_x, min_z, max_x, max_z;
+
+        // Grade uniforme sobre os limites da pista. A célula (i, j) guarda os
+        // segmentos que a atravessam em celula_segmentos[celula_inicio[c] ..
+        // celula_inicio[c+1]), com c = j*celulas_x + i.
+        float tamanho_celula;
+        int celulas_x, celulas_z;
+        std::vector<unsigned int> celula_inicio;
+        std::vector<unsigned int> celula_segmentos;
+
+        bool retangular;
+        bool usa_atalho;
+        LimitesPista limites;
+
+        std::vector<float> sdf; // sdf_largura x sdf_altura amostras, linha a linha em z
+        float sdf_min_x, sdf_min_z, sdf_passo;
+        int sdf_largura, sdf_altura;
+        uint32_t hash_arquivo;  // FNV-1a do arquivo da pista, gravado junto com o SDF
+        bool usa_sdf;
+
+        void limpa();
+        void constroiGrade();
+        void constroiBlocos();
+        void detectaRetangulos();
+        bool dentroDeArea(float x, float z) const;
 };
 
 #endif // PISTA_H
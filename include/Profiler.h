@@ -0,0 +1,126 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+#include <cstddef>
+#include <stdint.h>
+#include <chrono>
+#include <vector>
+
+// Tempo médio de um escopo nomeado, para o resumo desenhado na tela.
+struct LinhaProfiler
+{
+    const char* nome;
+    int profundidade; // Escopos dentro de outros escopos ficam indentados
+    double cpu_ms;
+    double gpu_ms;    // Negativo se o escopo não mede a GPU
+};
+
+// Profiler de quadros: escopos de CPU medidos com std::chrono e escopos de
+// GPU medidos com consultas GL_TIME_ELAPSED. As consultas de cada quadro
+// ficam em um anel de QUADROS_EM_VOO posições e só são lidas quando o
+// resultado já está disponível, vários quadros depois: o profiler nunca faz a
+// CPU esperar pela GPU.
+//
+// Os nomes dos escopos devem ser literais (ou durar o programa todo): eles
+// são comparados e guardados pelo ponteiro.
+//
+// Uso, dentro de um bloco:
+//     PROFILER_ESCOPO("Simulacao");      // só CPU
+//     PROFILER_ESCOPO_GPU("Paredes");    // CPU e GPU
+//
+// Escopos de GPU não podem ser aninhados (uma única consulta GL_TIME_ELAPSED
+// pode estar ativa por vez); um escopo de GPU dentro de outro mede só a CPU.
+class Profiler
+{
+    public:
+        static const int QUADROS_EM_VOO = 4;
+
+        Profiler();
+        virtual ~Profiler();
+
+        void inicializaGpu(); // Precisa de um contexto OpenGL; sem ela, só a CPU é medida
+        void iniciaQuadro();
+        void terminaQuadro();
+
+        void abreEscopo(const char* nome, bool gpu);
+        void fechaEscopo();
+
+        const std::vector<LinhaProfiler>& getLinhas() const;
+        double getQuadroMs() const;
+
+        // Captura no formato "Trace Event" do Chrome (abra em chrome://tracing
+        // ou em https://ui.perfetto.dev). Os eventos de GPU são posicionados
+        // no instante em que foram enviados pela CPU, um depois do outro:
+        // GL_TIME_ELAPSED mede só a duração.
+        void iniciaCaptura();
+        bool terminaCaptura(const char* arquivo);
+        bool capturando() const;
+
+    protected:
+
+    private:
+        struct Escopo
+        {
+            const char* nome;
+            int profundidade;
+            double inicio_us;
+            int consulta; // Índice da consulta de GPU no quadro, ou -1
+        };
+
+        struct ConsultaGpu
+        {
+            unsigned int id;
+            const char* nome;
+            int profundidade;
+            double inicio_us; // Da CPU, quando o escopo foi aberto
+        };
+
+        struct EventoTrace
+        {
+            const char* nome;
+            double inicio_us, duracao_us;
+            int thread; // 1: CPU, 2: GPU
+        };
+
+        std::chrono::steady_clock::time_point origem;
+        bool usa_gpu;
+        uint64_t quadro;
+        double inicio_quadro_us;
+        double quadro_ms;
+        std::vector<Escopo> pilha;
+        int escopos_gpu_abertos;
+
+        // Consultas de GPU de cada posição do anel: as usadas no quadro e as
+        // já criadas, que são reaproveitadas.
+        std::vector<ConsultaGpu> consultas[QUADROS_EM_VOO];
+        std::vector<unsigned int> livres[QUADROS_EM_VOO];
+
+        std::vector<LinhaProfiler> linhas;
+        bool gravando;
+        std::vector<EventoTrace> trace;
+
+        double agoraUs() const;
+        LinhaProfiler& linha(const char* nome, int profundidade);
+        void coletaGpu(int posicao);
+        void registra(const char* nome, double inicio_us, double duracao_us, int thread);
+};
+
+extern Profiler g_Profiler;
+
+struct EscopoProfiler
+{
+    EscopoProfiler(const char* nome, bool gpu) { g_Profiler.abreEscopo(nome, gpu); }
+    ~EscopoProfiler() { g_Profiler.fechaEscopo(); }
+};
+
+#define PROFILER_CONCATENA2(a, b) a##b
+#define PROFILER_CONCATENA(a, b) PROFILER_CONCATENA2(a, b)
+
+#ifndef SEM_PROFILER
+#define PROFILER_ESCOPO(nome) EscopoProfiler PROFILER_CONCATENA(escopo_profiler_, __LINE__)(nome, false)
+#define PROFILER_ESCOPO_GPU(nome) EscopoProfiler PROFILER_CONCATENA(escopo_profiler_, __LINE__)(nome, true)
+#else
+#define PROFILER_ESCOPO(nome)
+#define PROFILER_ESCOPO_GPU(nome)
+#endif
+
+#endif // PROFILER_H
@@ -0,0 +1,55 @@
+#ifndef RECARGASHADERS_H
+#define RECARGASHADERS_H
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <glad/glad.h>
+#include "CacheProgramas.h"
+
+// Recarga de um programa de GPU quando os arquivos GLSL mudam, com o jogo
+// rodando. No Linux as mudanças chegam pelo inotify, que vigia os diretórios
+// dos arquivos (editores costumam gravar um arquivo novo e renomeá-lo por
+// cima do antigo); nos outros sistemas a data de modificação é conferida a
+// cada meio segundo.
+//
+// A compilação é feita em etapas por CacheProgramas, sem esperar o driver no
+// meio do quadro. Se ela falha, os erros são impressos e o programa antigo
+// continua em uso. Uma mudança que chega durante uma compilação dispara
+// outra assim que a atual termina.
+class RecargaShaders
+{
+    public:
+        RecargaShaders();
+        virtual ~RecargaShaders();
+
+        // Os mesmos argumentos de CacheProgramas::criaDeArquivos()
+        void vigia(const char* nome, const char* arquivo_vertex, const char* arquivo_fragment);
+
+        // Chamada uma vez por quadro, com o contexto OpenGL atual. Devolve o
+        // novo programa quando uma recompilação termina bem, ou 0. Quem chama
+        // passa a ser dono do novo programa e deve apagar o antigo.
+        GLuint atualiza();
+
+    protected:
+
+    private:
+        std::string nome;
+        std::string arquivos[2]; // Vertex e fragment shader
+
+        int inotify_fd;          // -1 fora do Linux ou se o inotify falhou
+        long long modificacao[2];
+        std::chrono::steady_clock::time_point ultima_consulta;
+
+        bool mudou;              // Há uma mudança ainda não compilada
+        bool compilando;
+        CriacaoPrograma criacao;
+
+        bool arquivosMudaram();
+        void inicia();
+
+        RecargaShaders(const RecargaShaders&);
+        RecargaShaders& operator=(const RecargaShaders&);
+};
+
+#endif // RECARGASHADERS_H
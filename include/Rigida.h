@@ -0,0 +1,170 @@
+#ifndef RIGIDA_H
+#define RIGIDA_H
+#include <cmath>
+#include <glm/mat3x3.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+// Movimento rígido p -> rotacao * p + translacao, guardado em 12 floats em vez
+// dos 16 de uma glm::mat4. A última linha de uma matriz rígida é sempre
+// (0, 0, 0, 1), então compor, inverter e aplicar sem ela poupa a maior parte
+// das multiplicações de Matrix_Multiply(). Carro e CarFleet só fazem
+// rotações em torno do eixo Y e translações; Rigida_GiraY() é o caminho
+// rápido para esse caso, com poucas multiplicações por coluna.
+struct TransformacaoRigida
+{
+    glm::mat3 rotacao;
+    glm::vec3 translacao;
+};
+
+inline TransformacaoRigida Rigida_Identidade()
+{
+    TransformacaoRigida r;
+    r.rotacao = glm::mat3(1.0f);
+    r.translacao = glm::vec3(0.0f);
+    return r;
+}
+
+inline TransformacaoRigida Rigida_Translacao(glm::vec3 t)
+{
+    TransformacaoRigida r = Rigida_Identidade();
+    r.translacao = t;
+    return r;
+}
+
+// Mesma rotação de Matrix_Rotate_Y(): (x, z) -> (c*x + s*z, -s*x + c*z)
+inline TransformacaoRigida Rigida_RotacaoY(float angulo)
+{
+    const float c = cosf(angulo);
+    const float s = sinf(angulo);
+    TransformacaoRigida r;
+    r.rotacao = glm::mat3(
+         c,    0.0f, -s,   // COLUNA 1
+         0.0f, 1.0f, 0.0f, // COLUNA 2
+         s,    0.0f, c     // COLUNA 3
+    );
+    r.translacao = glm::vec3(0.0f);
+    return r;
+}
+
+// Parte rígida de uma matriz homogênea sem escala: rotação nas três primeiras
+// colunas, translação na quarta
+inline TransformacaoRigida Rigida_DeMatriz(const glm::mat4& m)
+{
+    TransformacaoRigida r;
+    r.rotacao = glm::mat3(m);
+    r.translacao = glm::vec3(m[3]);
+    return r;
+}
+
+// a ∘ b: aplica b e depois a, como o produto de matrizes A * B
+inline TransformacaoRigida Rigida_Compoe(const TransformacaoRigida& a, const TransformacaoRigida& b)
+{
+    TransformacaoRigida r;
+    r.rotacao = a.rotacao * b.rotacao;
+    r.translacao = a.rotacao * b.translacao + a.translacao;
+    return r;
+}
+
+// A inversa de uma rotação é a sua transposta
+inline TransformacaoRigida Rigida_Inversa(const TransformacaoRigida& a)
+{
+    TransformacaoRigida r;
+    r.rotacao = glm::transpose(a.rotacao);
+    r.translacao = -(r.rotacao * a.translacao);
+    return r;
+}
+
+inline glm::vec3 Rigida_AplicaPonto(const TransformacaoRigida& a, glm::vec3 p)
+{
+    return a.rotacao * p + a.translacao;
+}
+
+// Vetores (w = 0) não sofrem a translação
+inline glm::vec3 Rigida_AplicaVetor(const TransformacaoRigida& a, glm::vec3 v)
+{
+    return a.rotacao * v;
+}
+
+// Vetor v girado por Ry, a rotação de cosseno c e seno s de Rigida_RotacaoY()
+inline glm::vec3 Rigida_GiraVetorY(glm::vec3 v, float c, float s)
+{
+    return glm::vec3(c * v.x + s * v.z, v.y, c * v.z - s * v.x);
+}
+
+// Ry ∘ a. Só as componentes x e z de cada coluna mudam: quatro
+// multiplicações por coluna em vez das nove de Rigida_Compoe().
+inline TransformacaoRigida Rigida_GiraY(const TransformacaoRigida& a, float c, float s)
+{
+    TransformacaoRigida r;
+    r.rotacao = glm::mat3(Rigida_GiraVetorY(a.rotacao[0], c, s),
+                          Rigida_GiraVetorY(a.rotacao[1], c, s),
+                          Rigida_GiraVetorY(a.rotacao[2], c, s));
+    r.translacao = Rigida_GiraVetorY(a.translacao, c, s);
+    return r;
+}
+
+// T(pivo) ∘ Ry ∘ T(-pivo) ∘ a: gira "a" em torno do eixo vertical que passa
+// por "pivo", o que Carro fazia com três produtos de glm::mat4
+inline TransformacaoRigida Rigida_GiraYEmTorno(const TransformacaoRigida& a, float c, float s, glm::vec3 pivo)
+{
+    TransformacaoRigida r;
+    r.rotacao = glm::mat3(Rigida_GiraVetorY(a.rotacao[0], c, s),
+                          Rigida_GiraVetorY(a.rotacao[1], c, s),
+                          Rigida_GiraVetorY(a.rotacao[2], c, s));
+    r.translacao = Rigida_GiraVetorY(a.translacao - pivo, c, s) + pivo;
+    return r;
+}
+
+// Matriz homogênea de a ∘ S(escala), com S uma escala uniforme: a forma da
+// matriz "model" dos carros. Escreve elemento a elemento direto no destino:
+// montar a glm::mat4 em uma temporária e copiá-la faz o compilador ler 16
+// bytes logo depois de escrevê-los de 4 em 4, o que custa mais que a conta.
+inline void Rigida_EscreveMatriz(const TransformacaoRigida& a, float escala, glm::mat4* destino)
+{
+    glm::mat4& d = *destino;
+    for (int coluna = 0; coluna < 3; ++coluna)
+    {
+        d[coluna][0] = escala * a.rotacao[coluna][0];
+        d[coluna][1] = escala * a.rotacao[coluna][1];
+        d[coluna][2] = escala * a.rotacao[coluna][2];
+        d[coluna][3] = 0.0f;
+    }
+    d[3][0] = a.translacao.x;
+    d[3][1] = a.translacao.y;
+    d[3][2] = a.translacao.z;
+    d[3][3] = 1.0f;
+}
+
+// A matriz de T(deslocamento) ∘ Ry ∘ a ∘ S(escala) em um passo só, sem a
+// transformação intermediária de Rigida_GiraY(): a matriz "model" de cada
+// carro de CarFleet
+inline void Rigida_EscreveMatrizGiradaY(const TransformacaoRigida& a, float c, float s, glm::vec3 deslocamento,
+                                        float escala, glm::mat4* destino)
+{
+    glm::mat4& d = *destino;
+    for (int coluna = 0; coluna < 3; ++coluna)
+    {
+        const float x = a.rotacao[coluna][0];
+        const float z = a.rotacao[coluna][2];
+        d[coluna][0] = escala * (c * x + s * z);
+        d[coluna][1] = escala * a.rotacao[coluna][1];
+        d[coluna][2] = escala * (c * z - s * x);
+        d[coluna][3] = 0.0f;
+    }
+    const float x = a.translacao.x;
+    const float z = a.translacao.z;
+    d[3][0] = c * x + s * z + deslocamento.x;
+    d[3][1] = a.translacao.y + deslocamento.y;
+    d[3][2] = c * z - s * x + deslocamento.z;
+    d[3][3] = 1.0f;
+}
+
+inline glm::mat4 Rigida_Matriz(const TransformacaoRigida& a, float escala = 1.0f)
+{
+    glm::mat4 m(glm::uninitialize);
+    Rigida_EscreveMatriz(a, escala, &m);
+    return m;
+}
+
+#endif // RIGIDA_H
@@ -0,0 +1,84 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+#include <deque>
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+#include "Carro.h"
+
+// Ações que o jogador pode manter pressionadas. A simulação não conhece a
+// GLFW: quem recebe os eventos do teclado (KeyCallback em main.cpp, ou o
+// piloto automático de headless.cpp) apenas enfileira comandos.
+enum Acao
+{
+    ACAO_ACELERAR = 0,
+    ACAO_RE,
+    ACAO_ESQUERDA,
+    ACAO_DIREITA,
+    NUM_ACOES
+};
+
+struct ComandoEntrada
+{
+    Acao acao;
+    bool pressionado;
+};
+
+// Simulação da corrida com passo de tempo fixo. O carro só é atualizado
+// dentro de passo(), PASSOS_POR_SEGUNDO vezes por segundo de jogo,
+// independentemente da taxa de quadros e da taxa de repetição de teclas do
+// sistema operacional. O relógio da corrida conta passos, então o mesmo
+// conjunto de comandos sempre produz o mesmo tempo de volta.
+class Simulation
+{
+private:
+    // Estado do carro ao final de um passo, usado para interpolar entre os
+    // dois últimos passos na hora de renderizar.
+    struct EstadoCarro
+    {
+        TransformacaoRigida transformacao; // Parte rígida da matriz de Carro
+        float escala;
+        glm::vec4 posicao;
+        glm::vec4 sentido;
+    };
+
+    Carro carro;
+    const Pista* pista;
+    size_t proximo_checkpoint;
+    std::deque<ComandoEntrada> fila;
+    bool acoes[NUM_ACOES];
+    EstadoCarro anterior;
+    EstadoCarro atual;
+    double acumulador;
+    unsigned long passos;
+    bool fim;
+    bool vitoria;
+    double tempo_final;
+
+    void passo();
+    EstadoCarro capturaEstado();
+    void interpola(float alpha, glm::vec4* posicao, glm::vec4* sentido, float* angulo) const;
+
+public:
+    static const int PASSOS_POR_SEGUNDO = 30; // Próximo da repetição de teclas, preserva a sensação original
+    static const double DURACAO_PASSO;
+    static const double TEMPO_LIMITE;
+
+    Simulation();
+    void setPista(const Pista* pista);
+    void reinicia();
+    void enfileira(Acao acao, bool pressionado);
+    int avanca(double segundos);
+    void executaPassos(unsigned long n);
+    float alpha() const;
+    unsigned long numeroDePassos() const;
+    double tempoDeCorrida() const;
+    bool terminou() const;
+    bool venceu() const;
+    size_t checkpointsCruzados() const;
+    Carro& getCarro();
+    glm::mat4 getMatrixInterpolada(float alpha) const;
+    glm::vec4 getCameraPositionInterpolada(float alpha) const;
+    glm::vec4 getCameraViewInterpolada(float alpha) const;
+};
+
+#endif // SIMULATION_H
@@ -0,0 +1,52 @@
+#ifndef TEXTMESH_H
+#define TEXTMESH_H
+#include <cstddef>
+#include <string>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+// Texto retido: a string é diagramada uma vez em um VBO próprio e cada
+// desenho custa só a troca de programa, um uniform de deslocamento e um
+// glDrawArrays(). A diagramação é refeita apenas quando o texto, a escala ou
+// o tamanho da janela mudam. Serve para os rótulos fixos do HUD; o texto que
+// muda a cada quadro continua indo por TextRendering_PrintString().
+//
+// O texto pode ter várias linhas, separadas por '\n'. Precisa de
+// TextRendering_Init().
+class TextMesh
+{
+    public:
+        TextMesh();
+        virtual ~TextMesh();
+
+        void setTexto(const std::string& texto, float scale = 1.0f);
+        const std::string& getTexto() const;
+
+        // (x, y) é a posição da primeira linha, como em TextRendering_PrintString()
+        void desenha(GLFWwindow* window, float x, float y);
+
+        // Apaga o VAO e o VBO; o texto fica, e o próximo desenha() diagrama
+        // de novo. Precisa do contexto OpenGL: o destrutor também chama
+        // libera(), então um TextMesh que vive até o fim do programa deve ser
+        // liberado antes de glfwTerminate().
+        void libera();
+
+    protected:
+
+    private:
+        std::string texto;
+        float escala;
+        bool valida;              // A diagramação no VBO corresponde ao texto?
+        int largura_janela, altura_janela;
+
+        GLuint vertex_array_object_id;
+        GLuint VBO_id;
+        GLsizei num_vertices;
+
+        void diagrama(GLFWwindow* window);
+
+        TextMesh(const TextMesh&);
+        TextMesh& operator=(const TextMesh&);
+};
+
+#endif // TEXTMESH_H
@@ -0,0 +1,42 @@
+#ifndef UNIFORMESCAMERA_H
+#define UNIFORMESCAMERA_H
+#include <glad/glad.h>
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+// Conteúdo do bloco "Camera" dos shaders, no layout std140: cada mat4 são
+// quatro vec4 (colunas) e o vec4 vem logo depois, sem enchimento. Precisa
+// ser igual à declaração em shader_vertex.glsl e shader_fragment.glsl.
+struct BlocoCamera
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 view_projection;  // projection * view
+    glm::vec4 posicao_camera;   // Em coordenadas do mundo, w = 1
+};
+
+// Uniform buffer object com os dados da câmera de um quadro. É calculado e
+// enviado uma vez por quadro, e todo programa que declara o bloco "Camera" o
+// lê do mesmo ponto de ligação: nenhum shader precisa mais de inverse(view)
+// para achar a posição da câmera.
+class UniformesCamera
+{
+    public:
+        static const GLuint PONTO_DE_LIGACAO = 0;
+
+        UniformesCamera();
+        virtual ~UniformesCamera();
+
+        void inicializa();
+        void associa(GLuint program_id) const; // Para cada programa que usa o bloco
+        void atualiza(const glm::mat4& view, const glm::mat4& projection);
+        const BlocoCamera& getBloco() const;
+
+    protected:
+
+    private:
+        GLuint UBO_id;
+        BlocoCamera bloco;
+};
+
+#endif // UNIFORMESCAMERA_H
@@ -8,6 +8,51 @@
 #include <glm/vec4.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#if defined(__AVX__)
+#include <immintrin.h>
+#define MATRICES_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MATRICES_SSE2
+#endif
+
+// A glm::mat4 desta versão da GLM (0.9.8) não tem construtores constexpr, e
+// portanto não pode ser calculada em tempo de compilação. Matriz4 guarda os
+// mesmos 16 floats, na mesma ordem "column-major" (veja Matrix() abaixo), e
+// pode ser construída e multiplicada em expressões constexpr. As funções
+// Matrix_*() que não dependem de cos/sin a retornam; ela se converte
+// implicitamente para glm::mat4 quando é atribuída ou passada adiante.
+struct Matriz4
+{
+    float m[16]; // COLUNA 1, COLUNA 2, COLUNA 3, COLUNA 4
+
+    constexpr Matriz4(
+        float a0,  float a1,  float a2,  float a3,  // COLUNA 1
+        float a4,  float a5,  float a6,  float a7,  // COLUNA 2
+        float a8,  float a9,  float a10, float a11, // COLUNA 3
+        float a12, float a13, float a14, float a15  // COLUNA 4
+    )
+        : m{a0, a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15}
+    {
+    }
+
+    // Elemento da linha "linha" e coluna "coluna", contando de zero
+    constexpr float operator()(int linha, int coluna) const
+    {
+        return m[4*coluna + linha];
+    }
+
+    operator glm::mat4() const
+    {
+        return glm::mat4(
+            m[0],  m[1],  m[2],  m[3],
+            m[4],  m[5],  m[6],  m[7],
+            m[8],  m[9],  m[10], m[11],
+            m[12], m[13], m[14], m[15]
+        );
+    }
+};
+
 // Esta função Matrix() auxilia na criação de matrizes usando a biblioteca GLM.
 // Note que em OpenGL (e GLM) as matrizes são definidas como "column-major",
 // onde os elementos da matriz são armazenadas percorrendo as COLUNAS da mesma.
@@ -27,14 +72,14 @@
 //
 // Para conseguirmos definir matrizes através de suas LINHAS, a função Matrix()
 // computa a transposta usando os elementos passados por parâmetros.
-glm::mat4 Matrix(
+constexpr Matriz4 Matrix(
     float m00, float m01, float m02, float m03, // LINHA 1
     float m10, float m11, float m12, float m13, // LINHA 2
     float m20, float m21, float m22, float m23, // LINHA 3
     float m30, float m31, float m32, float m33  // LINHA 4
 )
 {
-    return glm::mat4(
+    return Matriz4(
         m00, m10, m20, m30, // COLUNA 1
         m01, m11, m21, m31, // COLUNA 2
         m02, m12, m22, m32, // COLUNA 3
@@ -42,8 +87,61 @@ glm::mat4 Matrix(
     );
 }
 
+// Elemento (i,j) do produto A*B. As parcelas são somadas na mesma ordem do
+// "A * B" da GLM sem SIMD, então o resultado em tempo de compilação é o mesmo
+// que o programa calcularia em tempo de execução.
+constexpr float ElementoProduto(const Matriz4& A, const Matriz4& B, int i, int j)
+{
+    return A(i,0)*B(0,j) + A(i,1)*B(1,j) + A(i,2)*B(2,j) + A(i,3)*B(3,j);
+}
+
+// Produto A*B em tempo de compilação. Para matrizes que só são conhecidas em
+// tempo de execução, Matrix_Multiply() (abaixo) é mais rápida.
+constexpr Matriz4 operator*(const Matriz4& A, const Matriz4& B)
+{
+    return Matrix(
+        ElementoProduto(A,B,0,0) , ElementoProduto(A,B,0,1) , ElementoProduto(A,B,0,2) , ElementoProduto(A,B,0,3) ,  // LINHA 1
+        ElementoProduto(A,B,1,0) , ElementoProduto(A,B,1,1) , ElementoProduto(A,B,1,2) , ElementoProduto(A,B,1,3) ,  // LINHA 2
+        ElementoProduto(A,B,2,0) , ElementoProduto(A,B,2,1) , ElementoProduto(A,B,2,2) , ElementoProduto(A,B,2,3) ,  // LINHA 3
+        ElementoProduto(A,B,3,0) , ElementoProduto(A,B,3,1) , ElementoProduto(A,B,3,2) , ElementoProduto(A,B,3,3)    // LINHA 4
+    );
+}
+
+constexpr Matriz4 operator-(const Matriz4& A)
+{
+    return Matriz4(
+        -A.m[0],  -A.m[1],  -A.m[2],  -A.m[3],
+        -A.m[4],  -A.m[5],  -A.m[6],  -A.m[7],
+        -A.m[8],  -A.m[9],  -A.m[10], -A.m[11],
+        -A.m[12], -A.m[13], -A.m[14], -A.m[15]
+    );
+}
+
+// Igualdade exata, elemento a elemento, a partir do elemento i; usada pelos
+// static_assert do fim deste arquivo
+constexpr bool IguaisAPartirDe(const Matriz4& A, const Matriz4& B, int i)
+{
+    return i == 16 || (A.m[i] == B.m[i] && IguaisAPartirDe(A, B, i + 1));
+}
+
+constexpr bool operator==(const Matriz4& A, const Matriz4& B)
+{
+    return IguaisAPartirDe(A, B, 0);
+}
+
+// Produto M*v de uma matriz por um vetor (ou ponto) em coordenadas homogêneas
+inline glm::vec4 operator*(const Matriz4& M, const glm::vec4& v)
+{
+    return glm::vec4(
+        M(0,0)*v.x + M(0,1)*v.y + M(0,2)*v.z + M(0,3)*v.w,
+        M(1,0)*v.x + M(1,1)*v.y + M(1,2)*v.z + M(1,3)*v.w,
+        M(2,0)*v.x + M(2,1)*v.y + M(2,2)*v.z + M(2,3)*v.w,
+        M(3,0)*v.x + M(3,1)*v.y + M(3,2)*v.z + M(3,3)*v.w
+    );
+}
+
 // Matriz identidade.
-glm::mat4 Matrix_Identity()
+constexpr Matriz4 Matrix_Identity()
 {
     return Matrix(
         1.0f , 0.0f , 0.0f , 0.0f , // LINHA 1
@@ -59,7 +157,7 @@ glm::mat4 Matrix_Identity()
 //
 //     T*p = p+t.
 //
-glm::mat4 Matrix_Translate(float tx, float ty, float tz)
+constexpr Matriz4 Matrix_Translate(float tx, float ty, float tz)
 {
     return Matrix(
         // PREENCHA AQUI A MATRIZ DE TRANSLAÇÃO (3D) EM COORD. HOMOGÊNEAS
@@ -77,7 +175,7 @@ glm::mat4 Matrix_Translate(float tx, float ty, float tz)
 //
 //     S*p = [sx*px, sy*py, sz*pz, pw].
 //
-glm::mat4 Matrix_Scale(float sx, float sy, float sz)
+constexpr Matriz4 Matrix_Scale(float sx, float sy, float sz)
 {
     return Matrix(
         // PREENCHA AQUI A MATRIZ DE ESCALAMENTO (3D) EM COORD. HOMOGÊNEAS
@@ -97,20 +195,25 @@ glm::mat4 Matrix_Scale(float sx, float sy, float sz)
 //   R*p = [ px, c*py-s*pz, s*py+c*pz, pw ];
 //
 // onde 'c' e 's' são o cosseno e o seno do ângulo de rotação, respectivamente.
-glm::mat4 Matrix_Rotate_X(float angle)
+// cos() e sin() não são constexpr; para ângulos conhecidos em tempo de
+// compilação, passe 'c' e 's' já calculados.
+constexpr Matriz4 Matrix_Rotate_X(float c, float s)
 {
-    float c = cos(angle);
-    float s = sin(angle);
     return Matrix(
         // PREENCHA AQUI A MATRIZ DE ROTAÇÃO (3D) EM TORNO DO EIXO X EM COORD.
         // HOMOGÊNEAS, UTILIZANDO OS PARÂMETROS c e s
         1.0f , 0.0f , 0.0f , 0.0f ,  // LINHA 1
-        0.0f , cos(angle) , -sin(angle) , 0.0f ,  // LINHA 2
-        0.0f , sin(angle) , cos(angle) , 0.0f ,  // LINHA 3
+        0.0f , c , -s , 0.0f ,  // LINHA 2
+        0.0f , s , c , 0.0f ,  // LINHA 3
         0.0f , 0.0f , 0.0f , 1.0f    // LINHA 4
     );
 }
 
+inline Matriz4 Matrix_Rotate_X(float angle)
+{
+    return Matrix_Rotate_X(cos(angle), sin(angle));
+}
+
 // Matriz R de "rotação de um ponto" em relação à origem do sistema de
 // coordenadas e em torno do eixo Y (segundo vetor da base do sistema de
 // coordenadas). Seja p=[px,py,pz,pw] um ponto em coordenadas homogêneas.
@@ -119,20 +222,31 @@ glm::mat4 Matrix_Rotate_X(float angle)
 //   R*p = [ c*px+s*pz, py, -s*px+c*pz, pw ];
 //
 // onde 'c' e 's' são o cosseno e o seno do ângulo de rotação, respectivamente.
-glm::mat4 Matrix_Rotate_Y(float angle)
+constexpr Matriz4 Matrix_Rotate_Y(float c, float s)
 {
-    float c = cos(angle);
-    float s = sin(angle);
     return Matrix(
         // PREENCHA AQUI A MATRIZ DE ROTAÇÃO (3D) EM TORNO DO EIXO Y EM COORD.
         // HOMOGÊNEAS, UTILIZANDO OS PARÂMETROS c e s
-        cos(angle) , 0.0f , sin(angle) , 0.0f ,  // LINHA 1
+        c , 0.0f , s , 0.0f ,  // LINHA 1
         0.0f , 1.0f , 0.0f , 0.0f ,  // LINHA 2
-        -sin(angle) , 0.0f , cos(angle) , 0.0f ,  // LINHA 3
+        -s , 0.0f , c , 0.0f ,  // LINHA 3
         0.0f , 0.0f , 0.0f , 1.0f    // LINHA 4
     );
 }
 
+inline Matriz4 Matrix_Rotate_Y(float angle)
+{
+    return Matrix_Rotate_Y(cos(angle), sin(angle));
+}
+
+// Rotação Ry de cosseno c e seno s aplicada "vezes" vezes sobre M, isto é,
+// Ry*Ry*...*Ry*M. Serve para dobrar em tempo de compilação uma sequência de
+// giros de passo fixo, como os de Carro::turnRight().
+constexpr Matriz4 Matrix_Rotate_Y_Repetida(float c, float s, int vezes, const Matriz4& M)
+{
+    return vezes == 0 ? M : Matrix_Rotate_Y_Repetida(c, s, vezes - 1, Matrix_Rotate_Y(c, s) * M);
+}
+
 // Matriz R de "rotação de um ponto" em relação à origem do sistema de
 // coordenadas e em torno do eixo Z (terceiro vetor da base do sistema de
 // coordenadas). Seja p=[px,py,pz,pw] um ponto em coordenadas homogêneas.
@@ -141,23 +255,26 @@ glm::mat4 Matrix_Rotate_Y(float angle)
 //   R*p = [ c*px-s*py, s*px+c*py, pz, pw ];
 //
 // onde 'c' e 's' são o cosseno e o seno do ângulo de rotação, respectivamente.
-glm::mat4 Matrix_Rotate_Z(float angle)
+constexpr Matriz4 Matrix_Rotate_Z(float c, float s)
 {
-    float c = cos(angle);
-    float s = sin(angle);
     return Matrix(
         // PREENCHA AQUI A MATRIZ DE ROTAÇÃO (3D) EM TORNO DO EIXO Z EM COORD.
         // HOMOGÊNEAS, UTILIZANDO OS PARÂMETROS c e s
-        cos(angle) , -sin(angle) , 0.0f , 0.0f ,  // LINHA 1
-        sin(angle) , cos(angle) , 0.0f , 0.0f ,  // LINHA 2
+        c , -s , 0.0f , 0.0f ,  // LINHA 1
+        s , c , 0.0f , 0.0f ,  // LINHA 2
         0.0f , 0.0f , 1.0f , 0.0f ,  // LINHA 3
         0.0f , 0.0f , 0.0f , 1.0f    // LINHA 4
     );
 }
 
+inline Matriz4 Matrix_Rotate_Z(float angle)
+{
+    return Matrix_Rotate_Z(cos(angle), sin(angle));
+}
+
 // Função que calcula a norma Euclidiana de um vetor cujos coeficientes são
 // definidos em uma base ortonormal qualquer.
-float norm(glm::vec4 v)
+inline float norm(glm::vec4 v)
 {
     float vx = v.x;
     float vy = v.y;
@@ -170,7 +287,7 @@ float norm(glm::vec4 v)
 // coordenadas e em torno do eixo definido pelo vetor 'axis'. Esta matriz pode
 // ser definida pela fórmula de Rodrigues. Lembre-se que o vetor que define o
 // eixo de rotação deve ser normalizado!
-glm::mat4 Matrix_Rotate(float angle, glm::vec4 axis)
+inline glm::mat4 Matrix_Rotate(float angle, glm::vec4 axis)
 {
     float c = cos(angle);
     float s = sin(angle);
@@ -191,9 +308,107 @@ glm::mat4 Matrix_Rotate(float angle, glm::vec4 axis)
     );
 }
 
+#if defined(MATRICES_AVX) || defined(MATRICES_SSE2)
+// a + b*c, em uma instrução só quando a CPU tem FMA
+static inline __m128 MultiplicaSoma(__m128 a, __m128 b, __m128 c)
+{
+#if defined(__FMA__)
+    return _mm_fmadd_ps(b, c, a);
+#else
+    return _mm_add_ps(a, _mm_mul_ps(b, c));
+#endif
+}
+#endif
+
+#if defined(MATRICES_AVX)
+static inline __m256 MultiplicaSoma(__m256 a, __m256 b, __m256 c)
+{
+#if defined(__FMA__)
+    return _mm256_fmadd_ps(b, c, a);
+#else
+    return _mm256_add_ps(a, _mm256_mul_ps(b, c));
+#endif
+}
+
+// A mesma coluna nas duas metades de um registrador de 256 bits
+static inline __m256 DuplicaColuna(const float* coluna)
+{
+    const __m128 c = _mm_loadu_ps(coluna);
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(c), c, 1);
+}
+#endif
+
+// Produto de matrizes A*B, o mesmo de "A * B" da GLM. Cada coluna do
+// resultado é a combinação das colunas de A com os coeficientes da coluna de
+// mesmo índice de B: com SSE, uma coluna por vez; com AVX, duas colunas por
+// vez, uma em cada metade do registrador.
+inline glm::mat4 Matrix_Multiply(const glm::mat4& A, const glm::mat4& B)
+{
+#if defined(MATRICES_AVX)
+    const float* a = &A[0][0];
+    const float* b = &B[0][0];
+    glm::mat4 R(glm::uninitialize);
+    float* r = &R[0][0];
+
+    const __m256 a0 = DuplicaColuna(a + 0);
+    const __m256 a1 = DuplicaColuna(a + 4);
+    const __m256 a2 = DuplicaColuna(a + 8);
+    const __m256 a3 = DuplicaColuna(a + 12);
+    for (int j = 0; j < 4; j += 2)
+    {
+        const __m256 bj = _mm256_loadu_ps(b + 4*j); // Colunas j e j+1 de B
+        __m256 rj = _mm256_mul_ps(a0, _mm256_permute_ps(bj, _MM_SHUFFLE(0,0,0,0)));
+        rj = MultiplicaSoma(rj, a1, _mm256_permute_ps(bj, _MM_SHUFFLE(1,1,1,1)));
+        rj = MultiplicaSoma(rj, a2, _mm256_permute_ps(bj, _MM_SHUFFLE(2,2,2,2)));
+        rj = MultiplicaSoma(rj, a3, _mm256_permute_ps(bj, _MM_SHUFFLE(3,3,3,3)));
+        _mm256_storeu_ps(r + 4*j, rj);
+    }
+    return R;
+#elif defined(MATRICES_SSE2)
+    const float* a = &A[0][0];
+    const float* b = &B[0][0];
+    glm::mat4 R(glm::uninitialize);
+    float* r = &R[0][0];
+
+    const __m128 a0 = _mm_loadu_ps(a + 0);
+    const __m128 a1 = _mm_loadu_ps(a + 4);
+    const __m128 a2 = _mm_loadu_ps(a + 8);
+    const __m128 a3 = _mm_loadu_ps(a + 12);
+    for (int j = 0; j < 4; ++j)
+    {
+        const __m128 bj = _mm_loadu_ps(b + 4*j);
+        __m128 rj = _mm_mul_ps(a0, _mm_shuffle_ps(bj, bj, _MM_SHUFFLE(0,0,0,0)));
+        rj = MultiplicaSoma(rj, a1, _mm_shuffle_ps(bj, bj, _MM_SHUFFLE(1,1,1,1)));
+        rj = MultiplicaSoma(rj, a2, _mm_shuffle_ps(bj, bj, _MM_SHUFFLE(2,2,2,2)));
+        rj = MultiplicaSoma(rj, a3, _mm_shuffle_ps(bj, bj, _MM_SHUFFLE(3,3,3,3)));
+        _mm_storeu_ps(r + 4*j, rj);
+    }
+    return R;
+#else
+    return A * B;
+#endif
+}
+
+// Produto M*v de uma matriz por um vetor (ou ponto) em coordenadas homogêneas
+inline glm::vec4 Matrix_Multiply_Vector(const glm::mat4& M, glm::vec4 v)
+{
+#if defined(MATRICES_AVX) || defined(MATRICES_SSE2)
+    const float* m = &M[0][0];
+    __m128 r = _mm_mul_ps(_mm_loadu_ps(m + 0), _mm_set1_ps(v.x));
+    r = MultiplicaSoma(r, _mm_loadu_ps(m + 4), _mm_set1_ps(v.y));
+    r = MultiplicaSoma(r, _mm_loadu_ps(m + 8), _mm_set1_ps(v.z));
+    r = MultiplicaSoma(r, _mm_loadu_ps(m + 12), _mm_set1_ps(v.w));
+    glm::vec4 resultado(glm::uninitialize);
+    _mm_storeu_ps(&resultado[0], r);
+    return resultado;
+#else
+    return M * v;
+#endif
+}
+
 // Produto vetorial entre dois vetores u e v definidos em um sistema de
 // coordenadas ortonormal.
-glm::vec4 crossproduct(glm::vec4 u, glm::vec4 v)
+inline glm::vec4 crossproduct(glm::vec4 u, glm::vec4 v)
 {
     float u1 = u.x;
     float u2 = u.y;
@@ -212,7 +427,7 @@ glm::vec4 crossproduct(glm::vec4 u, glm::vec4 v)
 
 // Produto escalar entre dois vetores u e v definidos em um sistema de
 // coordenadas ortonormal.
-float dotproduct(glm::vec4 u, glm::vec4 v)
+inline float dotproduct(glm::vec4 u, glm::vec4 v)
 {
     float u1 = u.x;
     float u2 = u.y;
@@ -233,7 +448,7 @@ float dotproduct(glm::vec4 u, glm::vec4 v)
 }
 
 // Matriz de mudança de coordenadas para o sistema de coordenadas da Câmera.
-glm::mat4 Matrix_Camera_View(glm::vec4 position_c, glm::vec4 view_vector, glm::vec4 up_vector)
+inline glm::mat4 Matrix_Camera_View(glm::vec4 position_c, glm::vec4 view_vector, glm::vec4 up_vector)
 {
     glm::vec4 w = -view_vector;
     glm::vec4 u = crossproduct(up_vector, w);
@@ -274,9 +489,9 @@ glm::mat4 Matrix_Camera_View(glm::vec4 position_c, glm::vec4 view_vector, glm::v
 }
 
 // Matriz de projeção paralela ortográfica
-glm::mat4 Matrix_Orthographic(float l, float r, float b, float t, float n, float f)
+constexpr Matriz4 Matrix_Orthographic(float l, float r, float b, float t, float n, float f)
 {
-    glm::mat4 M = Matrix(
+    return Matrix(
         // PREENCHA AQUI A MATRIZ M DE PROJEÇÃO ORTOGRÁFICA (3D) UTILIZANDO OS
         // PARÂMETROS l,r,b,t,n,f
         2/(r-l) , 0.0f , 0.0f , -(r+l)/(r-l) ,  // LINHA 1
@@ -284,30 +499,14 @@ glm::mat4 Matrix_Orthographic(float l, float r, float b, float t, float n, float
         0.0f , 0.0f , 2/(f-n) , -(f+n)/(f-n) ,  // LINHA 3
         0.0f , 0.0f , 0.0f , 1.0f    // LINHA 4
     );
-
-    return M;
 }
 
-// Matriz de projeção perspectiva
-glm::mat4 Matrix_Perspective(float field_of_view, float aspect, float n, float f)
+// Matriz de projeção perspectiva com o "near plane" de meia altura t e meia
+// largura t*aspect. Veja Matrix_Perspective_Tangente() abaixo.
+constexpr Matriz4 Matrix_Perspective_Limites(float t, float aspect, float n, float f)
 {
-    float t = fabs(n) * tanf(field_of_view / 2.0f);
-    float b = -t;
-    float r = t * aspect;
-    float l = -r;
-
-    glm::mat4 P = Matrix(
-        // PREENCHA AQUI A MATRIZ P DE PROJEÇÃO PERSPECTIVA (3D) UTILIZANDO OS
-        // PARÂMETROS n e f.
-        n , 0.0f , 0.0f , 0.0f ,  // LINHA 1
-        0.0f , n , 0.0f , 0.0f ,  // LINHA 2
-        0.0f , 0.0f , n+f , -f*n ,  // LINHA 3
-        0.0f , 0.0f , 1.0f , 0.0f    // LINHA 4
-    );
-
     // A matriz M é a mesma computada acima em Matrix_Orthographic().
-    glm::mat4 M = Matrix_Orthographic(l, r, b, t, n, f);
-
+    //
     // Note que as matrizes M*P e -M*P fazem exatamente a mesma projeção
     // perspectiva, já que o sinal de negativo não irá afetar o resultado
     // devido à divisão por w. Por exemplo, seja q = [qx,qy,qz,1] um ponto:
@@ -342,11 +541,32 @@ glm::mat4 Matrix_Perspective(float field_of_view, float aspect, float n, float f
     // precisamos utilizar a matriz -M*P para projeção perspectiva, de forma que
     // w seja positivo.
     //
-    return -M*P;
+    return -(Matrix_Orthographic(-t*aspect, t*aspect, -t, t, n, f) * Matrix(
+        // PREENCHA AQUI A MATRIZ P DE PROJEÇÃO PERSPECTIVA (3D) UTILIZANDO OS
+        // PARÂMETROS n e f.
+        n , 0.0f , 0.0f , 0.0f ,  // LINHA 1
+        0.0f , n , 0.0f , 0.0f ,  // LINHA 2
+        0.0f , 0.0f , n+f , -f*n ,  // LINHA 3
+        0.0f , 0.0f , 1.0f , 0.0f    // LINHA 4
+    ));
+}
+
+// Matriz de projeção perspectiva a partir da tangente da metade do campo de
+// visão. tan() não é constexpr; com a tangente já calculada, a projeção de
+// near/far/FOV constantes sai em tempo de compilação.
+constexpr Matriz4 Matrix_Perspective_Tangente(float tangente_meio_fov, float aspect, float n, float f)
+{
+    return Matrix_Perspective_Limites((n < 0.0f ? -n : n) * tangente_meio_fov, aspect, n, f);
+}
+
+// Matriz de projeção perspectiva
+inline Matriz4 Matrix_Perspective(float field_of_view, float aspect, float n, float f)
+{
+    return Matrix_Perspective_Tangente(tanf(field_of_view / 2.0f), aspect, n, f);
 }
 
 // Função que imprime uma matriz M no terminal
-void PrintMatrix(glm::mat4 M)
+inline void PrintMatrix(glm::mat4 M)
 {
     printf("\n");
     printf("[ %+0.2f  %+0.2f  %+0.2f  %+0.2f ]\n", M[0][0], M[1][0], M[2][0], M[3][0]);
@@ -356,7 +576,7 @@ void PrintMatrix(glm::mat4 M)
 }
 
 // Função que imprime um vetor v no terminal
-void PrintVector(glm::vec4 v)
+inline void PrintVector(glm::vec4 v)
 {
     printf("\n");
     printf("[ %+0.2f ]\n", v[0]);
@@ -366,7 +586,7 @@ void PrintVector(glm::vec4 v)
 }
 
 // Função que imprime o produto de uma matriz por um vetor no terminal
-void PrintMatrixVectorProduct(glm::mat4 M, glm::vec4 v)
+inline void PrintMatrixVectorProduct(glm::mat4 M, glm::vec4 v)
 {
     auto r = M*v;
     printf("\n");
@@ -378,7 +598,7 @@ void PrintMatrixVectorProduct(glm::mat4 M, glm::vec4 v)
 
 // Função que imprime o produto de uma matriz por um vetor, junto com divisão
 // por w, no terminal.
-void PrintMatrixVectorProductDivW(glm::mat4 M, glm::vec4 v)
+inline void PrintMatrixVectorProductDivW(glm::mat4 M, glm::vec4 v)
 {
     auto r = M*v;
     auto w = r[3];
@@ -389,6 +609,36 @@ void PrintMatrixVectorProductDivW(glm::mat4 M, glm::vec4 v)
     printf("[ %+0.2f  %+0.2f  %+0.2f  %+0.2f ][ %+0.2f ]   [ %+0.2f ]            [ %+0.2f ]\n", M[0][3], M[1][3], M[2][3], M[3][3], v[3], r[3], r[3]/w);
 }
 
+// Verificações em tempo de compilação das funções constexpr acima: se alguma
+// delas deixar de ser constexpr, ou errar a conta, nada que inclua este
+// arquivo compila. Os valores escolhidos são exatos em float.
+static_assert(Matrix(1,2,3,4, 5,6,7,8, 9,10,11,12, 13,14,15,16)(0,3) == 4.0f &&
+              Matrix(1,2,3,4, 5,6,7,8, 9,10,11,12, 13,14,15,16).m[3] == 13.0f,
+              "Matrix() recebe LINHAS e guarda COLUNAS");
+static_assert(Matrix_Identity() * Matrix_Translate(1,2,3) == Matrix_Translate(1,2,3),
+              "I*T == T");
+static_assert(Matrix_Translate(1,2,3) * Matrix_Translate(-1,-2,-3) == Matrix_Identity(),
+              "T(t)*T(-t) == I");
+static_assert(Matrix_Scale(2,4,8) * Matrix_Scale(0.5f,0.25f,0.125f) == Matrix_Identity(),
+              "S(s)*S(1/s) == I");
+static_assert(Matrix_Translate(1,2,3) * Matrix_Scale(2,2,2) == Matrix(
+                  2.0f , 0.0f , 0.0f , 1.0f ,  // LINHA 1
+                  0.0f , 2.0f , 0.0f , 2.0f ,  // LINHA 2
+                  0.0f , 0.0f , 2.0f , 3.0f ,  // LINHA 3
+                  0.0f , 0.0f , 0.0f , 1.0f    // LINHA 4
+              ), "T*S escala e depois translada");
+static_assert(Matrix_Rotate_Z(0,1)(1,0) == 1.0f && Matrix_Rotate_Z(0,1)(0,1) == -1.0f,
+              "Rz de 90 graus leva X em Y e Y em -X");
+static_assert(Matrix_Rotate_X(0,1) * Matrix_Rotate_X(0,-1) == Matrix_Identity(),
+              "Rx(a)*Rx(-a) == I");
+static_assert(Matrix_Rotate_Y_Repetida(0,1,4,Matrix_Identity()) == Matrix_Identity(),
+              "quatro giros de 90 graus em torno de Y voltam à identidade");
+static_assert(Matrix_Perspective_Tangente(1.0f, 1.0f, -1.0f, -3.0f) == Matrix(
+                  1.0f , 0.0f ,  0.0f ,  0.0f ,  // LINHA 1
+                  0.0f , 1.0f ,  0.0f ,  0.0f ,  // LINHA 2
+                  0.0f , 0.0f , -2.0f , -3.0f ,  // LINHA 3
+                  0.0f , 0.0f , -1.0f ,  0.0f    // LINHA 4
+              ), "-M*P com FOV de 90 graus, near -1 e far -3");
 
 #endif // _MATRICES_H
 // vim: set spell spelllang=pt_br :
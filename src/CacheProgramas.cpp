@@ -0,0 +1,387 @@
+#include "CacheProgramas.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <GLFW/glfw3.h>
+
+CacheProgramas g_CacheProgramas;
+
+// Constantes e funções do OpenGL 4.1 que o glad (3.3) não declara
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+typedef void (APIENTRYP FuncaoGetProgramBinary)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+typedef void (APIENTRYP FuncaoProgramBinary)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void (APIENTRYP FuncaoProgramParameteri)(GLuint program, GLenum pname, GLint value);
+typedef void (APIENTRYP FuncaoMaxShaderCompilerThreads)(GLuint count);
+
+static FuncaoGetProgramBinary GetProgramBinary = NULL;
+static FuncaoProgramBinary ProgramBinary = NULL;
+static FuncaoProgramParameteri ProgramParameteri = NULL;
+
+// Cabeçalho do arquivo .programa; o binário do driver vem logo depois.
+struct CabecalhoPrograma
+{
+    char magica[4];
+    uint32_t versao;
+    uint64_t chave;
+    uint32_t formato;  // binaryFormat de glGetProgramBinary()
+    uint32_t tamanho;
+};
+
+static const char MAGICA_PROGRAMA[4] = { 'P', 'P', 'R', 'G' };
+static const uint32_t VERSAO_PROGRAMA = 1;
+
+// FNV-1a de 64 bits, como HashNome() em CenaVirtual.h
+static uint64_t Hash(uint64_t hash, const std::string& texto)
+{
+    for (size_t i = 0; i < texto.size(); ++i)
+    {
+        hash ^= (unsigned char)texto[i];
+        hash *= 1099511628211ull;
+    }
+    // Separa os textos: "ab" + "c" não pode ter o hash de "a" + "bc"
+    hash ^= 0xFF;
+    return hash * 1099511628211ull;
+}
+
+static bool TemExtensao(const char* extensao)
+{
+    GLint num_extensoes = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &num_extensoes);
+    for (GLint i = 0; i < num_extensoes; ++i)
+    {
+        const char* nome = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (nome && strcmp(nome, extensao) == 0)
+            return true;
+    }
+    return false;
+}
+
+static std::string TextoGL(GLenum nome)
+{
+    const GLubyte* texto = glGetString(nome);
+    return texto ? std::string((const char*)texto) : std::string();
+}
+
+// Dispara a compilação de um shader GLSL; o resultado é lido depois, por
+// ImprimeLogShader()
+static GLuint CompilaShader(GLenum tipo, const std::string& fonte)
+{
+    GLuint shader_id = glCreateShader(tipo);
+
+    const GLchar* shader_string = fonte.c_str();
+    const GLint   shader_string_length = static_cast<GLint>( fonte.length() );
+    glShaderSource(shader_id, 1, &shader_string, &shader_string_length);
+    glCompileShader(shader_id);
+    return shader_id;
+}
+
+// Imprime no terminal qualquer erro ou "warning" de compilação
+static void ImprimeLogShader(GLuint shader_id, GLenum tipo, const char* nome)
+{
+    GLint compiled_ok;
+    glGetShaderiv(shader_id, GL_COMPILE_STATUS, &compiled_ok);
+
+    GLint log_length = 0;
+    glGetShaderiv(shader_id, GL_INFO_LOG_LENGTH, &log_length);
+    if ( log_length > 1 )
+    {
+        std::vector<GLchar> log(log_length);
+        glGetShaderInfoLog(shader_id, log_length, &log_length, log.data());
+
+        fprintf(stderr, "%s: OpenGL compilation of the %s shader of \"%s\"%s\n"
+                        "== Start of compilation log\n%s== End of compilation log\n",
+                compiled_ok ? "WARNING" : "ERROR", tipo == GL_VERTEX_SHADER ? "vertex" : "fragment", nome,
+                compiled_ok ? "." : " failed.", log.data());
+    }
+}
+
+// Imprime no terminal qualquer erro de linkagem
+static bool ConfereLink(GLuint program_id, const char* nome)
+{
+    GLint linked_ok = GL_FALSE;
+    glGetProgramiv(program_id, GL_LINK_STATUS, &linked_ok);
+    if ( linked_ok == GL_FALSE )
+    {
+        GLint log_length = 0;
+        glGetProgramiv(program_id, GL_INFO_LOG_LENGTH, &log_length);
+
+        std::vector<GLchar> log(log_length > 0 ? log_length : 1, '\0');
+        glGetProgramInfoLog(program_id, (GLsizei)log.size(), NULL, log.data());
+
+        fprintf(stderr, "ERROR: OpenGL linking of program \"%s\" failed.\n"
+                        "== Start of link log\n%s\n== End of link log\n", nome, log.data());
+        return false;
+    }
+    return true;
+}
+
+CacheProgramas::CacheProgramas()
+{
+    usa_binarios = false;
+    compilacao_paralela = false;
+    carregados = 0;
+    compilados = 0;
+}
+
+CacheProgramas::~CacheProgramas()
+{
+    //dtor
+}
+
+void CacheProgramas::inicializa(const char* dir)
+{
+    diretorio = dir;
+    driver = TextoGL(GL_VENDOR) + "\n" + TextoGL(GL_RENDERER) + "\n" + TextoGL(GL_VERSION) + "\n"
+           + TextoGL(GL_SHADING_LANGUAGE_VERSION);
+
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    if (major > 4 || (major == 4 && minor >= 1) || TemExtensao("GL_ARB_get_program_binary"))
+    {
+        GetProgramBinary = (FuncaoGetProgramBinary)glfwGetProcAddress("glGetProgramBinary");
+        ProgramBinary = (FuncaoProgramBinary)glfwGetProcAddress("glProgramBinary");
+        ProgramParameteri = (FuncaoProgramParameteri)glfwGetProcAddress("glProgramParameteri");
+    }
+
+    // Um driver pode ter as funções e não aceitar nenhum formato
+    GLint num_formatos = 0;
+    if (GetProgramBinary && ProgramBinary && ProgramParameteri)
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formatos);
+    usa_binarios = num_formatos > 0;
+
+    // O driver escolhe quantas threads usar para compilar
+    FuncaoMaxShaderCompilerThreads MaxShaderCompilerThreads = NULL;
+    if (TemExtensao("GL_KHR_parallel_shader_compile"))
+        MaxShaderCompilerThreads = (FuncaoMaxShaderCompilerThreads)glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+    else if (TemExtensao("GL_ARB_parallel_shader_compile"))
+        MaxShaderCompilerThreads = (FuncaoMaxShaderCompilerThreads)glfwGetProcAddress("glMaxShaderCompilerThreadsARB");
+    if (MaxShaderCompilerThreads)
+    {
+        MaxShaderCompilerThreads(0xFFFFFFFFu);
+        compilacao_paralela = true;
+    }
+}
+
+bool CacheProgramas::ativo() const
+{
+    return usa_binarios;
+}
+
+unsigned int CacheProgramas::getCarregados() const
+{
+    return carregados;
+}
+
+unsigned int CacheProgramas::getCompilados() const
+{
+    return compilados;
+}
+
+uint64_t CacheProgramas::chave(const std::string& fonte_vertex, const std::string& fonte_fragment) const
+{
+    uint64_t hash = 14695981039346656037ull;
+    hash = Hash(hash, driver);
+    hash = Hash(hash, fonte_vertex);
+    return Hash(hash, fonte_fragment);
+}
+
+std::string CacheProgramas::caminho(const char* nome) const
+{
+    if (diretorio.empty())
+        return std::string(nome) + ".programa";
+    return diretorio + "/" + nome + ".programa";
+}
+
+// Devolve 0 se não há arquivo, se ele é de outra chave ou se o driver o recusa
+GLuint CacheProgramas::carrega(const std::string& arquivo, uint64_t chave_programa) const
+{
+    FILE* entrada = fopen(arquivo.c_str(), "rb");
+    if (!entrada)
+        return 0;
+
+    CabecalhoPrograma cabecalho;
+    std::vector<char> binario;
+    bool ok = fread(&cabecalho, sizeof(cabecalho), 1, entrada) == 1
+           && memcmp(cabecalho.magica, MAGICA_PROGRAMA, sizeof(MAGICA_PROGRAMA)) == 0
+           && cabecalho.versao == VERSAO_PROGRAMA
+           && cabecalho.chave == chave_programa
+           && cabecalho.tamanho > 0;
+    if (ok)
+    {
+        binario.resize(cabecalho.tamanho);
+        ok = fread(binario.data(), 1, binario.size(), entrada) == binario.size();
+    }
+    fclose(entrada);
+    if (!ok)
+        return 0;
+
+    GLuint program_id = glCreateProgram();
+    ProgramBinary(program_id, (GLenum)cabecalho.formato, binario.data(), (GLsizei)binario.size());
+
+    GLint linked_ok = GL_FALSE;
+    glGetProgramiv(program_id, GL_LINK_STATUS, &linked_ok);
+    if (linked_ok == GL_FALSE)
+    {
+        glDeleteProgram(program_id);
+        // Um formato desconhecido gera GL_INVALID_ENUM; o erro é esperado
+        // aqui e não deve aparecer no próximo glCheckError()
+        while (glGetError() != GL_NO_ERROR)
+            ;
+        return 0;
+    }
+    return program_id;
+}
+
+void CacheProgramas::salva(const std::string& arquivo, uint64_t chave_programa, GLuint program_id) const
+{
+    GLint tamanho = 0;
+    glGetProgramiv(program_id, GL_PROGRAM_BINARY_LENGTH, &tamanho);
+    if (tamanho <= 0)
+        return;
+
+    std::vector<char> conteudo(sizeof(CabecalhoPrograma) + (size_t)tamanho);
+    GLsizei escritos = 0;
+    GLenum formato = 0;
+    GetProgramBinary(program_id, tamanho, &escritos, &formato, conteudo.data() + sizeof(CabecalhoPrograma));
+    if (escritos <= 0)
+        return;
+
+    CabecalhoPrograma cabecalho;
+    memcpy(cabecalho.magica, MAGICA_PROGRAMA, sizeof(MAGICA_PROGRAMA));
+    cabecalho.versao = VERSAO_PROGRAMA;
+    cabecalho.chave = chave_programa;
+    cabecalho.formato = (uint32_t)formato;
+    cabecalho.tamanho = (uint32_t)escritos;
+    memcpy(conteudo.data(), &cabecalho, sizeof(cabecalho));
+    conteudo.resize(sizeof(CabecalhoPrograma) + (size_t)escritos);
+
+    // Sem o cache o jogo só demora mais para abrir: falhas são avisos
+    FILE* saida = fopen(arquivo.c_str(), "wb");
+    if (!saida)
+    {
+        fprintf(stderr, "WARNING: Cannot write program cache \"%s\".\n", arquivo.c_str());
+        return;
+    }
+    bool ok = fwrite(conteudo.data(), 1, conteudo.size(), saida) == conteudo.size();
+    ok = fclose(saida) == 0 && ok;
+    if (!ok)
+    {
+        fprintf(stderr, "WARNING: Failed writing program cache \"%s\".\n", arquivo.c_str());
+        remove(arquivo.c_str());
+    }
+}
+
+CriacaoPrograma CacheProgramas::inicia(const char* nome, const std::string& fonte_vertex, const std::string& fonte_fragment)
+{
+    CriacaoPrograma criacao;
+    criacao.nome = nome;
+    criacao.chave = chave(fonte_vertex, fonte_fragment);
+    criacao.vertex_shader_id = 0;
+    criacao.fragment_shader_id = 0;
+
+    if (usa_binarios)
+    {
+        criacao.program_id = carrega(caminho(nome), criacao.chave);
+        if (criacao.program_id != 0)
+            return criacao;
+    }
+
+    criacao.vertex_shader_id = CompilaShader(GL_VERTEX_SHADER, fonte_vertex);
+    criacao.fragment_shader_id = CompilaShader(GL_FRAGMENT_SHADER, fonte_fragment);
+
+    criacao.program_id = glCreateProgram();
+    glAttachShader(criacao.program_id, criacao.vertex_shader_id);
+    glAttachShader(criacao.program_id, criacao.fragment_shader_id);
+    // Sem a dica, o driver pode não guardar o binário para glGetProgramBinary()
+    if (usa_binarios)
+        ProgramParameteri(criacao.program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    // Se um shader não compilou o link falha, e os dois logs são impressos
+    glLinkProgram(criacao.program_id);
+    return criacao;
+}
+
+bool CacheProgramas::pronto(const CriacaoPrograma& criacao) const
+{
+    if (!compilacao_paralela || criacao.vertex_shader_id == 0)
+        return true;
+
+    GLint completo = GL_TRUE;
+    glGetProgramiv(criacao.program_id, GL_COMPLETION_STATUS_KHR, &completo);
+    return completo != GL_FALSE;
+}
+
+bool CacheProgramas::termina(CriacaoPrograma* criacao)
+{
+    if (criacao->vertex_shader_id == 0)
+    {
+        ++carregados;
+        return true;
+    }
+
+    ImprimeLogShader(criacao->vertex_shader_id, GL_VERTEX_SHADER, criacao->nome.c_str());
+    ImprimeLogShader(criacao->fragment_shader_id, GL_FRAGMENT_SHADER, criacao->nome.c_str());
+    bool linked_ok = ConfereLink(criacao->program_id, criacao->nome.c_str());
+
+    // O programa linkado não precisa mais dos shaders
+    glDetachShader(criacao->program_id, criacao->vertex_shader_id);
+    glDetachShader(criacao->program_id, criacao->fragment_shader_id);
+    glDeleteShader(criacao->vertex_shader_id);
+    glDeleteShader(criacao->fragment_shader_id);
+    criacao->vertex_shader_id = 0;
+    criacao->fragment_shader_id = 0;
+
+    ++compilados;
+    if (linked_ok && usa_binarios)
+        salva(caminho(criacao->nome.c_str()), criacao->chave, criacao->program_id);
+    return linked_ok;
+}
+
+GLuint CacheProgramas::cria(const char* nome, const std::string& fonte_vertex, const std::string& fonte_fragment)
+{
+    CriacaoPrograma criacao = inicia(nome, fonte_vertex, fonte_fragment);
+    termina(&criacao);
+    return criacao.program_id;
+}
+
+bool LeArquivoShader(const char* arquivo, std::string* conteudo)
+{
+    std::ifstream file(arquivo);
+    if (!file)
+        return false;
+    std::stringstream texto;
+    texto << file.rdbuf();
+    *conteudo = texto.str();
+    return true;
+}
+
+GLuint CacheProgramas::criaDeArquivos(const char* nome, const char* arquivo_vertex, const char* arquivo_fragment)
+{
+    std::string fonte_vertex, fonte_fragment;
+    const char* arquivos[2] = { arquivo_vertex, arquivo_fragment };
+    std::string* fontes[2] = { &fonte_vertex, &fonte_fragment };
+    for (int i = 0; i < 2; ++i)
+    {
+        if (!LeArquivoShader(arquivos[i], fontes[i]))
+        {
+            fprintf(stderr, "ERROR: Cannot open file \"%s\".\n", arquivos[i]);
+            std::exit(EXIT_FAILURE);
+        }
+    }
+    return cria(nome, fonte_vertex, fonte_fragment);
+}
@@ -0,0 +1,183 @@
+#include "CarFleet.h"
+#include "Carro.h"
+#include <cmath>
+#include <cstring>
+
+const float CarFleet::VELOCIDADE_PADRAO = 3.0f;
+const float CarFleet::TAXA_GIRO = 6.0f;
+
+// A cada quantos passos recalculamos dir_x/dir_z a partir do ângulo, para que
+// o erro de arredondamento das rotações incrementais não se acumule.
+static const unsigned int PASSOS_ENTRE_RESSINCRONIZACOES = 256;
+
+CarFleet::CarFleet()
+{
+    // Toda matriz de Carro tem a forma T(posicao) * R(angulo) * B * S, com B
+    // rígida e S a escala do modelo, ambas constantes (ver
+    // Simulation::getMatrixInterpolada). Extraímos B de um carro recém-criado
+    // para desenhar a frota com o mesmo modelo.
+    Carro modelo;
+    glm::vec4 p0 = modelo.getPosition();
+    glm::vec4 sentido = modelo.getCameraView();
+    float h0 = atan2f(sentido.x, sentido.z);
+
+    base = Rigida_Compoe(Rigida_RotacaoY(-h0),
+                         Rigida_Compoe(Rigida_Translacao(-glm::vec3(p0)), modelo.getTransformacao()));
+    escala = modelo.getEscala();
+    altura = p0.y;
+    passos = 0;
+
+    pista = NULL;
+    meio_comprimento = modelo.getMeioComprimento();
+    meio_largura = modelo.getMeioLargura();
+}
+
+// Sem pista os carros andam livres.
+void CarFleet::setPista(const Pista* pista)
+{
+    this->pista = pista;
+}
+
+size_t CarFleet::adiciona(float px, float pz, float angulo, float velocidade)
+{
+    x.push_back(px);
+    z.push_back(pz);
+    heading.push_back(angulo);
+    dir_x.push_back(sinf(angulo));
+    dir_z.push_back(cosf(angulo));
+    speed.push_back(velocidade);
+    return x.size() - 1;
+}
+
+void CarFleet::limpa()
+{
+    x.clear();
+    z.clear();
+    heading.clear();
+    dir_x.clear();
+    dir_z.clear();
+    speed.clear();
+    passos = 0;
+}
+
+size_t CarFleet::tamanho() const
+{
+    return x.size();
+}
+
+void CarFleet::ressincronizaDirecoes()
+{
+    const float pi = 3.14159265f;
+    for (size_t i = 0; i < heading.size(); ++i)
+    {
+        float h = heading[i];
+        h = h - 2.0f * pi * floorf((h + pi) / (2.0f * pi));
+        heading[i] = h;
+        dir_x[i] = sinf(h);
+        dir_z[i] = cosf(h);
+    }
+}
+
+// Avança todos os carros em dt segundos, em três laços sobre os arrays:
+// calcula a pose candidata de cada carro, testa as colisões em lote
+// (Pista::testaLote) e aceita ou rejeita cada movimento. Todos giram com a
+// mesma velocidade angular, então o seno e o cosseno do giro são calculados
+// uma vez só e os laços não têm desvios nem chamadas de função: o compilador
+// consegue vetorizá-los.
+void CarFleet::step(float dt, const uint8_t* inputs)
+{
+    const size_t n = x.size();
+    const float giro = TAXA_GIRO * dt;
+    const float c = cosf(giro);
+    const float s = sinf(giro);
+
+    cand_x.resize(n);
+    cand_z.resize(n);
+    cand_dx.resize(n);
+    cand_dz.resize(n);
+    colisao.resize(n);
+    colisao_giro.resize(n);
+
+    float* __restrict px = x.data();
+    float* __restrict pz = z.data();
+    float* __restrict ph = heading.data();
+    float* __restrict pdx = dir_x.data();
+    float* __restrict pdz = dir_z.data();
+    const float* __restrict pv = speed.data();
+    float* __restrict qx = cand_x.data();
+    float* __restrict qz = cand_z.data();
+    float* __restrict qdx = cand_dx.data();
+    float* __restrict qdz = cand_dz.data();
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        const unsigned int e = inputs[i];
+        const float lado = (float)((e >> 2) & 1u) - (float)((e >> 3) & 1u); // +1 esquerda, -1 direita
+        const float avanco = (float)(e & 1u) - (float)((e >> 1) & 1u);      // +1 frente, -1 ré
+
+        // Rotação de um ângulo lado*giro, sem trigonometria por carro
+        const float cg = 1.0f + (lado * lado) * (c - 1.0f);
+        const float sg = lado * s;
+        qdx[i] = cg * pdx[i] + sg * pdz[i];
+        qdz[i] = cg * pdz[i] - sg * pdx[i];
+
+        // Como em Carro, o deslocamento usa o sentido antes do giro
+        const float deslocamento = avanco * pv[i] * dt;
+        qx[i] = px[i] + pdx[i] * deslocamento;
+        qz[i] = pz[i] + pdz[i] * deslocamento;
+    }
+
+    // Pose completa e, para quem bater, só o giro no lugar: um carro encostado
+    // na parede ainda consegue virar para sair dela.
+    if (pista)
+    {
+        pista->testaLote(qx, qz, qdx, qdz, n, meio_comprimento, meio_largura, colisao.data());
+        pista->testaLote(px, pz, qdx, qdz, n, meio_comprimento, meio_largura, colisao_giro.data());
+    }
+    else if (n > 0)
+    {
+        memset(colisao.data(), 0, n);
+        memset(colisao_giro.data(), 0, n);
+    }
+
+    const uint8_t* __restrict bate = colisao.data();
+    const uint8_t* __restrict bate_giro = colisao_giro.data();
+    const unsigned int bloqueio = COLISAO_PAREDE | COLISAO_TRAPACA;
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        const unsigned int e = inputs[i];
+        const float lado = (float)((e >> 2) & 1u) - (float)((e >> 3) & 1u);
+
+        const float move = (bate[i] & bloqueio) ? 0.0f : 1.0f;
+        const float gira = (bate_giro[i] & bloqueio) ? move : 1.0f;
+
+        px[i] += move * (qx[i] - px[i]);
+        pz[i] += move * (qz[i] - pz[i]);
+        pdx[i] += gira * (qdx[i] - pdx[i]);
+        pdz[i] += gira * (qdz[i] - pdz[i]);
+        ph[i] += gira * lado * giro;
+    }
+
+    if (++passos % PASSOS_ENTRE_RESSINCRONIZACOES == 0)
+        ressincronizaDirecoes();
+}
+
+glm::mat4 CarFleet::matrizModelo(size_t i) const
+{
+    glm::mat4 matriz;
+    escreveMatriz(i, &matriz);
+    return matriz;
+}
+
+// T(x, altura, z) * Ry(heading) * B * S, girando B direto a partir do sentido
+void CarFleet::escreveMatriz(size_t i, glm::mat4* destino) const
+{
+    Rigida_EscreveMatrizGiradaY(base, dir_z[i], dir_x[i], glm::vec3(x[i], altura, z[i]), escala, destino);
+}
+
+void CarFleet::calculaMatrizes(glm::mat4* destino) const
+{
+    for (size_t i = 0; i < x.size(); ++i)
+        escreveMatriz(i, &destino[i]);
+}
@@ -0,0 +1,490 @@
+#include "Carregador.h"
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+#include <stb_image.h>
+
+Carregador g_Carregador;
+
+// Tamanho de cada glBufferSubData()/glTexSubImage2D() do envio. Pequeno o
+// bastante para o orçamento de um quadro ser respeitado com folga.
+static const size_t BYTES_POR_BLOCO = 256 * 1024;
+
+static double MilissegundosDesde(std::chrono::steady_clock::time_point inicio)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - inicio).count();
+}
+
+// Atributos de um VBO intercalado no VAO atual, nas locations de
+// "shader_vertex.glsl" (ver VerticeMalha e VerticeCompacto)
+static void DefineAtributos(FormatoVertice formato)
+{
+    GLuint location = 0; // "(location = 0)" em "shader_vertex.glsl"
+    if (formato == VERTICE_COMPACTO)
+    {
+        glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, sizeof(VerticeCompacto), (void*)offsetof(VerticeCompacto, posicao));
+        glEnableVertexAttribArray(location);
+        location = 1; // "(location = 1)" em "shader_vertex.glsl"
+        glVertexAttribPointer(location, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(VerticeCompacto), (void*)offsetof(VerticeCompacto, cor));
+        glEnableVertexAttribArray(location);
+        location = 2; // "(location = 2)" em "shader_vertex.glsl"
+        glVertexAttribPointer(location, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(VerticeCompacto), (void*)offsetof(VerticeCompacto, normal));
+        glEnableVertexAttribArray(location);
+    }
+    else
+    {
+        glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, sizeof(VerticeMalha), (void*)offsetof(VerticeMalha, posicao));
+        glEnableVertexAttribArray(location);
+        location = 1; // "(location = 1)" em "shader_vertex.glsl"
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(VerticeMalha), (void*)offsetof(VerticeMalha, cor));
+        glEnableVertexAttribArray(location);
+        location = 2; // "(location = 2)" em "shader_vertex.glsl"
+        glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, sizeof(VerticeMalha), (void*)offsetof(VerticeMalha, normal));
+        glEnableVertexAttribArray(location);
+    }
+}
+
+static std::string NomeNivel(const char* nome, int nivel)
+{
+    std::string nome_nivel = nome;
+    if (nivel > 0)
+        nome_nivel += "#" + std::to_string(nivel);
+    return nome_nivel;
+}
+
+static void LiberaPixels(void* pixels)
+{
+    if (pixels != NULL)
+        stbi_image_free(pixels);
+}
+
+Carregador::Carregador()
+{
+    cena = NULL;
+    em_andamento = 0;
+    encerrando = false;
+    textura_substituta_id = 0;
+    VBO_substituto_id = 0;
+    EBO_substituto_id = 0;
+}
+
+Carregador::~Carregador()
+{
+    encerra();
+}
+
+void Carregador::inicializa(CenaVirtual* cena_virtual, int num_threads)
+{
+    cena = cena_virtual;
+    criaSubstituto();
+
+    // A stb_image desta versão guarda a opção em uma variável global: ela é
+    // definida antes de as threads existirem
+    stbi_set_flip_vertically_on_load(true);
+
+    if (num_threads <= 0)
+        num_threads = std::max((int)std::thread::hardware_concurrency() - 1, 1);
+    encerrando = false;
+    for (int i = 0; i < num_threads; ++i)
+        threads.push_back(std::thread(&Carregador::trabalha, this));
+}
+
+void Carregador::encerra()
+{
+    {
+        std::lock_guard<std::mutex> trava(mutex);
+        encerrando = true;
+    }
+    condicao.notify_all();
+    for (size_t i = 0; i < threads.size(); ++i)
+        threads[i].join();
+    threads.clear();
+
+    // Os objetos de OpenGL já enviados ficam com o contexto, que pode nem
+    // existir mais; só a memória de CPU é liberada
+    std::deque<Tarefa*>* filas[3] = { &fila, &prontos, &enviando };
+    for (int f = 0; f < 3; ++f)
+    {
+        for (size_t i = 0; i < filas[f]->size(); ++i)
+        {
+            LiberaPixels((*filas[f])[i]->pixels);
+            delete (*filas[f])[i];
+        }
+        filas[f]->clear();
+    }
+    em_andamento = 0;
+}
+
+GLuint Carregador::carregaTextura(const char* arquivo, GLuint unidade)
+{
+    Tarefa* tarefa = new Tarefa();
+    tarefa->tipo = TAREFA_TEXTURA;
+    tarefa->arquivo = arquivo;
+    tarefa->nome = NULL;
+    tarefa->pedido = std::chrono::steady_clock::now();
+    tarefa->ok = false;
+    tarefa->unidade = unidade;
+    tarefa->pixels = NULL;
+    tarefa->enviados = 0;
+
+    GLuint sampler_id;
+    glGenTextures(1, &tarefa->texture_id);
+    glGenSamplers(1, &sampler_id);
+
+    // Veja slide 160 do documento "Aula_20_e_21_Mapeamento_de_Texturas.pdf"
+    glSamplerParameteri(sampler_id, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glSamplerParameteri(sampler_id, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glSamplerParameteri(sampler_id, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glSamplerParameteri(sampler_id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    // Até a imagem chegar, a unidade fica com o pixel cinza
+    glActiveTexture(GL_TEXTURE0 + unidade);
+    glBindTexture(GL_TEXTURE_2D, textura_substituta_id);
+    glBindSampler(unidade, sampler_id);
+    glActiveTexture(GL_TEXTURE0);
+
+    const GLuint texture_id = tarefa->texture_id;
+    {
+        std::lock_guard<std::mutex> trava(mutex);
+        fila.push_back(tarefa);
+        ++em_andamento;
+    }
+    condicao.notify_one();
+    return texture_id;
+}
+
+IdObjeto Carregador::carregaMalha(const char* arquivo_obj, const char* nome, bool recalcula_normais, FormatoVertice formato)
+{
+    Tarefa* tarefa = new Tarefa();
+    tarefa->tipo = TAREFA_MALHA;
+    tarefa->arquivo = arquivo_obj;
+    tarefa->nome = nome;
+    tarefa->pedido = std::chrono::steady_clock::now();
+    tarefa->ok = false;
+    tarefa->pixels = NULL;
+    tarefa->recalcula_normais = recalcula_normais;
+    tarefa->formato = formato;
+    tarefa->VBO_id = 0;
+    tarefa->EBO_id = 0;
+    tarefa->enviados = 0;
+
+    // Todos os níveis começam com a caixa substituta, cada um no seu VAO
+    for (int nivel = 0; nivel < MAXIMO_NIVEIS_OBJETO; ++nivel)
+    {
+        GLuint vertex_array_object_id;
+        glGenVertexArrays(1, &vertex_array_object_id);
+        glBindVertexArray(vertex_array_object_id);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO_substituto_id);
+        DefineAtributos(VERTICE_FLOAT);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO_substituto_id);
+        glBindVertexArray(0);
+
+        SceneObject objeto;
+        objeto.name           = nome;
+        objeto.first_index    = (void*)0;
+        objeto.num_indices    = 36;
+        objeto.rendering_mode = GL_TRIANGLES;
+        objeto.index_type     = GL_UNSIGNED_INT;
+        objeto.material       = MATERIAL_PHONG;
+        objeto.vertex_array_object_id = vertex_array_object_id;
+        objeto.bbox_min       = glm::vec3(-0.5f, -0.5f, -0.5f);
+        objeto.bbox_max       = glm::vec3( 0.5f,  0.5f,  0.5f);
+        tarefa->ids[nivel] = cena->adiciona(NomeNivel(nome, nivel).c_str(), objeto);
+    }
+
+    SceneObject& base = (*cena)[tarefa->ids[0]];
+    base.num_niveis = MAXIMO_NIVEIS_OBJETO;
+    for (int nivel = 0; nivel < MAXIMO_NIVEIS_OBJETO; ++nivel)
+        base.niveis[nivel] = tarefa->ids[nivel];
+
+    const IdObjeto id = tarefa->ids[0];
+    {
+        std::lock_guard<std::mutex> trava(mutex);
+        fila.push_back(tarefa);
+        ++em_andamento;
+    }
+    condicao.notify_one();
+    return id;
+}
+
+size_t Carregador::pendentes() const
+{
+    std::lock_guard<std::mutex> trava(mutex);
+    return em_andamento;
+}
+
+void Carregador::trabalha()
+{
+    for (;;)
+    {
+        Tarefa* tarefa;
+        {
+            std::unique_lock<std::mutex> trava(mutex);
+            while (!encerrando && fila.empty())
+                condicao.wait(trava);
+            if (encerrando)
+                return;
+            tarefa = fila.front();
+            fila.pop_front();
+        }
+
+        processa(tarefa);
+
+        std::lock_guard<std::mutex> trava(mutex);
+        prontos.push_back(tarefa);
+    }
+}
+
+// Parte de CPU de um pedido, em uma thread de trabalho: nada de OpenGL aqui
+void Carregador::processa(Tarefa* tarefa)
+{
+    if (tarefa->tipo == TAREFA_TEXTURA)
+    {
+        int canais;
+        tarefa->pixels = stbi_load(tarefa->arquivo.c_str(), &tarefa->largura, &tarefa->altura, &canais, 3);
+        tarefa->ok = tarefa->pixels != NULL;
+        if (!tarefa->ok)
+            fprintf(stderr, "ERROR: Cannot open image file \"%s\".\n", tarefa->arquivo.c_str());
+        return;
+    }
+
+    // O caminho rápido mapeia o cache binário; sem cache, ou com cache
+    // desatualizado, o OBJ é convertido e o cache é regravado
+    const char* arquivo_obj = tarefa->arquivo.c_str();
+    std::string arquivo_cache = ArquivoMalha::CaminhoCache(arquivo_obj);
+    if (tarefa->cache.abre(arquivo_cache.c_str(), arquivo_obj, tarefa->recalcula_normais, tarefa->formato))
+    {
+        const ArquivoMalha& cache = tarefa->cache;
+        tarefa->vertices = cache.getVertices();
+        tarefa->bytes_vertices = (size_t)cache.numeroDeVertices() * BytesPorVertice(tarefa->formato);
+        tarefa->indices = cache.getIndices();
+        tarefa->bytes_por_indice = cache.bytesPorIndice();
+        tarefa->bytes_indices = (size_t)cache.numeroDeIndices() * tarefa->bytes_por_indice;
+        tarefa->limites = cache.getLimites();
+        for (uint32_t i = 0; i < cache.numeroDeNiveis(); ++i)
+            tarefa->niveis.push_back(cache.getNivel(i));
+    }
+    else
+    {
+        Malha& malha = tarefa->malha;
+        try
+        {
+            ConverteObj(arquivo_obj, tarefa->recalcula_normais, &malha);
+        }
+        catch (const std::exception& e)
+        {
+            fprintf(stderr, "ERROR: %s\n", e.what());
+            return;
+        }
+        ArquivoMalha::Salva(arquivo_cache.c_str(), arquivo_obj, tarefa->recalcula_normais, malha, tarefa->formato);
+
+        tarefa->vertices = malha.vertices.data();
+        if (tarefa->formato == VERTICE_COMPACTO)
+        {
+            CompactaVertices(malha.vertices, &tarefa->compactos);
+            tarefa->vertices = tarefa->compactos.data();
+        }
+        tarefa->bytes_vertices = malha.vertices.size() * BytesPorVertice(tarefa->formato);
+        tarefa->indices = malha.indices.data();
+        tarefa->bytes_por_indice = sizeof(uint32_t);
+        tarefa->bytes_indices = malha.indices.size() * sizeof(uint32_t);
+        tarefa->limites = malha.limites;
+        tarefa->niveis = malha.niveis;
+    }
+
+    if (tarefa->niveis.empty())
+    {
+        NivelMalha completo = { 0, (uint32_t)(tarefa->bytes_indices / tarefa->bytes_por_indice) };
+        tarefa->niveis.push_back(completo);
+    }
+    tarefa->ok = true;
+}
+
+void Carregador::envia(double orcamento_ms)
+{
+    const std::chrono::steady_clock::time_point inicio = std::chrono::steady_clock::now();
+
+    {
+        std::lock_guard<std::mutex> trava(mutex);
+        enviando.insert(enviando.end(), prontos.begin(), prontos.end());
+        prontos.clear();
+    }
+
+    // Um bloco por vez, na ordem dos pedidos, até o orçamento acabar
+    while (!enviando.empty())
+    {
+        Tarefa* tarefa = enviando.front();
+        bool terminou = true;
+        if (tarefa->ok)
+            terminou = tarefa->tipo == TAREFA_TEXTURA ? enviaTextura(tarefa) : enviaMalha(tarefa);
+        if (terminou)
+        {
+            enviando.pop_front();
+            conclui(tarefa);
+        }
+        if (MilissegundosDesde(inicio) >= orcamento_ms)
+            break;
+    }
+}
+
+// Envia um bloco de linhas da imagem. A textura real só fica na unidade
+// quando está completa, com mipmaps; até lá volta o substituto.
+bool Carregador::enviaTextura(Tarefa* tarefa)
+{
+    glActiveTexture(GL_TEXTURE0 + tarefa->unidade);
+    glBindTexture(GL_TEXTURE_2D, tarefa->texture_id);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+
+    if (tarefa->enviados == 0)
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8, tarefa->largura, tarefa->altura, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+
+    const size_t bytes_por_linha = (size_t)tarefa->largura * 3;
+    const size_t linhas = std::min(std::max(BYTES_POR_BLOCO / bytes_por_linha, (size_t)1),
+                                   (size_t)tarefa->altura - tarefa->enviados);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, (GLint)tarefa->enviados, tarefa->largura, (GLsizei)linhas,
+                    GL_RGB, GL_UNSIGNED_BYTE, tarefa->pixels + tarefa->enviados * bytes_por_linha);
+    tarefa->enviados += linhas;
+
+    const bool terminou = tarefa->enviados >= (size_t)tarefa->altura;
+    if (terminou)
+        glGenerateMipmap(GL_TEXTURE_2D);
+    else
+        glBindTexture(GL_TEXTURE_2D, textura_substituta_id);
+    glActiveTexture(GL_TEXTURE0);
+    return terminou;
+}
+
+// Envia um bloco dos vértices ou, depois deles, dos índices. Os buffers são
+// preenchidos pelo alvo GL_COPY_WRITE_BUFFER para não mexer no VAO atual.
+bool Carregador::enviaMalha(Tarefa* tarefa)
+{
+    if (tarefa->VBO_id == 0)
+    {
+        glGenBuffers(1, &tarefa->VBO_id);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, tarefa->VBO_id);
+        glBufferData(GL_COPY_WRITE_BUFFER, tarefa->bytes_vertices, NULL, GL_STATIC_DRAW);
+        glGenBuffers(1, &tarefa->EBO_id);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, tarefa->EBO_id);
+        glBufferData(GL_COPY_WRITE_BUFFER, tarefa->bytes_indices, NULL, GL_STATIC_DRAW);
+    }
+
+    if (tarefa->enviados < tarefa->bytes_vertices)
+    {
+        const size_t bytes = std::min(BYTES_POR_BLOCO, tarefa->bytes_vertices - tarefa->enviados);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, tarefa->VBO_id);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, tarefa->enviados, bytes,
+                        (const unsigned char*)tarefa->vertices + tarefa->enviados);
+        tarefa->enviados += bytes;
+    }
+    else if (tarefa->enviados < tarefa->bytes_vertices + tarefa->bytes_indices)
+    {
+        const size_t deslocamento = tarefa->enviados - tarefa->bytes_vertices;
+        const size_t bytes = std::min(BYTES_POR_BLOCO, tarefa->bytes_indices - deslocamento);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, tarefa->EBO_id);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, deslocamento, bytes,
+                        (const unsigned char*)tarefa->indices + deslocamento);
+        tarefa->enviados += bytes;
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    return tarefa->enviados >= tarefa->bytes_vertices + tarefa->bytes_indices;
+}
+
+// Troca o substituto pelo objeto real e libera os dados de CPU
+void Carregador::conclui(Tarefa* tarefa)
+{
+    if (tarefa->ok && tarefa->tipo == TAREFA_MALHA)
+    {
+        // Os mesmos VAOs passam a usar os buffers reais; os registros são
+        // substituídos pelo nome, o que recalcula a esfera envolvente
+        const int num_niveis = std::min((int)tarefa->niveis.size(), MAXIMO_NIVEIS_OBJETO);
+        for (int nivel = 0; nivel < num_niveis; ++nivel)
+        {
+            SceneObject objeto = (*cena)[tarefa->ids[nivel]];
+            glBindVertexArray(objeto.vertex_array_object_id);
+            glBindBuffer(GL_ARRAY_BUFFER, tarefa->VBO_id);
+            DefineAtributos(tarefa->formato);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, tarefa->EBO_id);
+            glBindVertexArray(0);
+
+            const LimitesMalha& limites = tarefa->limites;
+            objeto.first_index = (void*)((size_t)tarefa->niveis[nivel].primeiro_indice * tarefa->bytes_por_indice);
+            objeto.num_indices = tarefa->niveis[nivel].num_indices;
+            objeto.index_type  = tarefa->bytes_por_indice == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+            objeto.bbox_min    = glm::vec3(limites.min[0], limites.min[1], limites.min[2]);
+            objeto.bbox_max    = glm::vec3(limites.max[0], limites.max[1], limites.max[2]);
+            cena->adiciona(NomeNivel(tarefa->nome, nivel).c_str(), objeto);
+        }
+
+        // Os VAOs dos níveis que a malha não tem continuam com a caixa, mas
+        // não são mais escolhidos
+        SceneObject& base = (*cena)[tarefa->ids[0]];
+        base.num_niveis = num_niveis;
+        for (int nivel = 0; nivel < num_niveis; ++nivel)
+            base.niveis[nivel] = tarefa->ids[nivel];
+    }
+
+    if (tarefa->ok)
+        printf("Carregado \"%s\" em %.1f ms.\n", tarefa->arquivo.c_str(), MilissegundosDesde(tarefa->pedido));
+
+    LiberaPixels(tarefa->pixels);
+    delete tarefa;
+
+    std::lock_guard<std::mutex> trava(mutex);
+    --em_andamento;
+}
+
+// Pixel cinza e caixa cinza de lado 1 centrada na origem, com uma normal por
+// face (quatro vértices por face)
+void Carregador::criaSubstituto()
+{
+    const unsigned char cinza[3] = { 128, 128, 128 };
+    glGenTextures(1, &textura_substituta_id);
+    glBindTexture(GL_TEXTURE_2D, textura_substituta_id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, cinza);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    std::vector<VerticeMalha> vertices;
+    std::vector<uint32_t> indices;
+    for (int eixo = 0; eixo < 3; ++eixo)
+    {
+        for (int lado = -1; lado <= 1; lado += 2)
+        {
+            const int u = (eixo + 1) % 3, v = (eixo + 2) % 3;
+            const uint32_t primeiro = (uint32_t)vertices.size();
+            for (int canto = 0; canto < 4; ++canto)
+            {
+                VerticeMalha vertice;
+                vertice.posicao[eixo] = 0.5f * lado;
+                vertice.posicao[u] = (canto == 1 || canto == 2) ? 0.5f : -0.5f;
+                vertice.posicao[v] = (canto >= 2) ? 0.5f : -0.5f;
+                for (int c = 0; c < 3; ++c)
+                {
+                    vertice.cor[c] = 0.5f;
+                    vertice.normal[c] = c == eixo ? (float)lado : 0.0f;
+                }
+                vertice.cor[3] = 1.0f;
+                vertices.push_back(vertice);
+            }
+            // Anti-horário visto de fora
+            const uint32_t ordem[2][6] = { { 0, 2, 1, 0, 3, 2 }, { 0, 1, 2, 0, 2, 3 } };
+            for (int i = 0; i < 6; ++i)
+                indices.push_back(primeiro + ordem[lado > 0][i]);
+        }
+    }
+
+    glGenBuffers(1, &VBO_substituto_id);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, VBO_substituto_id);
+    glBufferData(GL_COPY_WRITE_BUFFER, vertices.size() * sizeof(VerticeMalha), vertices.data(), GL_STATIC_DRAW);
+    glGenBuffers(1, &EBO_substituto_id);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, EBO_substituto_id);
+    glBufferData(GL_COPY_WRITE_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
@@ -1,5 +1,5 @@
 #include "Carro.h"
-#include <GLFW/glfw3.h>
+#include "matrices.h"
 #include <glm/mat4x4.hpp>
 #include <iostream>
 #include <vector>
@@ -7,36 +7,38 @@
 
 using namespace std;
 
+// Giros de turnRight() e turnLeft(): cosf(0.2f) e sinf(0.2f), escritos como
+// literais para que o construtor possa ser dobrado em tempo de compilao
+static constexpr float COS_GIRO = 0.980066597f;
+static constexpr float SEN_GIRO = 0.198669329f;
+
+static constexpr float ESCALA_INICIAL = 0.5f;
+
+// Pose inicial do modelo, calculada pelo compilador: os oito turnRight() que
+// o construtor fazia (giros em torno da origem, onde o carro nasce) e o
+// deslocamento do modelo, aplicado antes da escala: matrix * T(-4, 0.2, 0)
+// com matrix = R * S(escala)  R * T(escala * (-4, 0.2, 0)) * S(escala).
+// As parcelas saem na mesma ordem de Rigida_GiraVetorY(), ento os valores
+// so os mesmos que os giros dariam em tempo de execuo.
+static constexpr Matriz4 GIRO_INICIAL = Matrix_Rotate_Y_Repetida(COS_GIRO, -SEN_GIRO, 8, Matrix_Identity());
+static constexpr Matriz4 POSE_INICIAL =
+    GIRO_INICIAL * Matrix_Translate(ESCALA_INICIAL * -4.0f, ESCALA_INICIAL * 0.2f, ESCALA_INICIAL * 0.0f);
+static_assert(POSE_INICIAL(1,1) == 1.0f && POSE_INICIAL(1,3) == ESCALA_INICIAL * 0.2f,
+              "giros em torno de Y no mudam a altura do modelo");
+
 Carro::Carro()
 {
-    matrix = glm::mat4(
-                 0.5f, 0, 0, 0, // COLUNA 1
-                 0, 0.5f, 0, 0, // COLUNA 2
-                 0, 0, 0.5f, 0, // COLUNA 3
-                 0, 0, 0, 1  // COLUNA 4
-             );
-
-    turnRight();
-    turnRight();
-    turnRight();
-    turnRight();
-    turnRight();
-    turnRight();
-    turnRight();
-    turnRight();
+    pista = NULL;
 
-    Naoinicializado = false;
+    transformacao = Rigida_DeMatriz(POSE_INICIAL);
+    escala = ESCALA_INICIAL;
+    ahead = glm::vec4(GIRO_INICIAL(0,2), GIRO_INICIAL(1,2), GIRO_INICIAL(2,2), 0.0f);
 
-    matrix = matrix * glm::mat4(
-                 1, 0, 0, 0,
-                 0, 1, 0, 0,
-                 0, 0, 1, 0,
-                 -4, 0.2, 0, 1
-             );
+    Naoinicializado = false;
 
     position = position + glm::vec4(0,0,-2,0);
 
-    last_time = glfwGetTime();
+    last_time = 0.0;
 }
 
 Carro::~Carro()
@@ -44,174 +46,89 @@ Carro::~Carro()
     //dtor
 }
 
-glm::mat4 matrix_rotate_y(float angle)
-{
-    float c = cos(angle);
-    float s = sin(angle);
-    return glm::mat4(
-               // PREENCHA AQUI A MATRIZ DE ROTAO (3D) EM TORNO DO EIXO Y EM COORD.
-               // HOMOGNEAS, UTILIZANDO OS PARMETROS c e s
-               cos(angle), 0.0f, -sin(angle), 0.0f,      // LINHA 1
-               0.0f, 1.0f, 0.0f, 0.0f,      // LINHA 2
-               sin(angle), 0.0f, cos(angle), 0.0f,      // LINHA 3
-               0.0f, 0.0f, 0.0f, 1.0f       // LINHA 4
-           );
-}
-
-bool Carro::cruzouLimites(vector <glm::vec4> pontos)
+// Testa a caixa do carro (comprimento x largura, escalada por speed) na
+// posio e sentido dados contra a pista. Colidir com a parede ou parar sobre
+// a barreira (andar de r at a chegada) impedem o movimento. Sem pista, o
+// carro anda livre.
+bool Carro::testeColisao(glm::vec4 position, glm::vec4 sentido)
 {
+    if (!pista)
+        return false;
 
+    uint32_t resultado = pista->testaCarro(position[0], position[2], sentido[0], sentido[2],
+                                           (comprimento/2)*speed, (largura/2)*speed);
 
-    for(int i = 0; i < pontos.size(); i++)
-    {
-        //printf("\t\nPonto %d: %f ,%f",i, pontos[i][0], pontos[i][2]);
-        //Blocos externos
-        if(pontos[i][0]>=9 || pontos[i][0]<=-9 || pontos[i][2]>=14  || pontos[i][2]<=-4)
-        {
-            //printf("\n\tUltrapassaria bloco externo.");
-            return true;
-        }
-        //Blocos internos
-        if(pontos[i][0]<=5 && pontos[i][0]>=-5 && pontos[i][2]<=10 && pontos[i][2]>=0)
-        {
-            //printf("\n\tUltrapassaria bloco interno.");
-            return true;
-        }
-    }
-
-    return false;
+    return (resultado & (COLISAO_PAREDE | COLISAO_TRAPACA)) != 0;
 }
 
-bool Carro::testeColisao(glm::vec4 position, glm::vec4 sentido)
+void Carro::moveCarro(double time)
 {
-
-    vector <glm::vec4> pontos;
-    //printf("\n\tAhead:        %f, %f, %f",sentido[0],sentido[1],sentido[2]);
-    glm::vec4 vetor90graus = glm::vec4(sentido[2],sentido[1],(-1*sentido[0]),0);
-    //printf("\n\tvetor90graus: %f, %f, %f",vetor90graus[0],vetor90graus[1],vetor90graus[2]);
-    //printf("\n\tLargura/2:     %f", largura/2);
-    //printf("\n\tComprimento/2: %f", comprimento/2);
-    /*
-    glm::vec4 ponto01 = position + (((comprimento/2)*sentido)+((largura/2)*vetor90graus));
-    glm::vec4 ponto02 = position + (((comprimento/2)*sentido)-((largura/2)*vetor90graus));
-    glm::vec4 ponto03 = position + (-((comprimento/2)*sentido)+((largura/2)*vetor90graus));
-    glm::vec4 ponto04 = position + (-((comprimento/2)*sentido)-((largura/2)*vetor90graus));
-    printf("\n\tPonto01: %f, %f, %f", ponto01[0], ponto01[1], ponto01[2]);
-    printf("\n\tPonto02: %f, %f, %f", ponto02[0], ponto02[1], ponto02[2]);
-    printf("\n\tPonto03: %f, %f, %f", ponto03[0], ponto03[1], ponto03[2]);
-    printf("\n\tPonto04: %f, %f, %f", ponto04[0], ponto04[1], ponto04[2]);
-    */
-
-    glm::vec4 vetorsuperiordir = ((comprimento/2)*sentido)+((largura/2)*vetor90graus);
-    glm::vec4 vetorsuperioresq = ((comprimento/2)*sentido)-((largura/2)*vetor90graus);
-    glm::vec4 vetorinferiordir = -((comprimento/2)*sentido)+((largura/2)*vetor90graus);
-    glm::vec4 vetorinferioresq = -((comprimento/2)*sentido)-((largura/2)*vetor90graus);
-
-    pontos.push_back(position + (vetorsuperiordir*speed));
-    pontos.push_back(position + (vetorsuperioresq*speed));
-    pontos.push_back(position + (vetorinferiordir*speed));
-    pontos.push_back(position + (vetorinferioresq*speed));
-
-    glm::vec4 ponto1 = position + vetorsuperiordir*speed;
-    glm::vec4 ponto2 = position + vetorsuperioresq*speed;
-    glm::vec4 ponto3 = position + vetorinferiordir*speed;
-    glm::vec4 ponto4 = position + vetorinferioresq*speed;
-
-    //printf("\n\tPosicao superior direita:  %f , %f", ponto1[0], ponto1[2]);
-    //printf("\n\tPosicao superior esquerda: %f , %f", ponto2[0], ponto2[2]);
-    //printf("\n\tPosicao inferior direita:  %f , %f", ponto3[0], ponto3[2]);
-    //printf("\n\tPosicao inferior esquerda: %f , %f", ponto4[0], ponto4[2]);
-
-    if(cruzouLimites(pontos))
+    //printf("\n\t Posicao Atual: %f , %f",position[0], position[2]);
+    if(!testeColisao(position+(speed*ahead),ahead))
     {
-        //printf("Colidiu.\n");
-        return true;
+        //printf("Moveu\n");
+        transformacao.translacao += speed * glm::vec3(ahead);
+        position = position + speed*ahead;
+        position[3] = 1;
     }
-
-    if(trapaceou(pontos)){
-        return true;
+    else
+    {
+        deslizaNaParede(speed*ahead, ahead);
     }
-
-    return false;
+    last_time = time;
 }
 
-bool Carro::trapaceou(vector <glm::vec4> pontos){
+// Resposta de deslizamento, s para pistas com campo de distncia: em vez de
+// parar ao bater, o carro tenta andar a parte do deslocamento paralela 
+// parede, removendo a componente contrria  normal do SDF.
+bool Carro::deslizaNaParede(glm::vec4 deslocamento, glm::vec4 sentido)
+{
+    if (!pista || !pista->temSdf())
+        return false;
+
+    float nx, nz;
+    pista->normalParede(position[0], position[2], &nx, &nz);
+    glm::vec4 normal = glm::vec4(nx, 0.0f, nz, 0.0f);
 
-    if(!estaoNaRetaFinal(pontos)){
+    float contra = deslocamento[0]*normal[0] + deslocamento[2]*normal[2];
+    if (contra >= 0.0f)
         return false;
-    }
 
-    if(algumDepoisDaSaida(pontos) && algumAntesDaSaida(pontos)){
-        return true;
-    }
+    glm::vec4 tangente = deslocamento - contra*normal;
+    if (testeColisao(position + tangente, sentido))
+        return false;
 
-    return false;
+    transformacao.translacao += glm::vec3(tangente);
+    position = position + tangente;
+    position[3] = 1;
+    return true;
 }
 
-void Carro::moveCarro(double time)
+// Gira o carro em torno da sua posio: T(position) * R * T(-position) *
+// matrix, feito direto sobre a transformao rgida (ver Rigida_GiraYEmTorno)
+void Carro::gira(float c, float s)
 {
-    //printf("\n\t Posicao Atual: %f , %f",position[0], position[2]);
-    if(!testeColisao(position+(speed*ahead),ahead))
-    {
-        //printf("Moveu\n");
-        glm::mat4 translation = glm::mat4(
-                                    1.0f, 0.0f, 0.0f, 0,      // LINHA 1
-                                    0.0f, 1.0f, 0.0f, 0,      // LINHA 2
-                                    0.0f, 0.0f, 1.0f, 0,      // LINHA 3
-                                    ahead[0]*speed, ahead[1]*speed, ahead[2]*speed, 1.0f       // LINHA 4
-                                );
-        matrix = (translation) * matrix;
-        position = position + speed*ahead;
-        position[3] = 1;
-    }
-    last_time = time;
+    transformacao = Rigida_GiraYEmTorno(transformacao, c, s, glm::vec3(position));
+    ahead = glm::vec4(Rigida_GiraVetorY(glm::vec3(ahead), c, s), 0.0f);
 }
 
 void Carro::turnRight()
 {
     //printf("\n\t Posicao Atual: %f , %f",position[0], position[2]);
-    glm::mat4 rotation = matrix_rotate_y(-0.2);
     //if(!testeColisao(position,ahead*rotation) || Naoinicializado)
     //{
-    glm::mat4 translation = glm::mat4(
-                                1.0f, 0.0f, 0.0f, 0,      // LINHA 1
-                                0.0f, 1.0f, 0.0f, 0,      // LINHA 2
-                                0.0f, 0.0f, 1.0f, 0,      // LINHA 3
-                                -position[0], -position[1], -position[2], 1.0f       // LINHA 4
-                            );
-    glm::mat4 translation2 = glm::mat4(
-                                 1.0f, 0.0f, 0.0f, 0,      // LINHA 1
-                                 0.0f, 1.0f, 0.0f, 0,      // LINHA 2
-                                 0.0f, 0.0f, 1.0f, 0,      // LINHA 3
-                                 position[0], position[1], position[2], 1.0f       // LINHA 4
-                             );
-
-    matrix = translation2 * rotation * translation* matrix;
-    ahead = rotation * ahead;
+    gira(COS_GIRO, -SEN_GIRO);
     //}
 }
 
 void Carro::turnLeft()
 {
     //printf("\n\t Posicao Atual: %f , %f",position[0], position[2]);
-    glm::mat4 rotation = matrix_rotate_y(0.2);
-    if(!testeColisao(position, ahead*rotation))
+    // O teste usa ahead*rotation, isto , o sentido girado ao contrrio
+    glm::vec4 teste = glm::vec4(Rigida_GiraVetorY(glm::vec3(ahead), COS_GIRO, -SEN_GIRO), 0.0f);
+    if(!testeColisao(position, teste))
     {
-    glm::mat4 translation = glm::mat4(
-                                1.0f, 0.0f, 0.0f, 0,      // LINHA 1
-                                0.0f, 1.0f, 0.0f, 0,      // LINHA 2
-                                0.0f, 0.0f, 1.0f, 0,      // LINHA 3
-                                -position[0], -position[1], -position[2], 1.0f       // LINHA 4
-                            );
-    glm::mat4 translation2 = glm::mat4(
-                                 1.0f, 0.0f, 0.0f, 0,      // LINHA 1
-                                 0.0f, 1.0f, 0.0f, 0,      // LINHA 2
-                                 0.0f, 0.0f, 1.0f, 0,      // LINHA 3
-                                 position[0], position[1], position[2], 1.0f       // LINHA 4
-                             );
-
-    matrix = translation2 * rotation * translation* matrix;
-    ahead = rotation * ahead;
+        gira(COS_GIRO, SEN_GIRO);
     }
 }
 void Carro::moveCarBack()
@@ -219,126 +136,65 @@ void Carro::moveCarBack()
     //printf("\n\t Posicao Atual: %f , %f",position[0], position[2]);
     if(!testeColisao(position-(ahead*speed), -ahead))
     {
-        glm::mat4 translation = glm::mat4(
-                                    1.0f, 0.0f, 0.0f, 0,      // LINHA 1
-                                    0.0f, 1.0f, 0.0f, 0,      // LINHA 2
-                                    0.0f, 0.0f, 1.0f, 0,      // LINHA 3
-                                    -ahead[0]*speed, -ahead[1]*speed, -ahead[2]*speed, 1.0f       // LINHA 4
-                                );
-        matrix = (translation) * matrix;
+        transformacao.translacao -= glm::vec3(ahead*speed);
         position = position - (ahead*speed);
         position[3] = 1;
     }
+    else
+    {
+        deslizaNaParede(-(ahead*speed), -ahead);
+    }
 }
 
 bool Carro::cruzouChegada()
 {
-    vector <glm::vec4> pontos;
-    glm::vec4 vetor90graus = glm::vec4(ahead[2],ahead[1],(-1*ahead[0]),0);
-
-    glm::vec4 vetorsuperiordir = ((comprimento/2)*ahead)+((largura/2)*vetor90graus);
-    glm::vec4 vetorsuperioresq = ((comprimento/2)*ahead)-((largura/2)*vetor90graus);
-    glm::vec4 vetorinferiordir = -((comprimento/2)*ahead)+((largura/2)*vetor90graus);
-    glm::vec4 vetorinferioresq = -((comprimento/2)*ahead)-((largura/2)*vetor90graus);
-
-    glm::vec4 ponto1 = position +vetorsuperiordir*speed;
-
-    //printf("\n\tPonto1 = %f, %f, %f", ponto1[0],ponto1[1],ponto1[2]);
-
-    pontos.push_back(position + vetorsuperiordir*speed);
-    pontos.push_back(position + vetorsuperioresq*speed);
-    pontos.push_back(position + vetorinferiordir*speed);
-    pontos.push_back(position + vetorinferioresq*speed);
-
-
-    if(!estaoNaRetaFinal(pontos))
-    {
+    if (!pista)
         return false;
-    }
 
-    if(algumAntesDaChegada(pontos) && algumDepoisDaChegada(pontos))
-    {
-        return true;
-    }
+    uint32_t resultado = pista->testaCarro(position[0], position[2], ahead[0], ahead[2],
+                                           (comprimento/2)*speed, (largura/2)*speed);
 
-    return false;
+    return (resultado & COLISAO_CHEGADA) != 0;
 }
-bool Carro::estaoNaRetaFinal(vector <glm::vec4> pontos)
+
+bool Carro::cruzouCheckpoint(size_t i)
 {
+    if (!pista)
+        return false;
 
-    for(int i=0; i < pontos.size(); i++)
-    {
-        if(pontos[i][2]>0)
-        {
-            return false;
-        }
-    }
-    return true;
+    return pista->cruzouCheckpoint(i, position[0], position[2], ahead[0], ahead[2],
+                                   (comprimento/2)*speed, (largura/2)*speed);
 }
 
-bool Carro::algumAntesDaChegada(vector <glm::vec4> pontos)
+void Carro::setPista(const Pista* pista)
 {
-
-    for(int i=0; i < pontos.size(); i++)
-    {
-        if(pontos[i][0]>=3)
-        {
-            return true;
-        }
-    }
-
-    return false;
+    this->pista = pista;
 }
 
-bool Carro::algumDepoisDaChegada(vector <glm::vec4> pontos)
+// Leva o carro para a posio (x, z) com sentido (sin(angulo), 0, cos(angulo)),
+// aplicando  matriz o movimento rgido correspondente, como fazem moveCarro()
+// e turnLeft().
+void Carro::posiciona(float x, float z, float angulo)
 {
-
-    for(int i=0; i < pontos.size(); i++)
-    {
-        //printf("\n\t%d - %f", i, pontos[i][0]);
-        if(pontos[i][0]<3)
-        {
-            return true;
-        }
-    }
-
-    return false;
+    const float giro = angulo - atan2(ahead[0], ahead[2]);
+    gira(cosf(giro), sinf(giro));
+    transformacao.translacao += glm::vec3(x - position[0], 0.0f, z - position[2]);
+    position = glm::vec4(x, position[1], z, 1.0f);
 }
 
-bool Carro::algumAntesDaSaida(vector <glm::vec4> pontos)
+glm::mat4 Carro::getMatrix()
 {
-
-    for(int i=0; i < pontos.size(); i++)
-    {
-        if(pontos[i][0]>=2)
-        {
-            return true;
-        }
-    }
-
-    return false;
+    return Rigida_Matriz(transformacao, escala);
 }
 
-bool Carro::algumDepoisDaSaida(vector <glm::vec4> pontos)
+const TransformacaoRigida& Carro::getTransformacao()
 {
-
-    for(int i=0; i < pontos.size(); i++)
-    {
-        //printf("\n\t%d - %f", i, pontos[i][0]);
-        if(pontos[i][0]<2)
-        {
-            return true;
-        }
-    }
-
-    return false;
+    return transformacao;
 }
 
-
-
-glm::mat4 Carro::getMatrix()
+float Carro::getEscala()
 {
-    return matrix;
+    return escala;
 }
 
 glm::vec4 Carro::getCameraPosition()
@@ -353,3 +209,19 @@ glm::vec4 Carro::getCameraView()
 {
     return ahead;
 }
+
+glm::vec4 Carro::getPosition()
+{
+    return position;
+}
+
+// Meias dimenses da caixa de coliso, como usadas em testeColisao()
+float Carro::getMeioComprimento()
+{
+    return (comprimento/2)*speed;
+}
+
+float Carro::getMeioLargura()
+{
+    return (largura/2)*speed;
+}
@@ -0,0 +1,69 @@
+#include "CenaVirtual.h"
+#include <cstdio>
+#include <glm/geometric.hpp>
+
+// HashNome() precisa continuar avaliável em tempo de compilação
+static_assert(HashNome("") == 2166136261u && HashNome("a") == 0xe40c292cu, "HashNome deve ser FNV-1a de 32 bits");
+
+CenaVirtual::CenaVirtual()
+{
+    //ctor
+}
+
+CenaVirtual::~CenaVirtual()
+{
+    //dtor
+}
+
+IdObjeto CenaVirtual::adiciona(const char* nome, const SceneObject& objeto)
+{
+    const uint32_t hash = HashNome(nome);
+
+    SceneObject registro = objeto;
+    registro.hash = hash;
+    registro.centro_esfera = 0.5f * (objeto.bbox_min + objeto.bbox_max);
+    registro.raio_esfera = 0.5f * glm::length(objeto.bbox_max - objeto.bbox_min);
+
+    std::unordered_map<uint32_t, IdObjeto>::const_iterator it = por_hash.find(hash);
+    if (it != por_hash.end())
+    {
+        // Dois nomes diferentes com o mesmo hash tornariam procura() ambígua
+        if (nomes[it->second] != nome)
+            fprintf(stderr, "WARNING: Scene object \"%s\" has the same name hash as \"%s\"; replacing it.\n",
+                    nome, nomes[it->second].c_str());
+        registro.num_niveis = 1;
+        registro.niveis[0] = it->second;
+        objetos[it->second] = registro;
+        nomes[it->second] = nome;
+        return it->second;
+    }
+
+    IdObjeto id = (IdObjeto)objetos.size();
+    registro.num_niveis = 1;
+    registro.niveis[0] = id;
+    objetos.push_back(registro);
+    nomes.push_back(nome);
+    por_hash[hash] = id;
+    return id;
+}
+
+IdObjeto CenaVirtual::procura(uint32_t hash) const
+{
+    std::unordered_map<uint32_t, IdObjeto>::const_iterator it = por_hash.find(hash);
+    return it == por_hash.end() ? ID_INVALIDO : it->second;
+}
+
+IdObjeto CenaVirtual::procura(const char* nome) const
+{
+    return procura(HashNome(nome));
+}
+
+size_t CenaVirtual::tamanho() const
+{
+    return objetos.size();
+}
+
+const std::vector<SceneObject>& CenaVirtual::getObjetos() const
+{
+    return objetos;
+}
@@ -0,0 +1,224 @@
+#include "Colisao.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define COLISAO_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define COLISAO_SSE2
+#endif
+
+// Versão escalar, usada para um carro só e para o resto dos lotes. Os cantos
+// são calculados como em Carro: o vetor perpendicular ao sentido (dx, dz) é
+// (dz, -dx).
+uint32_t TestaColisaoCarro(const LimitesPista& pista, float x, float z, float dir_x, float dir_z,
+                           float meio_comprimento, float meio_largura)
+{
+    const float lx = meio_comprimento * dir_x;
+    const float lz = meio_comprimento * dir_z;
+    const float wx = meio_largura * dir_z;
+    const float wz = -meio_largura * dir_x;
+
+    const float cantos_x[4] = { x + lx + wx, x + lx - wx, x - lx + wx, x - lx - wx };
+    const float cantos_z[4] = { z + lz + wz, z + lz - wz, z - lz + wz, z - lz - wz };
+
+    bool parede = false;
+    bool fora_da_reta = false;
+    bool antes_chegada = false, depois_chegada = false;
+    bool antes_saida = false, depois_saida = false;
+
+    for (int i = 0; i < 4; ++i)
+    {
+        const float cx = cantos_x[i];
+        const float cz = cantos_z[i];
+
+        // Blocos externos
+        parede |= cx >= pista.externo_max_x || cx <= pista.externo_min_x
+               || cz >= pista.externo_max_z || cz <= pista.externo_min_z;
+        // Blocos internos
+        parede |= cx <= pista.interno_max_x && cx >= pista.interno_min_x
+               && cz <= pista.interno_max_z && cz >= pista.interno_min_z;
+
+        fora_da_reta |= cz > pista.reta_final_max_z;
+        antes_chegada |= cx >= pista.chegada_x;
+        depois_chegada |= cx < pista.chegada_x;
+        antes_saida |= cx >= pista.saida_x;
+        depois_saida |= cx < pista.saida_x;
+    }
+
+    uint32_t resultado = 0;
+    if (parede)
+        resultado |= COLISAO_PAREDE;
+    if (!fora_da_reta && antes_saida && depois_saida)
+        resultado |= COLISAO_TRAPACA;
+    if (!fora_da_reta && antes_chegada && depois_chegada)
+        resultado |= COLISAO_CHEGADA;
+    return resultado;
+}
+
+#if defined(COLISAO_SSE2)
+
+// Testa 4 carros de uma vez: cada registrador guarda a mesma grandeza dos 4
+// carros. O retorno tem os bits de parede nos bits 0-3 (um por carro),
+// trapaça nos bits 4-7 e chegada nos bits 8-11.
+static inline uint32_t TestaColisao4(const LimitesPista& pista, const float* x, const float* z,
+                                     const float* dir_x, const float* dir_z,
+                                     __m128 meio_comprimento, __m128 meio_largura)
+{
+    const __m128 px = _mm_loadu_ps(x);
+    const __m128 pz = _mm_loadu_ps(z);
+    const __m128 dx = _mm_loadu_ps(dir_x);
+    const __m128 dz = _mm_loadu_ps(dir_z);
+
+    const __m128 lx = _mm_mul_ps(meio_comprimento, dx);
+    const __m128 lz = _mm_mul_ps(meio_comprimento, dz);
+    const __m128 wx = _mm_mul_ps(meio_largura, dz);
+    const __m128 wz = _mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(meio_largura, dx));
+
+    const __m128 frente_x = _mm_add_ps(px, lx), frente_z = _mm_add_ps(pz, lz);
+    const __m128 tras_x   = _mm_sub_ps(px, lx), tras_z   = _mm_sub_ps(pz, lz);
+
+    const __m128 cantos_x[4] = { _mm_add_ps(frente_x, wx), _mm_sub_ps(frente_x, wx), _mm_add_ps(tras_x, wx), _mm_sub_ps(tras_x, wx) };
+    const __m128 cantos_z[4] = { _mm_add_ps(frente_z, wz), _mm_sub_ps(frente_z, wz), _mm_add_ps(tras_z, wz), _mm_sub_ps(tras_z, wz) };
+
+    const __m128 ext_min_x = _mm_set1_ps(pista.externo_min_x), ext_max_x = _mm_set1_ps(pista.externo_max_x);
+    const __m128 ext_min_z = _mm_set1_ps(pista.externo_min_z), ext_max_z = _mm_set1_ps(pista.externo_max_z);
+    const __m128 int_min_x = _mm_set1_ps(pista.interno_min_x), int_max_x = _mm_set1_ps(pista.interno_max_x);
+    const __m128 int_min_z = _mm_set1_ps(pista.interno_min_z), int_max_z = _mm_set1_ps(pista.interno_max_z);
+    const __m128 chegada = _mm_set1_ps(pista.chegada_x);
+    const __m128 saida = _mm_set1_ps(pista.saida_x);
+    const __m128 reta = _mm_set1_ps(pista.reta_final_max_z);
+
+    __m128 parede = _mm_setzero_ps();
+    __m128 fora_da_reta = _mm_setzero_ps();
+    __m128 antes_chegada = _mm_setzero_ps(), depois_chegada = _mm_setzero_ps();
+    __m128 antes_saida = _mm_setzero_ps(), depois_saida = _mm_setzero_ps();
+
+    for (int i = 0; i < 4; ++i)
+    {
+        const __m128 cx = cantos_x[i];
+        const __m128 cz = cantos_z[i];
+
+        const __m128 fora = _mm_or_ps(_mm_or_ps(_mm_cmpge_ps(cx, ext_max_x), _mm_cmple_ps(cx, ext_min_x)),
+                                      _mm_or_ps(_mm_cmpge_ps(cz, ext_max_z), _mm_cmple_ps(cz, ext_min_z)));
+        const __m128 dentro = _mm_and_ps(_mm_and_ps(_mm_cmple_ps(cx, int_max_x), _mm_cmpge_ps(cx, int_min_x)),
+                                         _mm_and_ps(_mm_cmple_ps(cz, int_max_z), _mm_cmpge_ps(cz, int_min_z)));
+        parede = _mm_or_ps(parede, _mm_or_ps(fora, dentro));
+
+        fora_da_reta = _mm_or_ps(fora_da_reta, _mm_cmpgt_ps(cz, reta));
+        antes_chegada = _mm_or_ps(antes_chegada, _mm_cmpge_ps(cx, chegada));
+        depois_chegada = _mm_or_ps(depois_chegada, _mm_cmplt_ps(cx, chegada));
+        antes_saida = _mm_or_ps(antes_saida, _mm_cmpge_ps(cx, saida));
+        depois_saida = _mm_or_ps(depois_saida, _mm_cmplt_ps(cx, saida));
+    }
+
+    const __m128 trapaca = _mm_andnot_ps(fora_da_reta, _mm_and_ps(antes_saida, depois_saida));
+    const __m128 cruzou = _mm_andnot_ps(fora_da_reta, _mm_and_ps(antes_chegada, depois_chegada));
+
+    return (uint32_t)_mm_movemask_ps(parede)
+         | ((uint32_t)_mm_movemask_ps(trapaca) << 4)
+         | ((uint32_t)_mm_movemask_ps(cruzou) << 8);
+}
+
+#elif defined(COLISAO_AVX)
+
+// Mesmo teste de TestaColisao4, para 8 carros: parede nos bits 0-7, trapaça
+// nos bits 8-15 e chegada nos bits 16-23.
+static inline uint32_t TestaColisao8(const LimitesPista& pista, const float* x, const float* z,
+                                     const float* dir_x, const float* dir_z,
+                                     __m256 meio_comprimento, __m256 meio_largura)
+{
+    const __m256 px = _mm256_loadu_ps(x);
+    const __m256 pz = _mm256_loadu_ps(z);
+    const __m256 dx = _mm256_loadu_ps(dir_x);
+    const __m256 dz = _mm256_loadu_ps(dir_z);
+
+    const __m256 lx = _mm256_mul_ps(meio_comprimento, dx);
+    const __m256 lz = _mm256_mul_ps(meio_comprimento, dz);
+    const __m256 wx = _mm256_mul_ps(meio_largura, dz);
+    const __m256 wz = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_mul_ps(meio_largura, dx));
+
+    const __m256 frente_x = _mm256_add_ps(px, lx), frente_z = _mm256_add_ps(pz, lz);
+    const __m256 tras_x   = _mm256_sub_ps(px, lx), tras_z   = _mm256_sub_ps(pz, lz);
+
+    const __m256 cantos_x[4] = { _mm256_add_ps(frente_x, wx), _mm256_sub_ps(frente_x, wx), _mm256_add_ps(tras_x, wx), _mm256_sub_ps(tras_x, wx) };
+    const __m256 cantos_z[4] = { _mm256_add_ps(frente_z, wz), _mm256_sub_ps(frente_z, wz), _mm256_add_ps(tras_z, wz), _mm256_sub_ps(tras_z, wz) };
+
+    const __m256 ext_min_x = _mm256_set1_ps(pista.externo_min_x), ext_max_x = _mm256_set1_ps(pista.externo_max_x);
+    const __m256 ext_min_z = _mm256_set1_ps(pista.externo_min_z), ext_max_z = _mm256_set1_ps(pista.externo_max_z);
+    const __m256 int_min_x = _mm256_set1_ps(pista.interno_min_x), int_max_x = _mm256_set1_ps(pista.interno_max_x);
+    const __m256 int_min_z = _mm256_set1_ps(pista.interno_min_z), int_max_z = _mm256_set1_ps(pista.interno_max_z);
+    const __m256 chegada = _mm256_set1_ps(pista.chegada_x);
+    const __m256 saida = _mm256_set1_ps(pista.saida_x);
+    const __m256 reta = _mm256_set1_ps(pista.reta_final_max_z);
+
+    __m256 parede = _mm256_setzero_ps();
+    __m256 fora_da_reta = _mm256_setzero_ps();
+    __m256 antes_chegada = _mm256_setzero_ps(), depois_chegada = _mm256_setzero_ps();
+    __m256 antes_saida = _mm256_setzero_ps(), depois_saida = _mm256_setzero_ps();
+
+    for (int i = 0; i < 4; ++i)
+    {
+        const __m256 cx = cantos_x[i];
+        const __m256 cz = cantos_z[i];
+
+        const __m256 fora = _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(cx, ext_max_x, _CMP_GE_OQ), _mm256_cmp_ps(cx, ext_min_x, _CMP_LE_OQ)),
+                                         _mm256_or_ps(_mm256_cmp_ps(cz, ext_max_z, _CMP_GE_OQ), _mm256_cmp_ps(cz, ext_min_z, _CMP_LE_OQ)));
+        const __m256 dentro = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(cx, int_max_x, _CMP_LE_OQ), _mm256_cmp_ps(cx, int_min_x, _CMP_GE_OQ)),
+                                            _mm256_and_ps(_mm256_cmp_ps(cz, int_max_z, _CMP_LE_OQ), _mm256_cmp_ps(cz, int_min_z, _CMP_GE_OQ)));
+        parede = _mm256_or_ps(parede, _mm256_or_ps(fora, dentro));
+
+        fora_da_reta = _mm256_or_ps(fora_da_reta, _mm256_cmp_ps(cz, reta, _CMP_GT_OQ));
+        antes_chegada = _mm256_or_ps(antes_chegada, _mm256_cmp_ps(cx, chegada, _CMP_GE_OQ));
+        depois_chegada = _mm256_or_ps(depois_chegada, _mm256_cmp_ps(cx, chegada, _CMP_LT_OQ));
+        antes_saida = _mm256_or_ps(antes_saida, _mm256_cmp_ps(cx, saida, _CMP_GE_OQ));
+        depois_saida = _mm256_or_ps(depois_saida, _mm256_cmp_ps(cx, saida, _CMP_LT_OQ));
+    }
+
+    const __m256 trapaca = _mm256_andnot_ps(fora_da_reta, _mm256_and_ps(antes_saida, depois_saida));
+    const __m256 cruzou = _mm256_andnot_ps(fora_da_reta, _mm256_and_ps(antes_chegada, depois_chegada));
+
+    return (uint32_t)_mm256_movemask_ps(parede)
+         | ((uint32_t)_mm256_movemask_ps(trapaca) << 8)
+         | ((uint32_t)_mm256_movemask_ps(cruzou) << 16);
+}
+
+#endif
+
+void TestaColisaoLote(const LimitesPista& pista, const float* x, const float* z,
+                      const float* dir_x, const float* dir_z, size_t n,
+                      float meio_comprimento, float meio_largura, uint8_t* flags)
+{
+    size_t i = 0;
+
+#if defined(COLISAO_AVX)
+    const __m256 l = _mm256_set1_ps(meio_comprimento);
+    const __m256 w = _mm256_set1_ps(meio_largura);
+    for (; i + 8 <= n; i += 8)
+    {
+        uint32_t mascara = TestaColisao8(pista, x + i, z + i, dir_x + i, dir_z + i, l, w);
+        for (int j = 0; j < 8; ++j)
+        {
+            flags[i + j] = (uint8_t)(((mascara >> j) & 1u) * COLISAO_PAREDE
+                                   | ((mascara >> (8 + j)) & 1u) * COLISAO_TRAPACA
+                                   | ((mascara >> (16 + j)) & 1u) * COLISAO_CHEGADA);
+        }
+    }
+#elif defined(COLISAO_SSE2)
+    const __m128 l = _mm_set1_ps(meio_comprimento);
+    const __m128 w = _mm_set1_ps(meio_largura);
+    for (; i + 4 <= n; i += 4)
+    {
+        uint32_t mascara = TestaColisao4(pista, x + i, z + i, dir_x + i, dir_z + i, l, w);
+        for (int j = 0; j < 4; ++j)
+        {
+            flags[i + j] = (uint8_t)(((mascara >> j) & 1u) * COLISAO_PAREDE
+                                   | ((mascara >> (4 + j)) & 1u) * COLISAO_TRAPACA
+                                   | ((mascara >> (8 + j)) & 1u) * COLISAO_CHEGADA);
+        }
+    }
+#endif
+
+    for (; i < n; ++i)
+        flags[i] = (uint8_t)TestaColisaoCarro(pista, x[i], z[i], dir_x[i], dir_z[i], meio_comprimento, meio_largura);
+}
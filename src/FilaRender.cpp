@@ -0,0 +1,285 @@
+#include "FilaRender.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <glm/geometric.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+// Diâmetro na tela, em pixels, abaixo do qual cada nível de detalhe passa a
+// ser usado, e a margem da histerese em torno de cada limiar.
+static const float LIMIAR_NIVEL[MAXIMO_NIVEIS_OBJETO] = { 0.0f, 240.0f, 120.0f, 60.0f };
+static const float HISTERESE_NIVEL = 0.15f;
+
+FilaRender::FilaRender()
+{
+    memset(&contadores, 0, sizeof(contadores));
+    distancia_maxima = 0.0f;
+    pixels_por_unidade = 0.0f;
+}
+
+FilaRender::~FilaRender()
+{
+    //dtor
+}
+
+void FilaRender::registraPrograma(GLuint program_id)
+{
+    if (indicePrograma(program_id) >= 0)
+        return;
+
+    if (programas.size() >= 256)
+    {
+        fprintf(stderr, "ERROR: Render queue supports at most 256 programs.\n");
+        return;
+    }
+
+    programas.push_back(Programa());
+    programas.back().id = program_id;
+    localizaUniforms(&programas.back());
+}
+
+void FilaRender::substituiPrograma(GLuint antigo, GLuint novo)
+{
+    int indice = indicePrograma(antigo);
+    if (indice < 0)
+    {
+        registraPrograma(novo);
+        return;
+    }
+    programas[indice].id = novo;
+    localizaUniforms(&programas[indice]);
+}
+
+void FilaRender::localizaUniforms(Programa* programa)
+{
+    programa->model_uniform          = glGetUniformLocation(programa->id, "model");
+    programa->normal_matrix_uniform  = glGetUniformLocation(programa->id, "normal_matrix");
+    programa->material_uniform       = glGetUniformLocation(programa->id, "isGourard");
+    programa->usa_instancias_uniform = glGetUniformLocation(programa->id, "usaInstancias");
+    programa->material = -1;
+    programa->usa_instancias = -1;
+}
+
+int FilaRender::indicePrograma(GLuint program_id) const
+{
+    for (size_t i = 0; i < programas.size(); ++i)
+        if (programas[i].id == program_id)
+            return (int)i;
+    return -1;
+}
+
+void FilaRender::limpa(const glm::vec4& camera, const glm::mat4& view_projection, float distancia)
+{
+    itens.clear();
+    memset(&contadores, 0, sizeof(contadores));
+    posicao_camera = camera;
+    frustum.extrai(view_projection);
+    distancia_maxima = distancia;
+}
+
+void FilaRender::defineTela(const glm::mat4& projection, int altura)
+{
+    // projection[1][1] é cotg(fov/2): a razão entre a metade da altura da
+    // tela e a distância, em NDC
+    pixels_por_unidade = fabsf(projection[1][1]) * 0.5f * (float)altura;
+}
+
+// A esfera vai para o mundo com o centro transformado e o raio multiplicado
+// pela maior escala de "model"
+void FilaRender::esferaNoMundo(const SceneObject& objeto, const glm::mat4& model, glm::vec3* centro, float* raio) const
+{
+    *centro = glm::vec3(model * glm::vec4(objeto.centro_esfera, 1.0f));
+    float escala = std::max(glm::length(glm::vec3(model[0])),
+                            std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+    *raio = objeto.raio_esfera * escala;
+}
+
+int FilaRender::nivelDeDetalhe(const SceneObject& objeto, const glm::mat4& model, int nivel) const
+{
+    if (objeto.num_niveis <= 1)
+        return 0;
+
+    glm::vec3 centro;
+    float raio;
+    esferaNoMundo(objeto, model, &centro, &raio);
+    const float distancia = std::max(glm::length(centro - glm::vec3(posicao_camera)), raio);
+    const float diametro = 2.0f * raio * pixels_por_unidade / distancia;
+
+    nivel = std::min(std::max(nivel, 0), objeto.num_niveis - 1);
+    while (nivel + 1 < objeto.num_niveis && diametro < LIMIAR_NIVEL[nivel + 1] * (1.0f - HISTERESE_NIVEL))
+        ++nivel;
+    while (nivel > 0 && diametro > LIMIAR_NIVEL[nivel] * (1.0f + HISTERESE_NIVEL))
+        --nivel;
+    return nivel;
+}
+
+void FilaRender::adicionaInstancia(const SceneObject& objeto, const glm::mat4& model, const glm::vec4& cor,
+                                   LoteInstancias* lotes, int* nivel)
+{
+    if (!visivel(objeto, model))
+        return;
+    *nivel = nivelDeDetalhe(objeto, model, *nivel);
+    lotes[*nivel].adiciona(model, cor);
+}
+
+void FilaRender::adicionaLotes(GLuint program_id, const CenaVirtual& cena, const SceneObject& objeto, LoteInstancias* lotes)
+{
+    for (int nivel = 0; nivel < objeto.num_niveis; ++nivel)
+    {
+        lotes[nivel].envia();
+        adicionaLote(program_id, cena[objeto.niveis[nivel]], &lotes[nivel]);
+    }
+}
+
+bool FilaRender::visivel(const SceneObject& objeto, const glm::mat4& model)
+{
+    glm::vec3 centro;
+    float raio;
+    esferaNoMundo(objeto, model, &centro, &raio);
+
+    if ((distancia_maxima > 0.0f && glm::length(centro - glm::vec3(posicao_camera)) - raio > distancia_maxima)
+        || !frustum.contemEsfera(centro, raio))
+    {
+        ++contadores.descartados;
+        return false;
+    }
+    return true;
+}
+
+uint64_t FilaRender::chave(const Item& item, float profundidade) const
+{
+    uint32_t bits_profundidade;
+    memcpy(&bits_profundidade, &profundidade, sizeof(bits_profundidade));
+
+    return ((uint64_t)(item.programa & 0xFF) << 56)
+         | ((uint64_t)(item.objeto.material & 0xFF) << 48)
+         | ((uint64_t)(item.lote != NULL) << 47)
+         | ((uint64_t)(item.objeto.vertex_array_object_id & 0x7FFF) << 32)
+         | (uint64_t)bits_profundidade;
+}
+
+void FilaRender::adiciona(GLuint program_id, const SceneObject& objeto, const glm::mat4& model, const glm::mat3& normal_matrix)
+{
+    int programa = indicePrograma(program_id);
+    if (programa < 0)
+    {
+        fprintf(stderr, "ERROR: Program %u was not registered in the render queue.\n", program_id);
+        return;
+    }
+    if (!visivel(objeto, model))
+        return;
+
+    Item item;
+    item.programa = programa;
+    item.objeto = objeto;
+    item.lote = NULL;
+    item.model = model;
+    item.normal_matrix = normal_matrix;
+    itens.push_back(item);
+}
+
+void FilaRender::adicionaLote(GLuint program_id, const SceneObject& objeto, const LoteInstancias* lote)
+{
+    int programa = indicePrograma(program_id);
+    if (programa < 0)
+    {
+        fprintf(stderr, "ERROR: Program %u was not registered in the render queue.\n", program_id);
+        return;
+    }
+    if (lote->tamanho() == 0)
+        return;
+
+    Item item;
+    item.programa = programa;
+    item.objeto = objeto;
+    item.lote = lote;
+    itens.push_back(item);
+}
+
+void FilaRender::defineUniform(GLint location, int valor, int* atual)
+{
+    if (*atual == valor)
+    {
+        ++contadores.evitadas;
+        return;
+    }
+    glUniform1i(location, valor);
+    *atual = valor;
+    ++contadores.trocas_uniform;
+}
+
+void FilaRender::envia()
+{
+    contadores.itens = (unsigned int)itens.size();
+
+    chaves.resize(itens.size());
+    for (size_t i = 0; i < itens.size(); ++i)
+    {
+        // Lotes não têm uma posição única; ficam com profundidade zero
+        float profundidade = 0.0f;
+        if (itens[i].lote == NULL)
+            profundidade = glm::length(glm::vec3(itens[i].model[3] - posicao_camera));
+        chaves[i] = std::make_pair(chave(itens[i], profundidade), (uint32_t)i);
+    }
+    std::sort(chaves.begin(), chaves.end());
+
+    // O resto do quadro (texto, etc.) muda programa e VAO por fora da fila:
+    // o estado só é confiável dentro de um envia()
+    for (size_t i = 0; i < programas.size(); ++i)
+        programas[i].material = programas[i].usa_instancias = -1;
+    int programa_atual = -1;
+    GLuint vao_atual = 0;
+    bool vao_conhecido = false;
+
+    for (size_t k = 0; k < chaves.size(); ++k)
+    {
+        const Item& item = itens[chaves[k].second];
+        Programa& programa = programas[item.programa];
+
+        if (item.programa != programa_atual)
+        {
+            glUseProgram(programa.id);
+            programa_atual = item.programa;
+            ++contadores.trocas_programa;
+        }
+        else
+            ++contadores.evitadas;
+
+        if (!vao_conhecido || item.objeto.vertex_array_object_id != vao_atual)
+        {
+            glBindVertexArray(item.objeto.vertex_array_object_id);
+            vao_atual = item.objeto.vertex_array_object_id;
+            vao_conhecido = true;
+            ++contadores.trocas_vao;
+        }
+        else
+            ++contadores.evitadas;
+
+        defineUniform(programa.material_uniform, item.objeto.material, &programa.material);
+        defineUniform(programa.usa_instancias_uniform, item.lote != NULL, &programa.usa_instancias);
+
+        if (item.lote != NULL)
+        {
+            glDrawElementsInstanced(item.objeto.rendering_mode, item.objeto.num_indices, item.objeto.index_type,
+                                    item.objeto.first_index, (GLsizei)item.lote->tamanho());
+            contadores.triangulos += (unsigned int)(item.objeto.num_indices / 3 * item.lote->tamanho());
+        }
+        else
+        {
+            glUniformMatrix4fv(programa.model_uniform, 1, GL_FALSE, glm::value_ptr(item.model));
+            glUniformMatrix3fv(programa.normal_matrix_uniform, 1, GL_FALSE, glm::value_ptr(item.normal_matrix));
+            glDrawElements(item.objeto.rendering_mode, item.objeto.num_indices, item.objeto.index_type,
+                           item.objeto.first_index);
+            contadores.triangulos += (unsigned int)(item.objeto.num_indices / 3);
+        }
+        ++contadores.desenhos;
+    }
+
+    glBindVertexArray(0);
+}
+
+const ContadoresFila& FilaRender::getContadores() const
+{
+    return contadores;
+}
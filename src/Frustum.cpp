@@ -0,0 +1,40 @@
+#include "Frustum.h"
+#include <glm/geometric.hpp>
+
+Frustum::Frustum()
+{
+    // Sem extrai(), nada é descartado
+    for (int i = 0; i < 6; ++i)
+        planos[i] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+Frustum::~Frustum()
+{
+    //dtor
+}
+
+void Frustum::extrai(const glm::mat4& m)
+{
+    // Linhas da matriz; a glm guarda as colunas: m[coluna][linha]
+    glm::vec4 linha[4];
+    for (int i = 0; i < 4; ++i)
+        linha[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+
+    planos[0] = linha[3] + linha[0]; // Esquerda:  -w <= x
+    planos[1] = linha[3] - linha[0]; // Direita:    x <= w
+    planos[2] = linha[3] + linha[1]; // Baixo:     -w <= y
+    planos[3] = linha[3] - linha[1]; // Cima:       y <= w
+    planos[4] = linha[3] + linha[2]; // Near:      -w <= z
+    planos[5] = linha[3] - linha[2]; // Far:        z <= w
+
+    for (int i = 0; i < 6; ++i)
+        planos[i] /= glm::length(glm::vec3(planos[i]));
+}
+
+bool Frustum::contemEsfera(const glm::vec3& centro, float raio) const
+{
+    for (int i = 0; i < 6; ++i)
+        if (glm::dot(glm::vec3(planos[i]), centro) + planos[i].w < -raio)
+            return false;
+    return true;
+}
@@ -0,0 +1,104 @@
+#include "Instancias.h"
+#include <glm/matrix.hpp>
+
+// Locations dos atributos por instância em "shader_vertex.glsl". Uma mat4
+// ocupa quatro locations consecutivas, e uma mat3 três, uma por coluna.
+static const GLuint LOCATION_MODEL = 3;
+static const GLuint LOCATION_COR = 7;
+static const GLuint LOCATION_NORMAL = 8;
+
+glm::mat3 MatrizNormal(const glm::mat4& model, bool semelhanca)
+{
+    glm::mat3 m(model);
+    if (semelhanca)
+        return m;
+    return glm::transpose(glm::inverse(m));
+}
+
+LoteInstancias::LoteInstancias()
+{
+    vertex_array_object_id = 0;
+    VBO_instancias_id = 0;
+    capacidade = 0;
+    semelhancas = false;
+}
+
+LoteInstancias::~LoteInstancias()
+{
+    //dtor
+}
+
+// Anexa ao VAO do objeto (já com posições, cores e normais nas locations 0 a
+// 2) um VBO de instâncias, com divisor 1: os atributos avançam uma vez por
+// instância, e não uma vez por vértice.
+void LoteInstancias::inicializa(GLuint vao, bool so_semelhancas)
+{
+    vertex_array_object_id = vao;
+    semelhancas = so_semelhancas;
+
+    glBindVertexArray(vertex_array_object_id);
+    glGenBuffers(1, &VBO_instancias_id);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO_instancias_id);
+
+    for (GLuint coluna = 0; coluna < 4; ++coluna)
+    {
+        GLuint location = LOCATION_MODEL + coluna;
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(DadosInstancia),
+                              (void*)(offsetof(DadosInstancia, model) + coluna * sizeof(glm::vec4)));
+        glVertexAttribDivisor(location, 1);
+        glEnableVertexAttribArray(location);
+    }
+
+    glVertexAttribPointer(LOCATION_COR, 4, GL_FLOAT, GL_FALSE, sizeof(DadosInstancia),
+                          (void*)offsetof(DadosInstancia, cor));
+    glVertexAttribDivisor(LOCATION_COR, 1);
+    glEnableVertexAttribArray(LOCATION_COR);
+
+    for (GLuint coluna = 0; coluna < 3; ++coluna)
+    {
+        GLuint location = LOCATION_NORMAL + coluna;
+        glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, sizeof(DadosInstancia),
+                              (void*)(offsetof(DadosInstancia, normal_matrix) + coluna * sizeof(glm::vec3)));
+        glVertexAttribDivisor(location, 1);
+        glEnableVertexAttribArray(location);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+void LoteInstancias::limpa()
+{
+    dados.clear();
+}
+
+void LoteInstancias::adiciona(const glm::mat4& model, const glm::vec4& cor)
+{
+    DadosInstancia instancia;
+    instancia.model = model;
+    instancia.cor = cor;
+    instancia.normal_matrix = MatrizNormal(model, semelhancas);
+    dados.push_back(instancia);
+}
+
+size_t LoteInstancias::tamanho() const
+{
+    return dados.size();
+}
+
+// Envia as instâncias para a GPU. O armazenamento é realocado ("orphaning")
+// a cada quadro, para que o driver não precise esperar a GPU terminar de ler
+// os dados do quadro anterior; só cresce quando o lote cresce.
+void LoteInstancias::envia()
+{
+    if (dados.empty())
+        return;
+
+    if (dados.size() > capacidade)
+        capacidade = dados.size();
+
+    glBindBuffer(GL_ARRAY_BUFFER, VBO_instancias_id);
+    glBufferData(GL_ARRAY_BUFFER, capacidade * sizeof(DadosInstancia), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, dados.size() * sizeof(DadosInstancia), dados.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -0,0 +1,551 @@
+// Leitura paralela de OBJ (LeObjParalelo em Malha.h). O arquivo é mapeado em
+// memória e cortado em pedaços que terminam em fim de linha, um por thread.
+// Cada thread interpreta os registros v, vn, vt e f do seu pedaço; os
+// registros que mudam o estado da leitura (o, g, usemtl e mtllib) só são
+// anotados, com a posição em que apareceram, e aplicados na junção, que é
+// sequencial e segue as mesmas regras de tinyobj::LoadObj().
+#include "Malha.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <thread>
+#include <sys/stat.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Pedaços menores que isto não compensam uma thread a mais
+static const size_t BYTES_MINIMOS_POR_THREAD = 256 * 1024;
+
+enum TipoComando
+{
+    COMANDO_OBJETO,  // o
+    COMANDO_GRUPO,   // g
+    COMANDO_USEMTL,
+    COMANDO_MTLLIB
+};
+
+// Registro de estado, aplicado antes da face de número "face" do pedaço
+struct Comando
+{
+    TipoComando tipo;
+    std::string nome;
+    size_t face;
+};
+
+// Índice negativo (relativo ao fim da lista) de uma face. O valor já vem
+// somado ao número de atributos lidos pelo pedaço; falta somar os dos
+// pedaços anteriores, que só são conhecidos na junção.
+struct IndiceRelativo
+{
+    size_t canto;
+    int componente; // 0: vértice, 1: normal, 2: coordenada de textura
+    int valor;
+};
+
+struct PedacoObj
+{
+    std::vector<float> v, vn, vt;
+    std::vector<tinyobj::index_t> cantos;
+    std::vector<unsigned char> num_face_vertices;
+    std::vector<IndiceRelativo> relativos;
+    std::vector<Comando> comandos;
+    std::vector<tinyobj::index_t> poligono; // Temporário de FechaFace()
+};
+
+static inline bool EhEspaco(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline bool EhDigito(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static const char* PulaEspacos(const char* p, const char* fim)
+{
+    while (p < fim && EhEspaco(*p))
+        ++p;
+    return p;
+}
+
+static std::string LePalavra(const char* p, const char* fim)
+{
+    p = PulaEspacos(p, fim);
+    const char* inicio = p;
+    while (p < fim && !EhEspaco(*p))
+        ++p;
+    return std::string(inicio, p);
+}
+
+// Potências de 10 exatas em double
+static const double POTENCIAS_10[] =
+{
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Número decimal no formato de strtod (sem hexadecimais, inf e nan): até 19
+// dígitos significativos em um inteiro, escalados por uma potência de 10
+// exata. Sem dígitos, o valor é 0, como em tinyobj::parseFloat().
+static const char* LeFloat(const char* p, const char* fim, float* valor)
+{
+    p = PulaEspacos(p, fim);
+
+    bool negativo = false;
+    if (p < fim && (*p == '-' || *p == '+'))
+        negativo = *p++ == '-';
+
+    uint64_t mantissa = 0;
+    int digitos = 0, expoente = 0;
+    for (; p < fim && EhDigito(*p); ++p)
+    {
+        if (digitos < 19)
+        {
+            mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+            digitos += mantissa != 0;
+        }
+        else
+        {
+            ++expoente;
+        }
+    }
+    if (p < fim && *p == '.')
+    {
+        for (++p; p < fim && EhDigito(*p); ++p)
+        {
+            if (digitos < 19)
+            {
+                mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                digitos += mantissa != 0;
+                --expoente;
+            }
+        }
+    }
+    if (p < fim && (*p == 'e' || *p == 'E'))
+    {
+        const char* q = p + 1;
+        bool expoente_negativo = false;
+        if (q < fim && (*q == '-' || *q == '+'))
+            expoente_negativo = *q++ == '-';
+        if (q < fim && EhDigito(*q))
+        {
+            int e = 0;
+            for (; q < fim && EhDigito(*q); ++q)
+                e = std::min(e * 10 + (*q - '0'), 9999);
+            expoente += expoente_negativo ? -e : e;
+            p = q;
+        }
+    }
+
+    double resultado = (double)mantissa;
+    if (mantissa != 0)
+    {
+        while (expoente > 22)
+        {
+            resultado *= 1e22;
+            expoente -= 22;
+        }
+        while (expoente < -22)
+        {
+            resultado /= 1e22;
+            expoente += 22;
+        }
+        resultado = expoente < 0 ? resultado / POTENCIAS_10[-expoente] : resultado * POTENCIAS_10[expoente];
+    }
+    *valor = (float)(negativo ? -resultado : resultado);
+
+    // Descarta o que sobrar da palavra, como a tinyobjloader
+    while (p < fim && !EhEspaco(*p))
+        ++p;
+    return p;
+}
+
+static const char* LeInteiro(const char* p, const char* fim, int* valor)
+{
+    bool negativo = false;
+    if (p < fim && (*p == '-' || *p == '+'))
+        negativo = *p++ == '-';
+    int resultado = 0;
+    for (; p < fim && EhDigito(*p); ++p)
+        resultado = resultado * 10 + (*p - '0');
+    *valor = negativo ? -resultado : resultado;
+    return p;
+}
+
+// Um canto de face: "v", "v/vt", "v//vn" ou "v/vt/vn". Os índices do OBJ
+// começam em 1; 0 vira 0 e a ausência vira -1, como em tinyobj::fixIndex().
+static const char* LeCanto(const char* p, const char* fim, PedacoObj* pedaco)
+{
+    const int quantidades[3] =
+    {
+        (int)(pedaco->v.size() / 3), (int)(pedaco->vn.size() / 3), (int)(pedaco->vt.size() / 2)
+    };
+    int indices[3] = { -1, -1, -1 }; // Vértice, normal e coordenada de textura
+    int lidos[3] = { 0, 0, 0 };
+
+    p = LeInteiro(p, fim, &indices[0]);
+    lidos[0] = 1;
+    if (p < fim && *p == '/')
+    {
+        ++p;
+        if (p < fim && *p == '/')
+        {
+            p = LeInteiro(p + 1, fim, &indices[1]);
+            lidos[1] = 1;
+        }
+        else
+        {
+            p = LeInteiro(p, fim, &indices[2]);
+            lidos[2] = 1;
+            if (p < fim && *p == '/')
+            {
+                p = LeInteiro(p + 1, fim, &indices[1]);
+                lidos[1] = 1;
+            }
+        }
+    }
+    while (p < fim && !EhEspaco(*p))
+        ++p;
+
+    const size_t canto = pedaco->cantos.size();
+    for (int c = 0; c < 3; ++c)
+    {
+        if (!lidos[c])
+            continue;
+        if (indices[c] > 0)
+        {
+            indices[c] -= 1;
+        }
+        else if (indices[c] < 0)
+        {
+            IndiceRelativo relativo = { canto, c, quantidades[c] + indices[c] };
+            pedaco->relativos.push_back(relativo);
+            indices[c] = 0;
+        }
+    }
+
+    tinyobj::index_t indice;
+    indice.vertex_index = indices[0];
+    indice.normal_index = indices[1];
+    indice.texcoord_index = indices[2];
+    pedaco->cantos.push_back(indice);
+    return p;
+}
+
+// Os cantos de uma face já estão no fim de pedaco->cantos, a partir de
+// "primeiro". Com triangulate, o polígono vira um leque de triângulos.
+static void FechaFace(PedacoObj* pedaco, size_t primeiro, bool triangulate)
+{
+    const size_t num_cantos = pedaco->cantos.size() - primeiro;
+    if (!triangulate)
+    {
+        pedaco->num_face_vertices.push_back((unsigned char)num_cantos);
+        return;
+    }
+    if (num_cantos == 3)
+    {
+        pedaco->num_face_vertices.push_back(3);
+        return;
+    }
+
+    // O leque é montado sobre uma cópia do polígono
+    std::vector<tinyobj::index_t>& poligono = pedaco->poligono;
+    poligono.assign(pedaco->cantos.begin() + primeiro, pedaco->cantos.end());
+    pedaco->cantos.resize(primeiro);
+    for (size_t k = 2; k < num_cantos; ++k)
+    {
+        pedaco->cantos.push_back(poligono[0]);
+        pedaco->cantos.push_back(poligono[k - 1]);
+        pedaco->cantos.push_back(poligono[k]);
+        pedaco->num_face_vertices.push_back(3);
+    }
+
+    // Os índices relativos apontam para o canto pela posição: os desta face,
+    // os últimos da lista, são refeitos para as novas posições
+    size_t r = pedaco->relativos.size();
+    while (r > 0 && pedaco->relativos[r - 1].canto >= primeiro)
+        --r;
+    if (r == pedaco->relativos.size())
+        return;
+    std::vector<IndiceRelativo> relativos_face(pedaco->relativos.begin() + r, pedaco->relativos.end());
+    pedaco->relativos.resize(r);
+    for (size_t k = 2; k < num_cantos; ++k)
+    {
+        const size_t trio[3] = { 0, k - 1, k };
+        for (int i = 0; i < 3; ++i)
+        {
+            for (size_t j = 0; j < relativos_face.size(); ++j)
+            {
+                if (relativos_face[j].canto - primeiro == trio[i])
+                {
+                    IndiceRelativo relativo = relativos_face[j];
+                    relativo.canto = primeiro + 3 * (k - 2) + i;
+                    pedaco->relativos.push_back(relativo);
+                }
+            }
+        }
+    }
+}
+
+static void InterpretaPedaco(const char* p, const char* fim, bool triangulate, PedacoObj* pedaco)
+{
+    while (p < fim)
+    {
+        const char* fim_linha = (const char*)memchr(p, '\n', (size_t)(fim - p));
+        if (fim_linha == NULL)
+            fim_linha = fim;
+
+        const char* q = PulaEspacos(p, fim_linha);
+        const size_t resto = (size_t)(fim_linha - q);
+
+        if (resto >= 2 && q[0] == 'v' && EhEspaco(q[1]))
+        {
+            float x, y, z;
+            q = LeFloat(q + 2, fim_linha, &x);
+            q = LeFloat(q, fim_linha, &y);
+            LeFloat(q, fim_linha, &z);
+            pedaco->v.push_back(x);
+            pedaco->v.push_back(y);
+            pedaco->v.push_back(z);
+        }
+        else if (resto >= 3 && q[0] == 'v' && q[1] == 'n' && EhEspaco(q[2]))
+        {
+            float x, y, z;
+            q = LeFloat(q + 3, fim_linha, &x);
+            q = LeFloat(q, fim_linha, &y);
+            LeFloat(q, fim_linha, &z);
+            pedaco->vn.push_back(x);
+            pedaco->vn.push_back(y);
+            pedaco->vn.push_back(z);
+        }
+        else if (resto >= 3 && q[0] == 'v' && q[1] == 't' && EhEspaco(q[2]))
+        {
+            float x, y;
+            q = LeFloat(q + 3, fim_linha, &x);
+            LeFloat(q, fim_linha, &y);
+            pedaco->vt.push_back(x);
+            pedaco->vt.push_back(y);
+        }
+        else if (resto >= 2 && q[0] == 'f' && EhEspaco(q[1]))
+        {
+            const size_t primeiro = pedaco->cantos.size();
+            q = PulaEspacos(q + 2, fim_linha);
+            while (q < fim_linha)
+                q = PulaEspacos(LeCanto(q, fim_linha, pedaco), fim_linha);
+            // Face sem cantos suficientes: a tinyobjloader falharia; aqui ela é ignorada
+            if (pedaco->cantos.size() - primeiro < 3)
+                pedaco->cantos.resize(primeiro);
+            else
+                FechaFace(pedaco, primeiro, triangulate);
+        }
+        else if (resto >= 2 && (q[0] == 'o' || q[0] == 'g') && EhEspaco(q[1]))
+        {
+            Comando comando;
+            comando.tipo = q[0] == 'o' ? COMANDO_OBJETO : COMANDO_GRUPO;
+            comando.nome = LePalavra(q + 2, fim_linha);
+            comando.face = pedaco->num_face_vertices.size();
+            pedaco->comandos.push_back(comando);
+        }
+        else if (resto >= 7 && (strncmp(q, "usemtl", 6) == 0 || strncmp(q, "mtllib", 6) == 0) && EhEspaco(q[6]))
+        {
+            Comando comando;
+            comando.tipo = q[0] == 'u' ? COMANDO_USEMTL : COMANDO_MTLLIB;
+            comando.nome = LePalavra(q + 7, fim_linha);
+            comando.face = pedaco->num_face_vertices.size();
+            pedaco->comandos.push_back(comando);
+        }
+        // Comentários, "s" e registros desconhecidos são ignorados
+
+        p = fim_linha + 1;
+    }
+}
+
+// Copia as faces [primeira, ultima) do pedaço para a forma atual
+static void CopiaFaces(const PedacoObj& pedaco, size_t primeira, size_t ultima, size_t* canto, int material,
+                       tinyobj::shape_t* forma)
+{
+    size_t num_cantos = 0;
+    for (size_t f = primeira; f < ultima; ++f)
+        num_cantos += pedaco.num_face_vertices[f];
+
+    tinyobj::mesh_t& mesh = forma->mesh;
+    mesh.indices.insert(mesh.indices.end(), pedaco.cantos.begin() + *canto, pedaco.cantos.begin() + *canto + num_cantos);
+    mesh.num_face_vertices.insert(mesh.num_face_vertices.end(),
+                                  pedaco.num_face_vertices.begin() + primeira, pedaco.num_face_vertices.begin() + ultima);
+    mesh.material_ids.insert(mesh.material_ids.end(), ultima - primeira, material);
+    *canto += num_cantos;
+}
+
+bool LeObjParalelo(tinyobj::attrib_t* attrib, std::vector<tinyobj::shape_t>* shapes,
+                   std::vector<tinyobj::material_t>* materials, std::string* err,
+                   const char* filename, const char* mtl_basepath, bool triangulate, int num_threads)
+{
+    attrib->vertices.clear();
+    attrib->normals.clear();
+    attrib->texcoords.clear();
+    shapes->clear();
+
+    // Mapeia o arquivo (ou, sem mmap, lê para a memória)
+    const char* dados = NULL;
+    size_t tamanho = 0;
+    std::vector<char> copia;
+#ifdef _WIN32
+    FILE* entrada = fopen(filename, "rb");
+    if (entrada)
+    {
+        fseek(entrada, 0, SEEK_END);
+        long fim = ftell(entrada);
+        fseek(entrada, 0, SEEK_SET);
+        copia.resize(fim > 0 ? (size_t)fim : 0);
+        if (!copia.empty() && fread(copia.data(), 1, copia.size(), entrada) != copia.size())
+            copia.clear();
+        fclose(entrada);
+        dados = copia.data();
+        tamanho = copia.size();
+    }
+    const bool aberto = entrada != NULL;
+#else
+    bool aberto = false;
+    int descritor = open(filename, O_RDONLY);
+    if (descritor >= 0)
+    {
+        struct stat info;
+        if (fstat(descritor, &info) == 0)
+        {
+            aberto = true;
+            tamanho = (size_t)info.st_size;
+            if (tamanho > 0)
+            {
+                void* mapeamento = mmap(NULL, tamanho, PROT_READ, MAP_PRIVATE, descritor, 0);
+                if (mapeamento == MAP_FAILED)
+                    aberto = false;
+                else
+                    dados = (const char*)mapeamento;
+            }
+        }
+        close(descritor);
+    }
+#endif
+    if (!aberto)
+    {
+        if (err)
+            *err = std::string("Cannot open file [") + filename + "]\n";
+        return false;
+    }
+
+    // Pedaços terminados em fim de linha, de pelo menos BYTES_MINIMOS_POR_THREAD
+    if (num_threads <= 0)
+        num_threads = std::max((int)std::thread::hardware_concurrency(), 1);
+    num_threads = (int)std::max(std::min((size_t)num_threads, tamanho / BYTES_MINIMOS_POR_THREAD), (size_t)1);
+
+    std::vector<const char*> cortes(num_threads + 1);
+    cortes[0] = dados;
+    cortes[num_threads] = dados + tamanho;
+    for (int i = 1; i < num_threads; ++i)
+    {
+        const char* corte = std::max(dados + tamanho / num_threads * i, cortes[i - 1]);
+        const char* fim_linha = (const char*)memchr(corte, '\n', (size_t)(dados + tamanho - corte));
+        cortes[i] = fim_linha ? fim_linha + 1 : dados + tamanho;
+    }
+
+    std::vector<PedacoObj> pedacos(num_threads);
+    std::vector<std::thread> threads;
+    for (int i = 1; i < num_threads; ++i)
+        threads.push_back(std::thread(InterpretaPedaco, cortes[i], cortes[i + 1], triangulate, &pedacos[i]));
+    InterpretaPedaco(cortes[0], cortes[1], triangulate, &pedacos[0]);
+    for (size_t i = 0; i < threads.size(); ++i)
+        threads[i].join();
+
+#ifndef _WIN32
+    if (dados)
+        munmap((void*)dados, tamanho);
+#endif
+
+    // Junção: atributos em ordem, com os índices relativos corrigidos pela
+    // quantidade de atributos dos pedaços anteriores
+    size_t total_v = 0, total_vn = 0, total_vt = 0;
+    for (int i = 0; i < num_threads; ++i)
+    {
+        total_v += pedacos[i].v.size();
+        total_vn += pedacos[i].vn.size();
+        total_vt += pedacos[i].vt.size();
+    }
+    attrib->vertices.reserve(total_v);
+    attrib->normals.reserve(total_vn);
+    attrib->texcoords.reserve(total_vt);
+
+    std::map<std::string, int> material_map;
+    tinyobj::MaterialFileReader leitor_materiais(mtl_basepath ? mtl_basepath : "");
+    tinyobj::shape_t forma;
+    std::string nome;
+    int material = -1;
+
+    for (int i = 0; i < num_threads; ++i)
+    {
+        PedacoObj& pedaco = pedacos[i];
+        const int base[3] =
+        {
+            (int)(attrib->vertices.size() / 3), (int)(attrib->normals.size() / 3), (int)(attrib->texcoords.size() / 2)
+        };
+        for (size_t r = 0; r < pedaco.relativos.size(); ++r)
+        {
+            const IndiceRelativo& relativo = pedaco.relativos[r];
+            tinyobj::index_t& indice = pedaco.cantos[relativo.canto];
+            int* alvo = relativo.componente == 0 ? &indice.vertex_index
+                      : relativo.componente == 1 ? &indice.normal_index : &indice.texcoord_index;
+            *alvo = base[relativo.componente] + relativo.valor;
+        }
+        attrib->vertices.insert(attrib->vertices.end(), pedaco.v.begin(), pedaco.v.end());
+        attrib->normals.insert(attrib->normals.end(), pedaco.vn.begin(), pedaco.vn.end());
+        attrib->texcoords.insert(attrib->texcoords.end(), pedaco.vt.begin(), pedaco.vt.end());
+
+        size_t face = 0, canto = 0;
+        for (size_t c = 0; c < pedaco.comandos.size(); ++c)
+        {
+            const Comando& comando = pedaco.comandos[c];
+            CopiaFaces(pedaco, face, comando.face, &canto, material, &forma);
+            face = comando.face;
+
+            if (comando.tipo == COMANDO_USEMTL)
+            {
+                std::map<std::string, int>::const_iterator it = material_map.find(comando.nome);
+                material = it == material_map.end() ? -1 : it->second;
+            }
+            else if (comando.tipo == COMANDO_MTLLIB)
+            {
+                std::string err_mtl;
+                leitor_materiais(comando.nome, materials, &material_map, &err_mtl);
+                if (err)
+                    *err += err_mtl;
+            }
+            else
+            {
+                // "o" e "g" fecham a forma atual e dão nome à próxima
+                if (!forma.mesh.indices.empty())
+                {
+                    forma.name = nome;
+                    shapes->push_back(forma);
+                }
+                forma = tinyobj::shape_t();
+                nome = comando.nome;
+            }
+        }
+        CopiaFaces(pedaco, face, pedaco.num_face_vertices.size(), &canto, material, &forma);
+
+        // Libera o pedaço assim que ele foi copiado
+        pedaco = PedacoObj();
+    }
+
+    if (!forma.mesh.indices.empty())
+    {
+        forma.name = nome;
+        shapes->push_back(forma);
+    }
+    return true;
+}
@@ -0,0 +1,752 @@
+#include "Malha.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include <sys/stat.h>
+#include <glm/vec3.hpp>
+#include <glm/geometric.hpp>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Cabeçalho do arquivo .malha gravado por ArquivoMalha::Salva(). Depois dele
+// vêm num_vertices vértices no formato dado a partir de inicio_vertices e num_indices
+// índices de bytes_por_indice bytes a partir de inicio_indices. A versão muda
+// quando o formato ou a conversão mudam; tamanho_obj e modificacao_obj
+// descartam caches gravados para uma versão antiga do OBJ. Os níveis de
+// detalhe são trechos da mesma seção de índices.
+struct CabecalhoMalha
+{
+    char magica[4];
+    uint32_t versao;
+    uint32_t opcoes;            // OPCAO_NORMAIS_RECALCULADAS
+    uint32_t bytes_por_vertice; // BytesPorVertice(formato) de quem gravou
+    uint64_t tamanho_obj;
+    int64_t modificacao_obj;
+    uint32_t num_vertices, num_indices, bytes_por_indice;
+    uint32_t inicio_vertices, inicio_indices;
+    float min[3], max[3];
+    uint32_t formato;           // FormatoVertice
+    uint32_t num_niveis;        // Níveis de detalhe, de 1 a MAXIMO_NIVEIS_MALHA
+    NivelMalha niveis[MAXIMO_NIVEIS_MALHA];
+};
+
+static const char MAGICA_MALHA[4] = { 'P', 'M', 'S', 'H' };
+static const uint32_t VERSAO_MALHA = 4;
+static const uint32_t OPCAO_NORMAIS_RECALCULADAS = 1;
+
+// Alinhamento das seções do arquivo, para que os ponteiros dentro do
+// mapeamento possam ser lidos diretamente como float e uint32_t.
+static const size_t ALINHAMENTO_MALHA = 16;
+
+static size_t Alinha(size_t deslocamento)
+{
+    return (deslocamento + ALINHAMENTO_MALHA - 1) & ~(ALINHAMENTO_MALHA - 1);
+}
+
+// Tamanho e data de modificação do OBJ, guardados no cache para detectar que
+// ele ficou desatualizado sem precisar ler o OBJ.
+static bool IdentificaObj(const char* arquivo_obj, uint64_t* tamanho, int64_t* modificacao)
+{
+    struct stat info;
+    if (stat(arquivo_obj, &info) != 0)
+        return false;
+    *tamanho = (uint64_t)info.st_size;
+    *modificacao = (int64_t)info.st_mtime;
+    return true;
+}
+
+size_t BytesPorVertice(FormatoVertice formato)
+{
+    return formato == VERTICE_COMPACTO ? sizeof(VerticeCompacto) : sizeof(VerticeMalha);
+}
+
+// Componentes x, y e z em complemento de dois com 10 bits cada, nos bits
+// 0-9, 10-19 e 20-29; o componente w (bits 30-31) fica zero.
+uint32_t EmpacotaNormal(const float normal[3])
+{
+    uint32_t empacotado = 0;
+    for (int eixo = 0; eixo < 3; ++eixo)
+    {
+        const float c = fminf(fmaxf(normal[eixo], -1.0f), 1.0f);
+        const int32_t inteiro = (int32_t)lrintf(c * 511.0f);
+        empacotado |= ((uint32_t)inteiro & 0x3FFu) << (10 * eixo);
+    }
+    return empacotado;
+}
+
+void CompactaVertices(const std::vector<VerticeMalha>& vertices, std::vector<VerticeCompacto>* compactos)
+{
+    compactos->resize(vertices.size());
+    for (size_t i = 0; i < vertices.size(); ++i)
+    {
+        const VerticeMalha& v = vertices[i];
+        VerticeCompacto& c = (*compactos)[i];
+        memcpy(c.posicao, v.posicao, sizeof(c.posicao));
+        c.normal = EmpacotaNormal(v.normal);
+        for (int k = 0; k < 4; ++k)
+            c.cor[k] = (uint8_t)lrintf(fminf(fmaxf(v.cor[k], 0.0f), 1.0f) * 255.0f);
+    }
+}
+
+ObjModel::ObjModel(const char* filename, const char* basepath, bool triangulate)
+{
+    printf("Carregando modelo \"%s\"... ", filename);
+
+    std::string err;
+    bool ret = LeObjParalelo(&attrib, &shapes, &materials, &err, filename, basepath, triangulate);
+
+    if (!err.empty())
+        fprintf(stderr, "\n%s\n", err.c_str());
+
+    if (!ret)
+        throw std::runtime_error("Erro ao carregar modelo.");
+
+    printf("OK.\n");
+}
+
+void ComputeNormalsEscalar(ObjModel* model)
+{
+    if ( !model->attrib.normals.empty() )
+        return;
+
+    // Primeiro computamos as normais para todos os TRIÂNGULOS.
+    // Segundo, computamos as normais dos VÉRTICES através do método proposto
+    // por Gourad, onde a normal de cada vértice vai ser a média das normais de
+    // todas as faces que compartilham este vértice.
+
+    size_t num_vertices = model->attrib.vertices.size() / 3;
+
+    std::vector<int> num_triangles_per_vertex(num_vertices, 0);
+    std::vector<glm::vec3> vertex_normals(num_vertices, glm::vec3(0.0f,0.0f,0.0f));
+
+    for (size_t shape = 0; shape < model->shapes.size(); ++shape)
+    {
+        size_t num_triangles = model->shapes[shape].mesh.num_face_vertices.size();
+
+        for (size_t triangle = 0; triangle < num_triangles; ++triangle)
+        {
+            assert(model->shapes[shape].mesh.num_face_vertices[triangle] == 3);
+
+            glm::vec3  vertices[3];
+            for (size_t vertex = 0; vertex < 3; ++vertex)
+            {
+                tinyobj::index_t idx = model->shapes[shape].mesh.indices[3*triangle + vertex];
+                const float vx = model->attrib.vertices[3*idx.vertex_index + 0];
+                const float vy = model->attrib.vertices[3*idx.vertex_index + 1];
+                const float vz = model->attrib.vertices[3*idx.vertex_index + 2];
+                vertices[vertex] = glm::vec3(vx,vy,vz);
+            }
+
+            const glm::vec3  a = vertices[0];
+            const glm::vec3  b = vertices[1];
+            const glm::vec3  c = vertices[2];
+
+            // Normal de um triângulo cujos vértices estão nos pontos "a", "b",
+            // e "c", definidos no sentido anti-horário.
+            const glm::vec3  n = glm::cross(b-a, c-b);
+
+            for (size_t vertex = 0; vertex < 3; ++vertex)
+            {
+                tinyobj::index_t idx = model->shapes[shape].mesh.indices[3*triangle + vertex];
+                num_triangles_per_vertex[idx.vertex_index] += 1;
+                vertex_normals[idx.vertex_index] += n;
+                model->shapes[shape].mesh.indices[3*triangle + vertex].normal_index = idx.vertex_index;
+            }
+        }
+    }
+
+    model->attrib.normals.resize( 3*num_vertices );
+
+    for (size_t i = 0; i < vertex_normals.size(); ++i)
+    {
+        glm::vec3 n = vertex_normals[i] / (float)num_triangles_per_vertex[i];
+        n /= glm::length(n);
+        model->attrib.normals[3*i + 0] = n.x;
+        model->attrib.normals[3*i + 1] = n.y;
+        model->attrib.normals[3*i + 2] = n.z;
+    }
+}
+
+// Cada canto de triângulo vira primeiro um vértice próprio, como BuildCar()
+// e BuildCow() sempre fizeram; OtimizaMalha() solda os repetidos no final.
+void ConverteObj(const char* arquivo_obj, bool recalcula_normais, Malha* malha, RelatorioMalha* relatorio)
+{
+    ObjModel model(arquivo_obj);
+
+    if (recalcula_normais)
+        model.attrib.normals.clear();
+
+    ComputeNormals(&model);
+
+    malha->vertices.clear();
+    malha->indices.clear();
+
+    for (size_t shape = 0; shape < model.shapes.size(); ++shape)
+    {
+        size_t num_triangles = model.shapes[shape].mesh.num_face_vertices.size();
+
+        for (size_t triangle = 0; triangle < num_triangles; ++triangle)
+        {
+            assert(model.shapes[shape].mesh.num_face_vertices[triangle] == 3);
+
+            for (size_t vertex = 0; vertex < 3; ++vertex)
+            {
+                tinyobj::index_t idx = model.shapes[shape].mesh.indices[3*triangle + vertex];
+
+                VerticeMalha v;
+                v.posicao[0] = model.attrib.vertices[3*idx.vertex_index + 0];
+                v.posicao[1] = model.attrib.vertices[3*idx.vertex_index + 1];
+                v.posicao[2] = model.attrib.vertices[3*idx.vertex_index + 2];
+
+                // Branco: a cor final vem da instância (LoteInstancias)
+                v.cor[0] = v.cor[1] = v.cor[2] = v.cor[3] = 1.0f;
+
+                // Inspecionando o código da tinyobjloader, o aluno Bernardo
+                // Sulzbach (2017/1) apontou que a maneira correta de testar se
+                // existem normais e coordenadas de textura no ObjModel é
+                // comparando se o índice retornado é -1.
+                if ( idx.normal_index != -1 )
+                {
+                    v.normal[0] = model.attrib.normals[3*idx.normal_index + 0];
+                    v.normal[1] = model.attrib.normals[3*idx.normal_index + 1];
+                    v.normal[2] = model.attrib.normals[3*idx.normal_index + 2];
+                }
+                else
+                {
+                    v.normal[0] = v.normal[1] = v.normal[2] = 0.0f;
+                }
+
+                malha->indices.push_back((uint32_t)malha->vertices.size());
+                malha->vertices.push_back(v);
+            }
+        }
+    }
+
+    for (int eixo = 0; eixo < 3; ++eixo)
+    {
+        malha->limites.min[eixo] = malha->vertices.empty() ? 0.0f : INFINITY;
+        malha->limites.max[eixo] = malha->vertices.empty() ? 0.0f : -INFINITY;
+    }
+    for (size_t i = 0; i < malha->vertices.size(); ++i)
+    {
+        for (int eixo = 0; eixo < 3; ++eixo)
+        {
+            malha->limites.min[eixo] = fminf(malha->limites.min[eixo], malha->vertices[i].posicao[eixo]);
+            malha->limites.max[eixo] = fmaxf(malha->limites.max[eixo], malha->vertices[i].posicao[eixo]);
+        }
+    }
+
+    OtimizaMalha(malha, relatorio);
+    GeraNiveisDeDetalhe(malha);
+}
+
+void OtimizaMalha(Malha* malha, RelatorioMalha* relatorio)
+{
+    if (relatorio)
+    {
+        relatorio->vertices_antes = malha->vertices.size();
+        relatorio->acmr_antes = CalculaAcmr(malha->indices, malha->vertices.size());
+    }
+
+    SoldaVertices(malha);
+    if (relatorio)
+        relatorio->acmr_soldado = CalculaAcmr(malha->indices, malha->vertices.size());
+
+    OtimizaCacheVertices(&malha->indices, malha->vertices.size());
+    OtimizaBuscaVertices(malha);
+
+    if (relatorio)
+    {
+        relatorio->vertices_depois = malha->vertices.size();
+        relatorio->acmr_depois = CalculaAcmr(malha->indices, malha->vertices.size());
+    }
+}
+
+// Os vértices são comparados bit a bit: só são soldados cantos que a
+// conversão gerou exatamente iguais, o que não altera a imagem desenhada.
+struct HashVertice
+{
+    size_t operator()(const VerticeMalha& v) const
+    {
+        const unsigned char* bytes = (const unsigned char*)&v;
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < sizeof(VerticeMalha); ++i)
+        {
+            hash ^= bytes[i];
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+};
+
+struct IgualVertice
+{
+    bool operator()(const VerticeMalha& a, const VerticeMalha& b) const
+    {
+        return memcmp(&a, &b, sizeof(VerticeMalha)) == 0;
+    }
+};
+
+void SoldaVertices(Malha* malha)
+{
+    std::unordered_map<VerticeMalha, uint32_t, HashVertice, IgualVertice> unicos;
+    unicos.reserve(malha->vertices.size());
+
+    std::vector<VerticeMalha> vertices;
+    std::vector<uint32_t> novo_indice(malha->vertices.size());
+    for (size_t i = 0; i < malha->vertices.size(); ++i)
+    {
+        std::pair<std::unordered_map<VerticeMalha, uint32_t, HashVertice, IgualVertice>::iterator, bool> r =
+            unicos.insert(std::make_pair(malha->vertices[i], (uint32_t)vertices.size()));
+        if (r.second)
+            vertices.push_back(malha->vertices[i]);
+        novo_indice[i] = r.first->second;
+    }
+
+    for (size_t i = 0; i < malha->indices.size(); ++i)
+        malha->indices[i] = novo_indice[malha->indices[i]];
+    malha->vertices.swap(vertices);
+}
+
+// Pontuação de um vértice no algoritmo de Forsyth: vértices recém-usados
+// (no começo do cache) e com poucos triângulos restantes atraem os próximos
+// triângulos. Os três últimos usados têm pontuação fixa, um pouco menor, para
+// não favorecer tiras longas e finas.
+static float PontuacaoVertice(int posicao_cache, uint32_t triangulos_restantes)
+{
+    if (triangulos_restantes == 0)
+        return -1.0f;
+
+    float pontuacao = 0.0f;
+    if (posicao_cache >= 0)
+    {
+        if (posicao_cache < 3)
+            pontuacao = 0.75f;
+        else
+            pontuacao = powf(1.0f - (float)(posicao_cache - 3) / (TAMANHO_CACHE_VERTICES - 3), 1.5f);
+    }
+    return pontuacao + 2.0f / sqrtf((float)triangulos_restantes);
+}
+
+void OtimizaCacheVertices(std::vector<uint32_t>* indices, size_t num_vertices)
+{
+    const size_t num_triangulos = indices->size() / 3;
+    const uint32_t* tri = indices->data();
+    if (num_triangulos == 0)
+        return;
+
+    // Triângulos de cada vértice, em um único vetor (como a grade da Pista).
+    // Os ainda não emitidos do vértice v ficam em
+    // triangulos_do_vertice[inicio[v] .. inicio[v] + restantes[v]).
+    std::vector<uint32_t> inicio(num_vertices + 1, 0);
+    for (size_t i = 0; i < 3 * num_triangulos; ++i)
+        ++inicio[tri[i] + 1];
+    for (size_t v = 0; v < num_vertices; ++v)
+        inicio[v + 1] += inicio[v];
+
+    std::vector<uint32_t> restantes(num_vertices, 0);
+    std::vector<uint32_t> triangulos_do_vertice(3 * num_triangulos);
+    for (size_t t = 0; t < num_triangulos; ++t)
+        for (int k = 0; k < 3; ++k)
+        {
+            const uint32_t v = tri[3 * t + k];
+            triangulos_do_vertice[inicio[v] + restantes[v]++] = (uint32_t)t;
+        }
+
+    std::vector<int> posicao(num_vertices, -1);
+    std::vector<float> pontuacao_vertice(num_vertices);
+    for (size_t v = 0; v < num_vertices; ++v)
+        pontuacao_vertice[v] = PontuacaoVertice(-1, restantes[v]);
+
+    std::vector<float> pontuacao_triangulo(num_triangulos);
+    std::vector<uint8_t> emitido(num_triangulos, 0);
+    long melhor = 0;
+    for (size_t t = 0; t < num_triangulos; ++t)
+    {
+        pontuacao_triangulo[t] = pontuacao_vertice[tri[3 * t]] + pontuacao_vertice[tri[3 * t + 1]] + pontuacao_vertice[tri[3 * t + 2]];
+        if (pontuacao_triangulo[t] > pontuacao_triangulo[melhor])
+            melhor = (long)t;
+    }
+
+    std::vector<uint32_t> saida;
+    saida.reserve(3 * num_triangulos);
+
+    uint32_t cache[TAMANHO_CACHE_VERTICES + 3];
+    int tamanho_cache = 0;
+    size_t proximo_livre = 0;
+
+    while (saida.size() < 3 * num_triangulos)
+    {
+        // Nenhum triângulo com vértices no cache: recomeça do primeiro
+        // triângulo ainda não emitido.
+        if (melhor < 0)
+        {
+            while (emitido[proximo_livre])
+                ++proximo_livre;
+            melhor = (long)proximo_livre;
+        }
+
+        emitido[melhor] = 1;
+        uint32_t novo_cache[TAMANHO_CACHE_VERTICES + 3];
+        int tamanho_novo = 0;
+        for (int k = 0; k < 3; ++k)
+        {
+            const uint32_t v = tri[3 * melhor + k];
+            saida.push_back(v);
+            novo_cache[tamanho_novo++] = v;
+
+            uint32_t* lista = &triangulos_do_vertice[inicio[v]];
+            for (uint32_t j = 0; j < restantes[v]; ++j)
+            {
+                if (lista[j] == (uint32_t)melhor)
+                {
+                    lista[j] = lista[restantes[v] - 1];
+                    break;
+                }
+            }
+            --restantes[v];
+        }
+
+        // Os vértices do triângulo emitido vão para o começo do cache (LRU);
+        // os que passam do tamanho dele saem.
+        for (int i = 0; i < tamanho_cache; ++i)
+        {
+            const uint32_t v = cache[i];
+            if (v != novo_cache[0] && v != novo_cache[1] && v != novo_cache[2])
+                novo_cache[tamanho_novo++] = v;
+        }
+        for (int i = 0; i < tamanho_novo; ++i)
+        {
+            const uint32_t v = novo_cache[i];
+            posicao[v] = i < TAMANHO_CACHE_VERTICES ? i : -1;
+            pontuacao_vertice[v] = PontuacaoVertice(posicao[v], restantes[v]);
+        }
+        tamanho_cache = tamanho_novo < TAMANHO_CACHE_VERTICES ? tamanho_novo : TAMANHO_CACHE_VERTICES;
+        memcpy(cache, novo_cache, tamanho_cache * sizeof(uint32_t));
+
+        // Só os triângulos que tocam o cache mudaram de pontuação, e o
+        // próximo escolhido é sempre um deles.
+        melhor = -1;
+        float melhor_pontuacao = -1.0f;
+        for (int i = 0; i < tamanho_novo; ++i)
+        {
+            const uint32_t v = novo_cache[i];
+            const uint32_t* lista = &triangulos_do_vertice[inicio[v]];
+            for (uint32_t j = 0; j < restantes[v]; ++j)
+            {
+                const uint32_t t = lista[j];
+                pontuacao_triangulo[t] = pontuacao_vertice[tri[3 * t]] + pontuacao_vertice[tri[3 * t + 1]] + pontuacao_vertice[tri[3 * t + 2]];
+                if (pontuacao_triangulo[t] > melhor_pontuacao)
+                {
+                    melhor_pontuacao = pontuacao_triangulo[t];
+                    melhor = (long)t;
+                }
+            }
+        }
+    }
+
+    indices->swap(saida);
+}
+
+// Vértices que nenhum triângulo usa são descartados.
+void OtimizaBuscaVertices(Malha* malha)
+{
+    const uint32_t SEM_INDICE = 0xFFFFFFFFu;
+    std::vector<uint32_t> novo_indice(malha->vertices.size(), SEM_INDICE);
+    std::vector<VerticeMalha> vertices;
+    vertices.reserve(malha->vertices.size());
+
+    for (size_t i = 0; i < malha->indices.size(); ++i)
+    {
+        uint32_t& indice = malha->indices[i];
+        if (novo_indice[indice] == SEM_INDICE)
+        {
+            novo_indice[indice] = (uint32_t)vertices.size();
+            vertices.push_back(malha->vertices[indice]);
+        }
+        indice = novo_indice[indice];
+    }
+
+    malha->vertices.swap(vertices);
+}
+
+// Cache FIFO: o vértice v está no cache se foi inserido há menos de
+// tamanho_cache falhas.
+float CalculaAcmr(const std::vector<uint32_t>& indices, size_t num_vertices, int tamanho_cache)
+{
+    if (indices.size() < 3)
+        return 0.0f;
+
+    std::vector<long> inserido_em(num_vertices, -1);
+    long falhas = 0;
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        const uint32_t v = indices[i];
+        if (inserido_em[v] < 0 || falhas - inserido_em[v] >= tamanho_cache)
+        {
+            inserido_em[v] = falhas;
+            ++falhas;
+        }
+    }
+    return (float)falhas / (float)(indices.size() / 3);
+}
+
+ArquivoMalha::ArquivoMalha()
+{
+    dados = NULL;
+    tamanho = 0;
+    memset(&limites, 0, sizeof(limites));
+}
+
+ArquivoMalha::~ArquivoMalha()
+{
+    fecha();
+}
+
+void ArquivoMalha::fecha()
+{
+#ifndef _WIN32
+    if (dados && copia.empty())
+        munmap((void*)dados, tamanho);
+#endif
+    copia.clear();
+    dados = NULL;
+    tamanho = 0;
+}
+
+// Retorna false, sem mensagem, se o cache não existe. Um cache inválido ou
+// desatualizado é ignorado com aviso. Se o OBJ de origem não existe, o cache
+// é aceito sem verificação: ele é a única cópia da malha.
+bool ArquivoMalha::abre(const char* arquivo, const char* arquivo_obj, bool recalcula_normais, FormatoVertice formato)
+{
+    fecha();
+
+#ifdef _WIN32
+    FILE* entrada = fopen(arquivo, "rb");
+    if (!entrada)
+        return false;
+    fseek(entrada, 0, SEEK_END);
+    long fim = ftell(entrada);
+    fseek(entrada, 0, SEEK_SET);
+    if (fim > 0)
+    {
+        copia.resize((size_t)fim);
+        if (fread(copia.data(), 1, copia.size(), entrada) != copia.size())
+            copia.clear();
+    }
+    fclose(entrada);
+    if (copia.empty())
+        return false;
+    dados = copia.data();
+    tamanho = copia.size();
+#else
+    int descritor = open(arquivo, O_RDONLY);
+    if (descritor < 0)
+        return false;
+    struct stat info;
+    if (fstat(descritor, &info) != 0 || info.st_size <= 0)
+    {
+        close(descritor);
+        return false;
+    }
+    void* mapeamento = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, descritor, 0);
+    close(descritor);
+    if (mapeamento == MAP_FAILED)
+        return false;
+    dados = (const unsigned char*)mapeamento;
+    tamanho = (size_t)info.st_size;
+#endif
+
+    CabecalhoMalha cabecalho;
+    bool ok = tamanho >= sizeof(cabecalho);
+    if (ok)
+    {
+        memcpy(&cabecalho, dados, sizeof(cabecalho));
+        ok = memcmp(cabecalho.magica, MAGICA_MALHA, sizeof(MAGICA_MALHA)) == 0
+          && cabecalho.versao == VERSAO_MALHA
+          && (cabecalho.formato == VERTICE_FLOAT || cabecalho.formato == VERTICE_COMPACTO)
+          && cabecalho.bytes_por_vertice == BytesPorVertice((FormatoVertice)cabecalho.formato)
+          && (cabecalho.bytes_por_indice == 2 || cabecalho.bytes_por_indice == 4)
+          && cabecalho.inicio_vertices % ALINHAMENTO_MALHA == 0
+          && cabecalho.inicio_indices % ALINHAMENTO_MALHA == 0
+          && (uint64_t)cabecalho.inicio_vertices + (uint64_t)cabecalho.num_vertices * cabecalho.bytes_por_vertice <= cabecalho.inicio_indices
+          && (uint64_t)cabecalho.inicio_indices + (uint64_t)cabecalho.num_indices * cabecalho.bytes_por_indice <= tamanho
+          && cabecalho.num_niveis >= 1 && cabecalho.num_niveis <= (uint32_t)MAXIMO_NIVEIS_MALHA;
+        for (uint32_t i = 0; ok && i < cabecalho.num_niveis; ++i)
+            ok = (uint64_t)cabecalho.niveis[i].primeiro_indice + cabecalho.niveis[i].num_indices <= cabecalho.num_indices;
+    }
+    if (!ok)
+    {
+        fprintf(stderr, "WARNING: Ignoring invalid mesh cache \"%s\".\n", arquivo);
+        fecha();
+        return false;
+    }
+
+    uint64_t tamanho_obj;
+    int64_t modificacao_obj;
+    const uint32_t opcoes = recalcula_normais ? OPCAO_NORMAIS_RECALCULADAS : 0;
+    if (cabecalho.opcoes != opcoes)
+    {
+        fprintf(stderr, "WARNING: Ignoring mesh cache \"%s\" converted with other options.\n", arquivo);
+        fecha();
+        return false;
+    }
+    if (cabecalho.formato != (uint32_t)formato)
+    {
+        fprintf(stderr, "WARNING: Ignoring mesh cache \"%s\" written with another vertex format.\n", arquivo);
+        fecha();
+        return false;
+    }
+    if (IdentificaObj(arquivo_obj, &tamanho_obj, &modificacao_obj)
+        && (tamanho_obj != cabecalho.tamanho_obj || modificacao_obj != cabecalho.modificacao_obj))
+    {
+        fprintf(stderr, "WARNING: Ignoring stale mesh cache \"%s\" (\"%s\" changed).\n", arquivo, arquivo_obj);
+        fecha();
+        return false;
+    }
+
+    memcpy(limites.min, cabecalho.min, sizeof(limites.min));
+    memcpy(limites.max, cabecalho.max, sizeof(limites.max));
+    return true;
+}
+
+const void* ArquivoMalha::getVertices() const
+{
+    const CabecalhoMalha* cabecalho = (const CabecalhoMalha*)dados;
+    return dados + cabecalho->inicio_vertices;
+}
+
+FormatoVertice ArquivoMalha::formato() const
+{
+    return (FormatoVertice)((const CabecalhoMalha*)dados)->formato;
+}
+
+uint32_t ArquivoMalha::numeroDeVertices() const
+{
+    return ((const CabecalhoMalha*)dados)->num_vertices;
+}
+
+const void* ArquivoMalha::getIndices() const
+{
+    const CabecalhoMalha* cabecalho = (const CabecalhoMalha*)dados;
+    return dados + cabecalho->inicio_indices;
+}
+
+uint32_t ArquivoMalha::numeroDeIndices() const
+{
+    return ((const CabecalhoMalha*)dados)->num_indices;
+}
+
+uint32_t ArquivoMalha::bytesPorIndice() const
+{
+    return ((const CabecalhoMalha*)dados)->bytes_por_indice;
+}
+
+uint32_t ArquivoMalha::numeroDeNiveis() const
+{
+    return ((const CabecalhoMalha*)dados)->num_niveis;
+}
+
+NivelMalha ArquivoMalha::getNivel(uint32_t nivel) const
+{
+    return ((const CabecalhoMalha*)dados)->niveis[nivel];
+}
+
+const LimitesMalha& ArquivoMalha::getLimites() const
+{
+    return limites;
+}
+
+// Índices de 16 bits sempre que os vértices couberem: metade da memória e da
+// banda de leitura de índices na GPU.
+bool ArquivoMalha::Salva(const char* arquivo, const char* arquivo_obj, bool recalcula_normais, const Malha& malha,
+                         FormatoVertice formato)
+{
+    std::vector<VerticeCompacto> compactos;
+    const void* vertices = malha.vertices.data();
+    if (formato == VERTICE_COMPACTO)
+    {
+        CompactaVertices(malha.vertices, &compactos);
+        vertices = compactos.data();
+    }
+
+    CabecalhoMalha cabecalho;
+    memset(&cabecalho, 0, sizeof(cabecalho));
+    memcpy(cabecalho.magica, MAGICA_MALHA, sizeof(MAGICA_MALHA));
+    cabecalho.versao = VERSAO_MALHA;
+    cabecalho.opcoes = recalcula_normais ? OPCAO_NORMAIS_RECALCULADAS : 0;
+    cabecalho.bytes_por_vertice = (uint32_t)BytesPorVertice(formato);
+    cabecalho.formato = formato;
+    if (!IdentificaObj(arquivo_obj, &cabecalho.tamanho_obj, &cabecalho.modificacao_obj))
+    {
+        fprintf(stderr, "ERROR: Cannot stat OBJ file \"%s\".\n", arquivo_obj);
+        return false;
+    }
+    cabecalho.num_vertices = (uint32_t)malha.vertices.size();
+    cabecalho.num_indices = (uint32_t)malha.indices.size();
+    cabecalho.bytes_por_indice = malha.vertices.size() <= 65536 ? 2 : 4;
+    cabecalho.inicio_vertices = (uint32_t)Alinha(sizeof(cabecalho));
+    cabecalho.inicio_indices = (uint32_t)Alinha(cabecalho.inicio_vertices + malha.vertices.size() * cabecalho.bytes_por_vertice);
+    memcpy(cabecalho.min, malha.limites.min, sizeof(cabecalho.min));
+    memcpy(cabecalho.max, malha.limites.max, sizeof(cabecalho.max));
+    if (malha.niveis.empty())
+    {
+        cabecalho.num_niveis = 1;
+        cabecalho.niveis[0].primeiro_indice = 0;
+        cabecalho.niveis[0].num_indices = cabecalho.num_indices;
+    }
+    else
+    {
+        cabecalho.num_niveis = (uint32_t)std::min(malha.niveis.size(), (size_t)MAXIMO_NIVEIS_MALHA);
+        for (uint32_t i = 0; i < cabecalho.num_niveis; ++i)
+            cabecalho.niveis[i] = malha.niveis[i];
+    }
+
+    std::vector<unsigned char> conteudo(cabecalho.inicio_indices + malha.indices.size() * cabecalho.bytes_por_indice, 0);
+    memcpy(conteudo.data(), &cabecalho, sizeof(cabecalho));
+    if (!malha.vertices.empty())
+        memcpy(conteudo.data() + cabecalho.inicio_vertices, vertices, malha.vertices.size() * cabecalho.bytes_por_vertice);
+    if (cabecalho.bytes_por_indice == 2)
+    {
+        for (size_t i = 0; i < malha.indices.size(); ++i)
+        {
+            uint16_t indice = (uint16_t)malha.indices[i];
+            memcpy(conteudo.data() + cabecalho.inicio_indices + 2 * i, &indice, 2);
+        }
+    }
+    else if (!malha.indices.empty())
+    {
+        memcpy(conteudo.data() + cabecalho.inicio_indices, malha.indices.data(), malha.indices.size() * 4);
+    }
+
+    FILE* saida = fopen(arquivo, "wb");
+    if (!saida)
+    {
+        fprintf(stderr, "ERROR: Cannot write mesh cache \"%s\".\n", arquivo);
+        return false;
+    }
+    bool ok = fwrite(conteudo.data(), 1, conteudo.size(), saida) == conteudo.size();
+    ok = (fclose(saida) == 0) && ok;
+    if (!ok)
+        fprintf(stderr, "ERROR: Failed writing mesh cache \"%s\".\n", arquivo);
+    return ok;
+}
+
+// Car.obj -> Car.malha, no mesmo diretório.
+std::string ArquivoMalha::CaminhoCache(const char* arquivo_obj)
+{
+    std::string caminho(arquivo_obj);
+    size_t barra = caminho.find_last_of("/\\");
+    size_t ponto = caminho.find_last_of('.');
+    if (ponto != std::string::npos && (barra == std::string::npos || ponto > barra))
+        caminho.erase(ponto);
+    return caminho + ".malha";
+}
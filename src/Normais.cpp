@@ -0,0 +1,288 @@
+// Normais de vértice (ComputeNormals e CalculaNormaisVertices em Malha.h).
+// Os triângulos são processados em lotes de 4 (SSE2) ou 8 (AVX): as posições
+// dos cantos são transpostas para estrutura de arrays, um registrador por
+// coordenada, e a normal de face e os pesos de cada canto saem de uma
+// instrução por lote; só a soma nos vértices é escalar. Posições e somas
+// continuam intercaladas (xyz) na memória, para que cada vértice visitado
+// custe uma linha de cache e não três. Os triângulos são divididos entre
+// threads, cada uma com seu acumulador; a redução soma os acumuladores por
+// faixa de vértices, também em paralelo, e já normaliza o resultado.
+#include "Malha.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <thread>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define NORMAIS_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NORMAIS_SSE2
+#endif
+
+// Com menos triângulos que isto por thread, o custo de zerar e reduzir mais
+// um acumulador não compensa
+static const size_t MINIMO_TRIANGULOS_POR_THREAD = 32768;
+
+// Operações sobre um lote de floats: os mesmos kernels servem para SSE2, AVX
+// e para a versão escalar (lote de 1), que processa o resto dos triângulos.
+template <int largura> struct OperacoesLote;
+
+template <> struct OperacoesLote<1>
+{
+    typedef float Tipo;
+    static float constante(float v) { return v; }
+    static float carrega(const float* p) { return *p; }
+    static void guarda(float* p, float a) { *p = a; }
+};
+
+static inline float Soma(float a, float b) { return a + b; }
+static inline float Subtrai(float a, float b) { return a - b; }
+static inline float Multiplica(float a, float b) { return a * b; }
+static inline float Divide(float a, float b) { return a / b; }
+static inline float Raiz(float a) { return sqrtf(a); }
+// Como _mm_min_ps e _mm_max_ps: se algum dos dois for NaN, o resultado é b
+static inline float Minimo(float a, float b) { return a < b ? a : b; }
+static inline float Maximo(float a, float b) { return a > b ? a : b; }
+static inline float SeMaiorQueZero(float a, float valor) { return a > 0.0f ? valor : 0.0f; }
+
+#if defined(NORMAIS_AVX)
+typedef __m256 Lote;
+static const int LARGURA = 8;
+template <> struct OperacoesLote<LARGURA>
+{
+    typedef Lote Tipo;
+    static Lote constante(float v) { return _mm256_set1_ps(v); }
+    static Lote carrega(const float* p) { return _mm256_loadu_ps(p); }
+    static void guarda(float* p, Lote a) { _mm256_storeu_ps(p, a); }
+};
+static inline Lote Soma(Lote a, Lote b) { return _mm256_add_ps(a, b); }
+static inline Lote Subtrai(Lote a, Lote b) { return _mm256_sub_ps(a, b); }
+static inline Lote Multiplica(Lote a, Lote b) { return _mm256_mul_ps(a, b); }
+static inline Lote Divide(Lote a, Lote b) { return _mm256_div_ps(a, b); }
+static inline Lote Raiz(Lote a) { return _mm256_sqrt_ps(a); }
+static inline Lote Minimo(Lote a, Lote b) { return _mm256_min_ps(a, b); }
+static inline Lote Maximo(Lote a, Lote b) { return _mm256_max_ps(a, b); }
+static inline Lote SeMaiorQueZero(Lote a, Lote valor) { return _mm256_and_ps(_mm256_cmp_ps(a, _mm256_setzero_ps(), _CMP_GT_OQ), valor); }
+#elif defined(NORMAIS_SSE2)
+typedef __m128 Lote;
+static const int LARGURA = 4;
+template <> struct OperacoesLote<LARGURA>
+{
+    typedef Lote Tipo;
+    static Lote constante(float v) { return _mm_set1_ps(v); }
+    static Lote carrega(const float* p) { return _mm_loadu_ps(p); }
+    static void guarda(float* p, Lote a) { _mm_storeu_ps(p, a); }
+};
+static inline Lote Soma(Lote a, Lote b) { return _mm_add_ps(a, b); }
+static inline Lote Subtrai(Lote a, Lote b) { return _mm_sub_ps(a, b); }
+static inline Lote Multiplica(Lote a, Lote b) { return _mm_mul_ps(a, b); }
+static inline Lote Divide(Lote a, Lote b) { return _mm_div_ps(a, b); }
+static inline Lote Raiz(Lote a) { return _mm_sqrt_ps(a); }
+static inline Lote Minimo(Lote a, Lote b) { return _mm_min_ps(a, b); }
+static inline Lote Maximo(Lote a, Lote b) { return _mm_max_ps(a, b); }
+static inline Lote SeMaiorQueZero(Lote a, Lote valor) { return _mm_and_ps(_mm_cmpgt_ps(a, _mm_setzero_ps()), valor); }
+#else
+static const int LARGURA = 1;
+#endif
+
+// Uma coordenada dos vértices do canto "canto" dos triângulos de um lote
+static inline float Junta(const float* coordenada, const uint32_t* triangulos, int canto, float)
+{
+    return coordenada[3 * triangulos[canto]];
+}
+
+#if defined(NORMAIS_AVX)
+static inline Lote Junta(const float* coordenada, const uint32_t* triangulos, int canto, Lote)
+{
+    const uint32_t* t = triangulos + canto;
+    return _mm256_set_ps(coordenada[3 * t[21]], coordenada[3 * t[18]], coordenada[3 * t[15]], coordenada[3 * t[12]],
+                         coordenada[3 * t[9]], coordenada[3 * t[6]], coordenada[3 * t[3]], coordenada[3 * t[0]]);
+}
+#elif defined(NORMAIS_SSE2)
+static inline Lote Junta(const float* coordenada, const uint32_t* triangulos, int canto, Lote)
+{
+    const uint32_t* t = triangulos + canto;
+    return _mm_set_ps(coordenada[3 * t[9]], coordenada[3 * t[6]], coordenada[3 * t[3]], coordenada[3 * t[0]]);
+}
+#endif
+
+template <typename T>
+static inline T Ponto(T ax, T ay, T az, T bx, T by, T bz)
+{
+    return Soma(Soma(Multiplica(ax, bx), Multiplica(ay, by)), Multiplica(az, bz));
+}
+
+// Normais de face de um lote de triângulos, somadas nos três vértices. Com
+// PESO_AREA, a normal não normalizada (o dobro da área); com PESO_ANGULO, a
+// normal unitária vezes o ângulo de cada canto. A normal é cross(b-a, c-b),
+// como sempre foi, para que o sentido não mude.
+template <int largura>
+static void AcumulaLote(const float* posicoes, const uint32_t* triangulos, PesoNormais peso, float* acumulador)
+{
+    typedef OperacoesLote<largura> Op;
+    typedef typename Op::Tipo T;
+
+    const float* px = posicoes;
+    const float* py = posicoes + 1;
+    const float* pz = posicoes + 2;
+    const T ax = Junta(px, triangulos, 0, T()), ay = Junta(py, triangulos, 0, T()), az = Junta(pz, triangulos, 0, T());
+    const T bx = Junta(px, triangulos, 1, T()), by = Junta(py, triangulos, 1, T()), bz = Junta(pz, triangulos, 1, T());
+    const T cx = Junta(px, triangulos, 2, T()), cy = Junta(py, triangulos, 2, T()), cz = Junta(pz, triangulos, 2, T());
+
+    const T abx = Subtrai(bx, ax), aby = Subtrai(by, ay), abz = Subtrai(bz, az);
+    const T bcx = Subtrai(cx, bx), bcy = Subtrai(cy, by), bcz = Subtrai(cz, bz);
+
+    T nx = Subtrai(Multiplica(aby, bcz), Multiplica(abz, bcy));
+    T ny = Subtrai(Multiplica(abz, bcx), Multiplica(abx, bcz));
+    T nz = Subtrai(Multiplica(abx, bcy), Multiplica(aby, bcx));
+
+    float normal[3][largura];
+    float pesos[3][largura];
+    if (peso == PESO_ANGULO)
+    {
+        // Triângulos degenerados (área nula) ficam com peso 0
+        const T comprimento = Raiz(Ponto(nx, ny, nz, nx, ny, nz));
+        const T inverso = SeMaiorQueZero(comprimento, Divide(Op::constante(1.0f), comprimento));
+        nx = Multiplica(nx, inverso);
+        ny = Multiplica(ny, inverso);
+        nz = Multiplica(nz, inverso);
+
+        const T acx = Subtrai(cx, ax), acy = Subtrai(cy, ay), acz = Subtrai(cz, az);
+        const T l_ab = Raiz(Ponto(abx, aby, abz, abx, aby, abz));
+        const T l_bc = Raiz(Ponto(bcx, bcy, bcz, bcx, bcy, bcz));
+        const T l_ac = Raiz(Ponto(acx, acy, acz, acx, acy, acz));
+
+        // Cossenos dos ângulos em a, b e c, limitados a [-1, 1]. Nos
+        // degenerados, 0/0 dá NaN, que Minimo() troca por 1 (ângulo 0) em
+        // todas as larguras de lote; a normal deles já é nula
+        const T um = Op::constante(1.0f), menos_um = Op::constante(-1.0f);
+        const T cos_a = Divide(Ponto(abx, aby, abz, acx, acy, acz), Multiplica(l_ab, l_ac));
+        const T cos_b = Divide(Subtrai(Op::constante(0.0f), Ponto(abx, aby, abz, bcx, bcy, bcz)), Multiplica(l_ab, l_bc));
+        const T cos_c = Divide(Ponto(acx, acy, acz, bcx, bcy, bcz), Multiplica(l_ac, l_bc));
+        Op::guarda(pesos[0], Maximo(Minimo(cos_a, um), menos_um));
+        Op::guarda(pesos[1], Maximo(Minimo(cos_b, um), menos_um));
+        Op::guarda(pesos[2], Maximo(Minimo(cos_c, um), menos_um));
+        for (int canto = 0; canto < 3; ++canto)
+            for (int j = 0; j < largura; ++j)
+                pesos[canto][j] = acosf(pesos[canto][j]);
+    }
+    Op::guarda(normal[0], nx);
+    Op::guarda(normal[1], ny);
+    Op::guarda(normal[2], nz);
+
+    for (int j = 0; j < largura; ++j)
+    {
+        for (int canto = 0; canto < 3; ++canto)
+        {
+            float* soma = acumulador + 3 * triangulos[3 * j + canto];
+            const float p = peso == PESO_ANGULO ? pesos[canto][j] : 1.0f;
+            soma[0] += p * normal[0][j];
+            soma[1] += p * normal[1][j];
+            soma[2] += p * normal[2][j];
+        }
+    }
+}
+
+static void AcumulaTriangulos(const float* posicoes, const uint32_t* triangulos, size_t primeiro, size_t ultimo,
+                              PesoNormais peso, float* acumulador)
+{
+    size_t t = primeiro;
+    for (; t + LARGURA <= ultimo; t += LARGURA)
+        AcumulaLote<LARGURA>(posicoes, triangulos + 3 * t, peso, acumulador);
+    for (; t < ultimo; ++t)
+        AcumulaLote<1>(posicoes, triangulos + 3 * t, peso, acumulador);
+}
+
+// Soma os acumuladores das threads nos vértices [primeiro, ultimo) do
+// primeiro acumulador e normaliza. Vértices sem triângulo ficam com (0,0,0).
+static void ReduzVertices(const std::vector<float*>* acumuladores, size_t primeiro, size_t ultimo)
+{
+    typedef OperacoesLote<LARGURA> Op;
+    float* saida = (*acumuladores)[0];
+    for (size_t a = 1; a < acumuladores->size(); ++a)
+    {
+        const float* parcial = (*acumuladores)[a];
+        size_t f = 3 * primeiro;
+        for (; f + LARGURA <= 3 * ultimo; f += LARGURA)
+            Op::guarda(saida + f, Soma(Op::carrega(saida + f), Op::carrega(parcial + f)));
+        for (; f < 3 * ultimo; ++f)
+            saida[f] += parcial[f];
+    }
+    for (size_t v = primeiro; v < ultimo; ++v)
+    {
+        float* n = saida + 3 * v;
+        const float comprimento = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        const float inverso = comprimento > 0.0f ? 1.0f / comprimento : 0.0f;
+        n[0] *= inverso;
+        n[1] *= inverso;
+        n[2] *= inverso;
+    }
+}
+
+void CalculaNormaisVertices(const float* posicoes, size_t num_vertices, const uint32_t* triangulos,
+                            size_t num_triangulos, PesoNormais peso, int num_threads, float* normais)
+{
+    if (num_threads <= 0)
+        num_threads = std::max((int)std::thread::hardware_concurrency(), 1);
+    num_threads = (int)std::max(std::min((size_t)num_threads, num_triangulos / MINIMO_TRIANGULOS_POR_THREAD), (size_t)1);
+
+    // A thread 0 acumula direto na saída; as outras, em buffers próprios
+    std::vector<float> buffers((size_t)(num_threads - 1) * 3 * num_vertices, 0.0f);
+    std::vector<float*> acumuladores(num_threads);
+    acumuladores[0] = normais;
+    std::fill(normais, normais + 3 * num_vertices, 0.0f);
+    for (int i = 1; i < num_threads; ++i)
+        acumuladores[i] = buffers.data() + (size_t)(i - 1) * 3 * num_vertices;
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < num_threads; ++i)
+        threads.push_back(std::thread(AcumulaTriangulos, posicoes, triangulos, num_triangulos * i / num_threads,
+                                      num_triangulos * (i + 1) / num_threads, peso, acumuladores[i]));
+    AcumulaTriangulos(posicoes, triangulos, 0, num_triangulos / num_threads, peso, acumuladores[0]);
+    for (size_t i = 0; i < threads.size(); ++i)
+        threads[i].join();
+    threads.clear();
+
+    for (int i = 1; i < num_threads; ++i)
+        threads.push_back(std::thread(ReduzVertices, &acumuladores, num_vertices * i / num_threads,
+                                      num_vertices * (i + 1) / num_threads));
+    ReduzVertices(&acumuladores, 0, num_vertices / num_threads);
+    for (size_t i = 0; i < threads.size(); ++i)
+        threads[i].join();
+}
+
+// Primeiro computamos as normais para todos os TRIÂNGULOS. Segundo,
+// computamos as normais dos VÉRTICES através do método proposto por Gourad,
+// onde a normal de cada vértice vai ser a média (ponderada, ver PesoNormais)
+// das normais de todas as faces que compartilham este vértice.
+void ComputeNormals(ObjModel* model, PesoNormais peso, int num_threads)
+{
+    if ( !model->attrib.normals.empty() )
+        return;
+
+    const size_t num_vertices = model->attrib.vertices.size() / 3;
+
+    // Índices dos vértices de todos os triângulos de todas as formas; a
+    // normal de cada canto passa a ser a do seu vértice
+    size_t num_indices = 0;
+    for (size_t shape = 0; shape < model->shapes.size(); ++shape)
+        num_indices += model->shapes[shape].mesh.indices.size();
+    std::vector<uint32_t> triangulos;
+    triangulos.reserve(num_indices);
+    for (size_t shape = 0; shape < model->shapes.size(); ++shape)
+    {
+        std::vector<tinyobj::index_t>& indices = model->shapes[shape].mesh.indices;
+        assert(indices.size() == 3 * model->shapes[shape].mesh.num_face_vertices.size());
+        for (size_t i = 0; i < indices.size(); ++i)
+        {
+            triangulos.push_back((uint32_t)indices[i].vertex_index);
+            indices[i].normal_index = indices[i].vertex_index;
+        }
+    }
+
+    model->attrib.normals.resize( 3*num_vertices );
+    CalculaNormaisVertices(model->attrib.vertices.data(), num_vertices, triangulos.data(), triangulos.size() / 3,
+                           peso, num_threads, model->attrib.normals.data());
+}
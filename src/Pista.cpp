@@ -1,11 +1,845 @@
 #include "Pista.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+// Espessura (e altura) dos blocos desenhados para as paredes: o cubo de
+// BuildCubo() tem lado 1.
+static const float ESPESSURA_PAREDE = 1.0f;
+
+// Limite de células da grade; pistas muito grandes ganham células maiores.
+static const int MAXIMO_CELULAS = 256 * 256;
+
+static const float EPSILON = 1e-4f;
+
+// Cabeçalho do arquivo .sdf gravado por Pista::salvaSdf(), seguido de
+// largura*altura floats. A versão muda quando o formato muda; o hash do
+// arquivo da pista descarta campos assados para uma versão antiga dela.
+struct CabecalhoSdf
+{
+    char magica[4];
+    uint32_t versao;
+    uint32_t hash_pista;
+    int32_t largura, altura;
+    float min_x, min_z, passo;
+};
+
+static const char MAGICA_SDF[4] = { 'P', 'S', 'D', 'F' };
+static const uint32_t VERSAO_SDF = 1;
+
+// Margem, em amostras, em volta dos limites da pista.
+static const int MARGEM_SDF = 2;
+
+static uint32_t HashFnv1a(const std::string& dados)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < dados.size(); ++i)
+    {
+        hash ^= (unsigned char)dados[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static float DistanciaAoSegmento(const Segmento& s, float px, float pz)
+{
+    const float sx = s.x1 - s.x0, sz = s.z1 - s.z0;
+    const float comprimento2 = sx * sx + sz * sz;
+    float t = comprimento2 > 0.0f ? ((px - s.x0) * sx + (pz - s.z0) * sz) / comprimento2 : 0.0f;
+    t = fminf(fmaxf(t, 0.0f), 1.0f);
+    const float dx = s.x0 + t * sx - px, dz = s.z0 + t * sz - pz;
+    return sqrtf(dx * dx + dz * dz);
+}
+
+// Orientação do triângulo (a, b, c): positiva, negativa ou zero se colineares.
+static float Orientacao(float ax, float az, float bx, float bz, float cx, float cz)
+{
+    return (bx - ax) * (cz - az) - (bz - az) * (cx - ax);
+}
+
+static bool NoSegmento(float ax, float az, float bx, float bz, float px, float pz)
+{
+    return fminf(ax, bx) <= px && px <= fmaxf(ax, bx) && fminf(az, bz) <= pz && pz <= fmaxf(az, bz);
+}
+
+// Interseção fechada de dois segmentos: encostar conta como cruzar.
+static bool SegmentosSeCruzam(float ax, float az, float bx, float bz,
+                              float cx, float cz, float dx, float dz)
+{
+    const float o1 = Orientacao(ax, az, bx, bz, cx, cz);
+    const float o2 = Orientacao(ax, az, bx, bz, dx, dz);
+    const float o3 = Orientacao(cx, cz, dx, dz, ax, az);
+    const float o4 = Orientacao(cx, cz, dx, dz, bx, bz);
+
+    if (((o1 > 0 && o2 < 0) || (o1 < 0 && o2 > 0)) && ((o3 > 0 && o4 < 0) || (o3 < 0 && o4 > 0)))
+        return true;
+
+    return (o1 == 0 && NoSegmento(ax, az, bx, bz, cx, cz))
+        || (o2 == 0 && NoSegmento(ax, az, bx, bz, dx, dz))
+        || (o3 == 0 && NoSegmento(cx, cz, dx, dz, ax, az))
+        || (o4 == 0 && NoSegmento(cx, cz, dx, dz, bx, bz));
+}
+
+// Caixa orientada de um carro, com os cantos na mesma ordem de
+// TestaColisaoCarro() em Colisao.cpp.
+struct CaixaCarro
+{
+    float x, z, dir_x, dir_z, meio_comprimento, meio_largura;
+    float cantos_x[4], cantos_z[4];
+    float min_x, min_z, max_x, max_z; // Caixa envolvente alinhada aos eixos
+
+    CaixaCarro(float px, float pz, float dx, float dz, float l, float w)
+        : x(px), z(pz), dir_x(dx), dir_z(dz), meio_comprimento(l), meio_largura(w)
+    {
+        const float lx = l * dx, lz = l * dz;
+        const float wx = w * dz, wz = -w * dx;
+        cantos_x[0] = x + lx + wx; cantos_z[0] = z + lz + wz;
+        cantos_x[1] = x + lx - wx; cantos_z[1] = z + lz - wz;
+        cantos_x[2] = x - lx + wx; cantos_z[2] = z - lz + wz;
+        cantos_x[3] = x - lx - wx; cantos_z[3] = z - lz - wz;
+
+        const float ex = fabsf(lx) + fabsf(wx), ez = fabsf(lz) + fabsf(wz);
+        min_x = x - ex; max_x = x + ex;
+        min_z = z - ez; max_z = z + ez;
+    }
+
+    bool contem(float px, float pz) const
+    {
+        const float rx = px - x, rz = pz - z;
+        return fabsf(rx * dir_x + rz * dir_z) <= meio_comprimento
+            && fabsf(rx * dir_z - rz * dir_x) <= meio_largura;
+    }
+
+    bool cruza(const Segmento& s) const
+    {
+        // Arestas: frente (0-1), trás (2-3) e laterais (0-2, 1-3)
+        static const int arestas[4][2] = { {0, 1}, {2, 3}, {0, 2}, {1, 3} };
+
+        // Descarta pelas caixas envolventes antes do teste exato
+        if (fmaxf(s.x0, s.x1) < min_x || fminf(s.x0, s.x1) > max_x
+         || fmaxf(s.z0, s.z1) < min_z || fminf(s.z0, s.z1) > max_z)
+            return false;
+
+        if (contem(s.x0, s.z0) || contem(s.x1, s.z1))
+            return true;
+        for (int i = 0; i < 4; ++i)
+        {
+            const int a = arestas[i][0], b = arestas[i][1];
+            if (SegmentosSeCruzam(cantos_x[a], cantos_z[a], cantos_x[b], cantos_z[b], s.x0, s.z0, s.x1, s.z1))
+                return true;
+        }
+        return false;
+    }
+};
 
 Pista::Pista()
 {
-    //ctor
+    limpa();
 }
 
 Pista::~Pista()
 {
     //dtor
 }
+
+void Pista::limpa()
+{
+    segmentos.clear();
+    tipos.clear();
+    barreiras.clear();
+    checkpoints.clear();
+    chegadas.clear();
+    areas.clear();
+    blocos.clear();
+    vacas.clear();
+    celula_inicio.clear();
+    celula_segmentos.clear();
+    largada_x = largada_z = largada_angulo = 0.0f;
+    min_x = min_z = max_x = max_z = 0.0f;
+    tamanho_celula = 1.0f;
+    celulas_x = celulas_z = 0;
+    retangular = false;
+    usa_atalho = true;
+    sdf.clear();
+    sdf_min_x = sdf_min_z = 0.0f;
+    sdf_passo = 1.0f;
+    sdf_largura = sdf_altura = 0;
+    hash_arquivo = 0;
+    usa_sdf = true;
+}
+
+// Formato do arquivo: uma primitiva por linha, "#" inicia um comentário.
+//
+//   parede x0 z0 x1 z1          segmento de parede (colide e é desenhado)
+//   barreira x0 z0 x1 z1        segmento que colide mas não é desenhado
+//   area x0 z0 x1 z1 x2 z2 ...  polígono convexo de asfalto
+//   checkpoint x0 z0 x1 z1      linha a cruzar antes da chegada, em ordem
+//   chegada x0 z0 x1 z1         linha de chegada
+//   largada x z angulo          pose inicial do carro
+//   vaca x z angulo [escala]    vaca decorativa (sem colisão)
+bool Pista::carrega(const char* arquivo)
+{
+    std::ifstream arquivo_pista(arquivo, std::ios::binary);
+    if (!arquivo_pista)
+    {
+        fprintf(stderr, "ERROR: Cannot open track file \"%s\".\n", arquivo);
+        return false;
+    }
+
+    limpa();
+
+    std::stringstream conteudo;
+    conteudo << arquivo_pista.rdbuf();
+    hash_arquivo = HashFnv1a(conteudo.str());
+    std::istringstream entrada(conteudo.str());
+
+    std::string linha;
+    int numero_linha = 0;
+    bool tem_largada = false;
+    while (std::getline(entrada, linha))
+    {
+        numero_linha++;
+        size_t comentario = linha.find('#');
+        if (comentario != std::string::npos)
+            linha.erase(comentario);
+
+        std::istringstream campos(linha);
+        std::string tipo;
+        if (!(campos >> tipo))
+            continue;
+
+        std::vector<float> valores;
+        float v;
+        while (campos >> v)
+            valores.push_back(v);
+        if (!campos.eof())
+        {
+            fprintf(stderr, "ERROR: %s:%d: invalid number.\n", arquivo, numero_linha);
+            return false;
+        }
+
+        if (tipo == "parede" || tipo == "barreira" || tipo == "checkpoint" || tipo == "chegada")
+        {
+            if (valores.size() != 4)
+            {
+                fprintf(stderr, "ERROR: %s:%d: \"%s\" expects 4 numbers.\n", arquivo, numero_linha, tipo.c_str());
+                return false;
+            }
+            Segmento s = { valores[0], valores[1], valores[2], valores[3] };
+            if (tipo == "parede" || tipo == "barreira")
+            {
+                if (tipo == "barreira")
+                    barreiras.push_back((unsigned int)segmentos.size());
+                segmentos.push_back(s);
+                tipos.push_back(tipo == "parede" ? SEGMENTO_PAREDE : SEGMENTO_BARREIRA);
+            }
+            else if (tipo == "checkpoint")
+                checkpoints.push_back(s);
+            else
+                chegadas.push_back(s);
+        }
+        else if (tipo == "area")
+        {
+            if (valores.size() < 6 || valores.size() % 2 != 0)
+            {
+                fprintf(stderr, "ERROR: %s:%d: \"area\" expects at least 3 points.\n", arquivo, numero_linha);
+                return false;
+            }
+            std::vector<glm::vec2> poligono;
+            for (size_t i = 0; i < valores.size(); i += 2)
+                poligono.push_back(glm::vec2(valores[i], valores[i + 1]));
+            areas.push_back(poligono);
+        }
+        else if (tipo == "largada")
+        {
+            if (valores.size() != 3)
+            {
+                fprintf(stderr, "ERROR: %s:%d: \"largada\" expects 3 numbers.\n", arquivo, numero_linha);
+                return false;
+            }
+            largada_x = valores[0];
+            largada_z = valores[1];
+            largada_angulo = valores[2];
+            tem_largada = true;
+        }
+        else if (tipo == "vaca")
+        {
+            if (valores.size() != 3 && valores.size() != 4)
+            {
+                fprintf(stderr, "ERROR: %s:%d: \"vaca\" expects 3 or 4 numbers.\n", arquivo, numero_linha);
+                return false;
+            }
+            Vaca vaca = { valores[0], valores[1], valores[2], valores.size() == 4 ? valores[3] : 1.0f };
+            vacas.push_back(vaca);
+        }
+        else
+        {
+            fprintf(stderr, "ERROR: %s:%d: unknown primitive \"%s\".\n", arquivo, numero_linha, tipo.c_str());
+            return false;
+        }
+    }
+
+    if (segmentos.empty() || areas.empty() || chegadas.empty() || !tem_largada)
+    {
+        fprintf(stderr, "ERROR: %s: a track needs walls, areas, a finish line and a start pose.\n", arquivo);
+        return false;
+    }
+
+    min_x = max_x = areas[0][0].x;
+    min_z = max_z = areas[0][0].y;
+    for (size_t i = 0; i < segmentos.size(); ++i)
+    {
+        const Segmento& s = segmentos[i];
+        min_x = fminf(min_x, fminf(s.x0, s.x1));
+        max_x = fmaxf(max_x, fmaxf(s.x0, s.x1));
+        min_z = fminf(min_z, fminf(s.z0, s.z1));
+        max_z = fmaxf(max_z, fmaxf(s.z0, s.z1));
+    }
+    for (size_t i = 0; i < areas.size(); ++i)
+    {
+        for (size_t j = 0; j < areas[i].size(); ++j)
+        {
+            min_x = fminf(min_x, areas[i][j].x);
+            max_x = fmaxf(max_x, areas[i][j].x);
+            min_z = fminf(min_z, areas[i][j].y);
+            max_z = fmaxf(max_z, areas[i][j].y);
+        }
+    }
+
+    constroiGrade();
+    constroiBlocos();
+    detectaRetangulos();
+
+    // O SDF é opcional: sem ele (ou desatualizado) usamos a grade.
+    carregaSdf(CaminhoSdf(arquivo).c_str());
+    return true;
+}
+
+// Distribui os segmentos nas células cobertas pela sua caixa envolvente. O
+// lado da célula é o comprimento médio dos segmentos, de forma que cada
+// consulta de um carro visita poucas células e poucos segmentos, não importa
+// quantos segmentos a pista tenha.
+void Pista::constroiGrade()
+{
+    float soma = 0.0f;
+    for (size_t i = 0; i < segmentos.size(); ++i)
+    {
+        const Segmento& s = segmentos[i];
+        soma += sqrtf((s.x1 - s.x0) * (s.x1 - s.x0) + (s.z1 - s.z0) * (s.z1 - s.z0));
+    }
+
+    const float largura = fmaxf(max_x - min_x, EPSILON);
+    const float profundidade = fmaxf(max_z - min_z, EPSILON);
+
+    tamanho_celula = fmaxf(soma / segmentos.size(), 0.5f);
+    while ((largura / tamanho_celula + 1.0f) * (profundidade / tamanho_celula + 1.0f) > MAXIMO_CELULAS)
+        tamanho_celula *= 2.0f;
+
+    celulas_x = (int)(largura / tamanho_celula) + 1;
+    celulas_z = (int)(profundidade / tamanho_celula) + 1;
+
+    // Duas passadas (contagem e preenchimento) para guardar tudo em dois
+    // vetores contíguos em vez de um vetor por célula.
+    celula_inicio.assign(celulas_x * celulas_z + 1, 0);
+    for (int passada = 0; passada < 2; ++passada)
+    {
+        std::vector<unsigned int> posicao;
+        if (passada == 1)
+        {
+            for (size_t c = 1; c < celula_inicio.size(); ++c)
+                celula_inicio[c] += celula_inicio[c - 1];
+            celula_segmentos.resize(celula_inicio.back());
+            posicao.assign(celula_inicio.begin(), celula_inicio.end() - 1);
+        }
+
+        for (size_t i = 0; i < segmentos.size(); ++i)
+        {
+            const Segmento& s = segmentos[i];
+            const int i0 = (int)((fminf(s.x0, s.x1) - min_x) / tamanho_celula);
+            const int i1 = (int)((fmaxf(s.x0, s.x1) - min_x) / tamanho_celula);
+            const int j0 = (int)((fminf(s.z0, s.z1) - min_z) / tamanho_celula);
+            const int j1 = (int)((fmaxf(s.z0, s.z1) - min_z) / tamanho_celula);
+
+            for (int j = j0; j <= j1 && j < celulas_z; ++j)
+            {
+                for (int k = i0; k <= i1 && k < celulas_x; ++k)
+                {
+                    const int c = j * celulas_x + k;
+                    if (passada == 0)
+                        celula_inicio[c + 1]++;
+                    else
+                        celula_segmentos[posicao[c]++] = (unsigned int)i;
+                }
+            }
+        }
+    }
+}
+
+bool Pista::dentroDeArea(float x, float z) const
+{
+    for (size_t i = 0; i < areas.size(); ++i)
+    {
+        const std::vector<glm::vec2>& p = areas[i];
+        bool positivo = false, negativo = false;
+        for (size_t j = 0; j < p.size(); ++j)
+        {
+            const glm::vec2& a = p[j];
+            const glm::vec2& b = p[(j + 1) % p.size()];
+            const float o = Orientacao(a.x, a.y, b.x, b.y, x, z);
+            positivo |= o > 0.0f;
+            negativo |= o < 0.0f;
+        }
+        if (!(positivo && negativo))
+            return true;
+    }
+    return false;
+}
+
+// Cada parede vira um bloco de espessura ESPESSURA_PAREDE encostado nela, do
+// lado de fora do asfalto. Nos cantos côncavos (vistos do asfalto) o bloco é
+// estendido para fechar a quina; nos convexos, não, para não invadir a pista.
+void Pista::constroiBlocos()
+{
+    const float amostra = 0.25f;
+
+    for (size_t i = 0; i < segmentos.size(); ++i)
+    {
+        if (tipos[i] != SEGMENTO_PAREDE)
+            continue;
+
+        const Segmento& s = segmentos[i];
+        const float comprimento = sqrtf((s.x1 - s.x0) * (s.x1 - s.x0) + (s.z1 - s.z0) * (s.z1 - s.z0));
+        if (comprimento < EPSILON)
+            continue;
+
+        const float ux = (s.x1 - s.x0) / comprimento;
+        const float uz = (s.z1 - s.z0) / comprimento;
+        const float meio_x = 0.5f * (s.x0 + s.x1);
+        const float meio_z = 0.5f * (s.z0 + s.z1);
+
+        // Normal apontando para fora do asfalto (nula se há asfalto dos dois lados)
+        float nx = -uz, nz = ux;
+        const bool asfalto_positivo = dentroDeArea(meio_x + amostra * nx, meio_z + amostra * nz);
+        const bool asfalto_negativo = dentroDeArea(meio_x - amostra * nx, meio_z - amostra * nz);
+        if (asfalto_positivo == asfalto_negativo)
+            nx = nz = 0.0f;
+        else if (asfalto_positivo)
+        {
+            nx = -nx;
+            nz = -nz;
+        }
+
+        float extensao_inicio = 0.0f, extensao_fim = 0.0f;
+        if (nx != 0.0f || nz != 0.0f)
+        {
+            if (!dentroDeArea(s.x0 - amostra * (ux + nx), s.z0 - amostra * (uz + nz)))
+                extensao_inicio = ESPESSURA_PAREDE;
+            if (!dentroDeArea(s.x1 + amostra * (ux - nx), s.z1 + amostra * (uz - nz)))
+                extensao_fim = ESPESSURA_PAREDE;
+        }
+
+        const float deslocamento = 0.5f * (extensao_fim - extensao_inicio);
+
+        BlocoParede bloco;
+        bloco.centro_x = meio_x + 0.5f * ESPESSURA_PAREDE * nx + deslocamento * ux;
+        bloco.centro_z = meio_z + 0.5f * ESPESSURA_PAREDE * nz + deslocamento * uz;
+        bloco.comprimento = comprimento + extensao_inicio + extensao_fim;
+        // Matrix_Rotate_Y(a) leva o eixo X para (cos a, 0, -sin a)
+        bloco.angulo = atan2f(-uz, ux);
+        blocos.push_back(bloco);
+    }
+}
+
+// Reconhece a pista formada por um retângulo externo e um interno, alinhados
+// aos eixos, com chegada e barreira verticais na reta de baixo. Nesse caso
+// preenchemos LimitesPista e os testes vão para TestaColisaoLote().
+void Pista::detectaRetangulos()
+{
+    retangular = false;
+
+    std::vector<Segmento> externas, internas;
+    for (size_t i = 0; i < segmentos.size(); ++i)
+    {
+        if (tipos[i] != SEGMENTO_PAREDE)
+            continue;
+        const Segmento& s = segmentos[i];
+        if (s.x0 != s.x1 && s.z0 != s.z1)
+            return;
+        const bool borda = (s.x0 == s.x1 && (s.x0 == min_x || s.x0 == max_x))
+                        || (s.z0 == s.z1 && (s.z0 == min_z || s.z0 == max_z));
+        if (borda)
+            externas.push_back(s);
+        else
+            internas.push_back(s);
+    }
+    if (externas.empty() || internas.empty())
+        return;
+
+    float in_min_x = internas[0].x0, in_max_x = internas[0].x0;
+    float in_min_z = internas[0].z0, in_max_z = internas[0].z0;
+    for (size_t i = 0; i < internas.size(); ++i)
+    {
+        in_min_x = fminf(in_min_x, fminf(internas[i].x0, internas[i].x1));
+        in_max_x = fmaxf(in_max_x, fmaxf(internas[i].x0, internas[i].x1));
+        in_min_z = fminf(in_min_z, fminf(internas[i].z0, internas[i].z1));
+        in_max_z = fmaxf(in_max_z, fmaxf(internas[i].z0, internas[i].z1));
+    }
+
+    // Os segmentos de cada grupo precisam estar sobre o contorno do seu
+    // retângulo e cobri-lo inteiro.
+    float perimetro_externo = 0.0f, perimetro_interno = 0.0f;
+    for (size_t i = 0; i < externas.size(); ++i)
+        perimetro_externo += fabsf(externas[i].x1 - externas[i].x0) + fabsf(externas[i].z1 - externas[i].z0);
+    for (size_t i = 0; i < internas.size(); ++i)
+    {
+        const Segmento& s = internas[i];
+        const bool borda = (s.x0 == s.x1 && (s.x0 == in_min_x || s.x0 == in_max_x))
+                        || (s.z0 == s.z1 && (s.z0 == in_min_z || s.z0 == in_max_z));
+        if (!borda)
+            return;
+        perimetro_interno += fabsf(s.x1 - s.x0) + fabsf(s.z1 - s.z0);
+    }
+    if (fabsf(perimetro_externo - 2.0f * ((max_x - min_x) + (max_z - min_z))) > EPSILON
+     || fabsf(perimetro_interno - 2.0f * ((in_max_x - in_min_x) + (in_max_z - in_min_z))) > EPSILON)
+        return;
+    if (!(min_x < in_min_x && in_max_x < max_x && min_z < in_min_z && in_max_z < max_z))
+        return;
+
+    // Uma barreira e uma chegada, ambas atravessando a reta de baixo
+    const Segmento* barreira = NULL;
+    for (size_t i = 0; i < segmentos.size(); ++i)
+    {
+        if (tipos[i] != SEGMENTO_BARREIRA)
+            continue;
+        if (barreira)
+            return;
+        barreira = &segmentos[i];
+    }
+    if (!barreira || chegadas.size() != 1)
+        return;
+
+    const Segmento* linhas[2] = { barreira, &chegadas[0] };
+    for (int i = 0; i < 2; ++i)
+    {
+        const Segmento& s = *linhas[i];
+        if (s.x0 != s.x1 || fminf(s.z0, s.z1) != min_z || fmaxf(s.z0, s.z1) != in_min_z)
+            return;
+    }
+
+    limites.externo_min_x = min_x;
+    limites.externo_max_x = max_x;
+    limites.externo_min_z = min_z;
+    limites.externo_max_z = max_z;
+    limites.interno_min_x = in_min_x;
+    limites.interno_max_x = in_max_x;
+    limites.interno_min_z = in_min_z;
+    limites.interno_max_z = in_max_z;
+    limites.chegada_x = chegadas[0].x0;
+    limites.saida_x = barreira->x0;
+    limites.reta_final_max_z = in_min_z;
+    retangular = true;
+}
+
+uint32_t Pista::testaCarro(float x, float z, float dir_x, float dir_z,
+                           float meio_comprimento, float meio_largura) const
+{
+    if (retangular && usa_atalho)
+        return TestaColisaoCarro(limites, x, z, dir_x, dir_z, meio_comprimento, meio_largura);
+
+    const CaixaCarro caixa(x, z, dir_x, dir_z, meio_comprimento, meio_largura);
+
+    const float cmin_x = caixa.min_x, cmax_x = caixa.max_x;
+    const float cmin_z = caixa.min_z, cmax_z = caixa.max_z;
+
+    uint32_t resultado = 0;
+
+    // Com o SDF, as paredes saem dos quatro cantos da caixa, como no teste
+    // analítico da pista retangular: uma interpolação bilinear por canto e
+    // nenhum desvio.
+    const bool paredes_pelo_sdf = temSdf();
+    if (paredes_pelo_sdf)
+    {
+        const float menor = fminf(fminf(distanciaParede(caixa.cantos_x[0], caixa.cantos_z[0]),
+                                        distanciaParede(caixa.cantos_x[1], caixa.cantos_z[1])),
+                                  fminf(distanciaParede(caixa.cantos_x[2], caixa.cantos_z[2]),
+                                        distanciaParede(caixa.cantos_x[3], caixa.cantos_z[3])));
+        resultado |= (uint32_t)(menor <= 0.0f) * COLISAO_PAREDE;
+
+        // As barreiras não entram no SDF; são poucas, então vão direto
+        for (size_t k = 0; k < barreiras.size(); ++k)
+        {
+            if (caixa.cruza(segmentos[barreiras[k]]))
+                resultado |= COLISAO_TRAPACA;
+        }
+    }
+    else
+    {
+        // Fora da grade não há segmento algum: só pode ser um carro que já saiu
+        // da pista, o que conta como parede.
+        if (cmin_x < min_x || cmax_x > max_x || cmin_z < min_z || cmax_z > max_z)
+            resultado |= COLISAO_PAREDE;
+
+        const int i0 = (int)fmaxf((cmin_x - min_x) / tamanho_celula, 0.0f);
+        const int i1 = (int)fminf((cmax_x - min_x) / tamanho_celula, (float)(celulas_x - 1));
+        const int j0 = (int)fmaxf((cmin_z - min_z) / tamanho_celula, 0.0f);
+        const int j1 = (int)fminf((cmax_z - min_z) / tamanho_celula, (float)(celulas_z - 1));
+
+        // Um segmento que ocupa várias células pode ser testado mais de uma vez;
+        // o resultado é o mesmo e assim a consulta não precisa de estado.
+        for (int j = j0; j <= j1; ++j)
+        {
+            for (int i = i0; i <= i1; ++i)
+            {
+                const int c = j * celulas_x + i;
+                for (unsigned int k = celula_inicio[c]; k < celula_inicio[c + 1]; ++k)
+                {
+                    const unsigned int s = celula_segmentos[k];
+                    const uint32_t bit = tipos[s] == SEGMENTO_PAREDE ? COLISAO_PAREDE : COLISAO_TRAPACA;
+                    if (!(resultado & bit) && caixa.cruza(segmentos[s]))
+                        resultado |= bit;
+                }
+            }
+        }
+    }
+
+    for (size_t i = 0; i < chegadas.size(); ++i)
+    {
+        if (caixa.cruza(chegadas[i]))
+            resultado |= COLISAO_CHEGADA;
+    }
+
+    return resultado;
+}
+
+void Pista::testaLote(const float* x, const float* z, const float* dir_x, const float* dir_z, size_t n,
+                      float meio_comprimento, float meio_largura, uint8_t* flags) const
+{
+    if (retangular && usa_atalho)
+    {
+        TestaColisaoLote(limites, x, z, dir_x, dir_z, n, meio_comprimento, meio_largura, flags);
+        return;
+    }
+
+    for (size_t i = 0; i < n; ++i)
+        flags[i] = (uint8_t)testaCarro(x[i], z[i], dir_x[i], dir_z[i], meio_comprimento, meio_largura);
+}
+
+bool Pista::cruzouCheckpoint(size_t i, float x, float z, float dir_x, float dir_z,
+                             float meio_comprimento, float meio_largura) const
+{
+    const CaixaCarro caixa(x, z, dir_x, dir_z, meio_comprimento, meio_largura);
+    return caixa.cruza(checkpoints[i]);
+}
+
+size_t Pista::numeroDeCheckpoints() const
+{
+    return checkpoints.size();
+}
+
+const std::vector< std::vector<glm::vec2> >& Pista::getAreas() const
+{
+    return areas;
+}
+
+const std::vector<BlocoParede>& Pista::getBlocosParede() const
+{
+    return blocos;
+}
+
+const std::vector<Vaca>& Pista::getVacas() const
+{
+    return vacas;
+}
+
+float Pista::getLargadaX() const
+{
+    return largada_x;
+}
+
+float Pista::getLargadaZ() const
+{
+    return largada_z;
+}
+
+float Pista::getLargadaAngulo() const
+{
+    return largada_angulo;
+}
+
+void Pista::getLimites(float* min_x, float* min_z, float* max_x, float* max_z) const
+{
+    *min_x = this->min_x;
+    *min_z = this->min_z;
+    *max_x = this->max_x;
+    *max_z = this->max_z;
+}
+
+bool Pista::ehRetangular() const
+{
+    return retangular;
+}
+
+void Pista::setUsaAtalhoRetangular(bool usa)
+{
+    usa_atalho = usa;
+}
+
+std::string Pista::CaminhoSdf(const char* arquivo_pista)
+{
+    std::string caminho(arquivo_pista);
+    size_t ponto = caminho.find_last_of('.');
+    size_t barra = caminho.find_last_of("/\\");
+    if (ponto != std::string::npos && (barra == std::string::npos || ponto > barra))
+        caminho.erase(ponto);
+    return caminho + ".sdf";
+}
+
+// Amostra a distância até a parede mais próxima em uma grade com espaçamento
+// "passo". É feito uma vez, fora do jogo (ver assa_sdf.cpp), então testamos
+// todos os segmentos para cada amostra sem nenhuma estrutura auxiliar.
+bool Pista::assaSdf(float passo)
+{
+    if (segmentos.empty() || passo <= 0.0f)
+        return false;
+
+    sdf_passo = passo;
+    sdf_min_x = min_x - MARGEM_SDF * passo;
+    sdf_min_z = min_z - MARGEM_SDF * passo;
+    sdf_largura = (int)ceilf((max_x - min_x) / passo) + 2 * MARGEM_SDF + 1;
+    sdf_altura = (int)ceilf((max_z - min_z) / passo) + 2 * MARGEM_SDF + 1;
+    sdf.assign((size_t)sdf_largura * sdf_altura, 0.0f);
+
+    for (int j = 0; j < sdf_altura; ++j)
+    {
+        const float pz = sdf_min_z + j * passo;
+        for (int i = 0; i < sdf_largura; ++i)
+        {
+            const float px = sdf_min_x + i * passo;
+            float menor = 1e30f;
+            for (size_t k = 0; k < segmentos.size(); ++k)
+            {
+                if (tipos[k] == SEGMENTO_PAREDE)
+                    menor = fminf(menor, DistanciaAoSegmento(segmentos[k], px, pz));
+            }
+            sdf[(size_t)j * sdf_largura + i] = dentroDeArea(px, pz) ? menor : -menor;
+        }
+    }
+    return true;
+}
+
+bool Pista::salvaSdf(const char* arquivo) const
+{
+    if (sdf.empty())
+        return false;
+
+    FILE* saida = fopen(arquivo, "wb");
+    if (!saida)
+    {
+        fprintf(stderr, "ERROR: Cannot write SDF file \"%s\".\n", arquivo);
+        return false;
+    }
+
+    CabecalhoSdf cabecalho;
+    memcpy(cabecalho.magica, MAGICA_SDF, sizeof(MAGICA_SDF));
+    cabecalho.versao = VERSAO_SDF;
+    cabecalho.hash_pista = hash_arquivo;
+    cabecalho.largura = sdf_largura;
+    cabecalho.altura = sdf_altura;
+    cabecalho.min_x = sdf_min_x;
+    cabecalho.min_z = sdf_min_z;
+    cabecalho.passo = sdf_passo;
+
+    bool ok = fwrite(&cabecalho, sizeof(cabecalho), 1, saida) == 1
+           && fwrite(sdf.data(), sizeof(float), sdf.size(), saida) == sdf.size();
+    ok = (fclose(saida) == 0) && ok;
+    if (!ok)
+        fprintf(stderr, "ERROR: Failed writing SDF file \"%s\".\n", arquivo);
+    return ok;
+}
+
+// Retorna false, sem mensagem, se o arquivo não existe: o SDF é opcional.
+// Um arquivo de outra versão ou assado para outra pista é ignorado com aviso.
+bool Pista::carregaSdf(const char* arquivo)
+{
+    FILE* entrada = fopen(arquivo, "rb");
+    if (!entrada)
+        return false;
+
+    CabecalhoSdf cabecalho;
+    bool ok = fread(&cabecalho, sizeof(cabecalho), 1, entrada) == 1
+           && memcmp(cabecalho.magica, MAGICA_SDF, sizeof(MAGICA_SDF)) == 0
+           && cabecalho.versao == VERSAO_SDF
+           && cabecalho.largura > 1 && cabecalho.altura > 1 && cabecalho.passo > 0.0f;
+    if (!ok)
+    {
+        fprintf(stderr, "WARNING: Ignoring invalid SDF file \"%s\".\n", arquivo);
+        fclose(entrada);
+        return false;
+    }
+    if (cabecalho.hash_pista != hash_arquivo)
+    {
+        fprintf(stderr, "WARNING: Ignoring stale SDF file \"%s\" (track changed, run assa_sdf again).\n", arquivo);
+        fclose(entrada);
+        return false;
+    }
+
+    std::vector<float> valores((size_t)cabecalho.largura * cabecalho.altura);
+    ok = fread(valores.data(), sizeof(float), valores.size(), entrada) == valores.size();
+    fclose(entrada);
+    if (!ok)
+    {
+        fprintf(stderr, "WARNING: Ignoring truncated SDF file \"%s\".\n", arquivo);
+        return false;
+    }
+
+    sdf.swap(valores);
+    sdf_largura = cabecalho.largura;
+    sdf_altura = cabecalho.altura;
+    sdf_min_x = cabecalho.min_x;
+    sdf_min_z = cabecalho.min_z;
+    sdf_passo = cabecalho.passo;
+    return true;
+}
+
+bool Pista::temSdf() const
+{
+    return usa_sdf && !sdf.empty();
+}
+
+void Pista::setUsaSdf(bool usa)
+{
+    usa_sdf = usa;
+}
+
+// Interpolação bilinear do SDF. Pontos fora da grade usam a borda, que está
+// MARGEM_SDF amostras fora da pista e portanto é negativa.
+float Pista::distanciaParede(float x, float z) const
+{
+    const float fx = fminf(fmaxf((x - sdf_min_x) / sdf_passo, 0.0f), (float)(sdf_largura - 1) - EPSILON);
+    const float fz = fminf(fmaxf((z - sdf_min_z) / sdf_passo, 0.0f), (float)(sdf_altura - 1) - EPSILON);
+    const int i = (int)fx;
+    const int j = (int)fz;
+    const float tx = fx - i;
+    const float tz = fz - j;
+
+    const float* linha0 = &sdf[(size_t)j * sdf_largura + i];
+    const float* linha1 = linha0 + sdf_largura;
+    const float a = linha0[0] + tx * (linha0[1] - linha0[0]);
+    const float b = linha1[0] + tx * (linha1[1] - linha1[0]);
+    return a + tz * (b - a);
+}
+
+// Gradiente do SDF por diferenças centrais. Para deslizar ao longo da parede
+// basta remover do deslocamento a componente contrária a esta normal.
+void Pista::normalParede(float x, float z, float* nx, float* nz) const
+{
+    const float h = sdf_passo;
+    const float gx = distanciaParede(x + h, z) - distanciaParede(x - h, z);
+    const float gz = distanciaParede(x, z + h) - distanciaParede(x, z - h);
+    const float norma = sqrtf(gx * gx + gz * gz);
+    *nx = norma > 0.0f ? gx / norma : 0.0f;
+    *nz = norma > 0.0f ? gz / norma : 0.0f;
+}
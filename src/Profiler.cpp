@@ -0,0 +1,221 @@
+#include "Profiler.h"
+#include <cstdio>
+#include <glad/glad.h>
+
+Profiler g_Profiler;
+
+// Peso de cada quadro novo na média exibida na tela: o resumo fica legível
+// sem esconder um pico que dure mais de alguns quadros.
+static const double PESO_MEDIA = 0.1;
+
+// Uma captura longa não pode crescer sem limite; os eventos além deste
+// número são descartados.
+static const size_t MAXIMO_EVENTOS_TRACE = 1 << 20;
+
+static void Media(double* media, double amostra)
+{
+    *media = (*media < 0.0) ? amostra : *media + PESO_MEDIA * (amostra - *media);
+}
+
+Profiler::Profiler()
+{
+    origem = std::chrono::steady_clock::now();
+    usa_gpu = false;
+    quadro = 0;
+    inicio_quadro_us = 0.0;
+    quadro_ms = -1.0;
+    escopos_gpu_abertos = 0;
+    gravando = false;
+}
+
+Profiler::~Profiler()
+{
+    //dtor
+}
+
+void Profiler::inicializaGpu()
+{
+    usa_gpu = true;
+}
+
+double Profiler::agoraUs() const
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - origem).count();
+}
+
+LinhaProfiler& Profiler::linha(const char* nome, int profundidade)
+{
+    for (size_t i = 0; i < linhas.size(); ++i)
+        if (linhas[i].nome == nome)
+            return linhas[i];
+
+    LinhaProfiler nova;
+    nova.nome = nome;
+    nova.profundidade = profundidade;
+    nova.cpu_ms = -1.0;
+    nova.gpu_ms = -1.0;
+    linhas.push_back(nova);
+    return linhas.back();
+}
+
+void Profiler::registra(const char* nome, double inicio_us, double duracao_us, int thread)
+{
+    if (!gravando || trace.size() >= MAXIMO_EVENTOS_TRACE)
+        return;
+
+    EventoTrace evento;
+    evento.nome = nome;
+    evento.inicio_us = inicio_us;
+    evento.duracao_us = duracao_us;
+    evento.thread = thread;
+    trace.push_back(evento);
+}
+
+// Lê as consultas feitas QUADROS_EM_VOO quadros atrás na mesma posição do
+// anel. Uma consulta ainda sem resultado é descartada, nunca esperada.
+void Profiler::coletaGpu(int posicao)
+{
+    double cursor_us = 0.0;
+    for (size_t i = 0; i < consultas[posicao].size(); ++i)
+    {
+        const ConsultaGpu& consulta = consultas[posicao][i];
+
+        GLint disponivel = 0;
+        glGetQueryObjectiv(consulta.id, GL_QUERY_RESULT_AVAILABLE, &disponivel);
+        if (disponivel)
+        {
+            GLuint64 nanossegundos = 0;
+            glGetQueryObjectui64v(consulta.id, GL_QUERY_RESULT, &nanossegundos);
+            const double duracao_us = nanossegundos / 1000.0;
+
+            Media(&linha(consulta.nome, consulta.profundidade).gpu_ms, duracao_us / 1000.0);
+
+            if (cursor_us < consulta.inicio_us)
+                cursor_us = consulta.inicio_us;
+            registra(consulta.nome, cursor_us, duracao_us, 2);
+            cursor_us += duracao_us;
+        }
+
+        livres[posicao].push_back(consulta.id);
+    }
+    consultas[posicao].clear();
+}
+
+void Profiler::iniciaQuadro()
+{
+    if (usa_gpu)
+        coletaGpu((int)(quadro % QUADROS_EM_VOO));
+
+    inicio_quadro_us = agoraUs();
+}
+
+void Profiler::terminaQuadro()
+{
+    const double fim_us = agoraUs();
+    Media(&quadro_ms, (fim_us - inicio_quadro_us) / 1000.0);
+    registra("Quadro", inicio_quadro_us, fim_us - inicio_quadro_us, 1);
+    ++quadro;
+}
+
+void Profiler::abreEscopo(const char* nome, bool gpu)
+{
+    Escopo escopo;
+    escopo.nome = nome;
+    escopo.profundidade = (int)pilha.size();
+    escopo.consulta = -1;
+    linha(nome, escopo.profundidade); // O resumo segue a ordem de abertura
+
+    if (gpu && usa_gpu && escopos_gpu_abertos == 0)
+    {
+        const int posicao = (int)(quadro % QUADROS_EM_VOO);
+
+        ConsultaGpu consulta;
+        if (livres[posicao].empty())
+        {
+            glGenQueries(1, &consulta.id);
+        }
+        else
+        {
+            consulta.id = livres[posicao].back();
+            livres[posicao].pop_back();
+        }
+        consulta.nome = nome;
+        consulta.profundidade = escopo.profundidade;
+        consulta.inicio_us = agoraUs();
+
+        glBeginQuery(GL_TIME_ELAPSED, consulta.id);
+        escopo.consulta = (int)consultas[posicao].size();
+        consultas[posicao].push_back(consulta);
+        ++escopos_gpu_abertos;
+    }
+
+    // Lido por último, para não contar o custo da consulta no escopo
+    escopo.inicio_us = agoraUs();
+    pilha.push_back(escopo);
+}
+
+void Profiler::fechaEscopo()
+{
+    const double fim_us = agoraUs();
+    const Escopo escopo = pilha.back();
+    pilha.pop_back();
+
+    if (escopo.consulta >= 0)
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        --escopos_gpu_abertos;
+    }
+
+    Media(&linha(escopo.nome, escopo.profundidade).cpu_ms, (fim_us - escopo.inicio_us) / 1000.0);
+    registra(escopo.nome, escopo.inicio_us, fim_us - escopo.inicio_us, 1);
+}
+
+const std::vector<LinhaProfiler>& Profiler::getLinhas() const
+{
+    return linhas;
+}
+
+double Profiler::getQuadroMs() const
+{
+    return quadro_ms;
+}
+
+void Profiler::iniciaCaptura()
+{
+    trace.clear();
+    gravando = true;
+}
+
+bool Profiler::capturando() const
+{
+    return gravando;
+}
+
+bool Profiler::terminaCaptura(const char* arquivo)
+{
+    gravando = false;
+
+    FILE* saida = fopen(arquivo, "w");
+    if (!saida)
+    {
+        fprintf(stderr, "ERROR: Cannot write trace file \"%s\".\n", arquivo);
+        return false;
+    }
+
+    fprintf(saida, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(saida, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n");
+    fprintf(saida, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}");
+    for (size_t i = 0; i < trace.size(); ++i)
+    {
+        const EventoTrace& e = trace[i];
+        fprintf(saida, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+                e.nome, e.thread == 1 ? "cpu" : "gpu", e.inicio_us, e.duracao_us, e.thread);
+    }
+    fprintf(saida, "\n]}\n");
+
+    bool ok = fclose(saida) == 0;
+    if (!ok)
+        fprintf(stderr, "ERROR: Failed writing trace file \"%s\".\n", arquivo);
+    trace.clear();
+    return ok;
+}
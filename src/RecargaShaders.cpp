@@ -0,0 +1,194 @@
+#include "RecargaShaders.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// Sem inotify, intervalo entre duas consultas às datas de modificação
+static const int INTERVALO_CONSULTA_MS = 500;
+
+// Diretório e nome de um caminho: "../../src/a.glsl" -> "../../src", "a.glsl"
+static void SeparaCaminho(const std::string& caminho, std::string* diretorio, std::string* arquivo)
+{
+    size_t barra = caminho.find_last_of("/\\");
+    if (barra == std::string::npos)
+    {
+        *diretorio = ".";
+        *arquivo = caminho;
+    }
+    else
+    {
+        *diretorio = caminho.substr(0, barra);
+        *arquivo = caminho.substr(barra + 1);
+    }
+}
+
+static long long Modificacao(const std::string& arquivo)
+{
+    struct stat info;
+    if (stat(arquivo.c_str(), &info) != 0)
+        return -1;
+    return (long long)info.st_mtime;
+}
+
+RecargaShaders::RecargaShaders()
+{
+    inotify_fd = -1;
+    modificacao[0] = modificacao[1] = -1;
+    mudou = false;
+    compilando = false;
+    criacao.program_id = 0;
+    criacao.vertex_shader_id = 0;
+    criacao.fragment_shader_id = 0;
+    criacao.chave = 0;
+}
+
+RecargaShaders::~RecargaShaders()
+{
+#ifdef __linux__
+    if (inotify_fd >= 0)
+        close(inotify_fd);
+#endif
+}
+
+void RecargaShaders::vigia(const char* nome_programa, const char* arquivo_vertex, const char* arquivo_fragment)
+{
+    nome = nome_programa;
+    arquivos[0] = arquivo_vertex;
+    arquivos[1] = arquivo_fragment;
+    for (int i = 0; i < 2; ++i)
+        modificacao[i] = Modificacao(arquivos[i]);
+    ultima_consulta = std::chrono::steady_clock::now();
+
+#ifdef __linux__
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0)
+    {
+        fprintf(stderr, "WARNING: inotify unavailable (%s); polling shader files instead.\n", strerror(errno));
+        return;
+    }
+
+    std::string diretorio, arquivo;
+    std::vector<std::string> diretorios;
+    for (int i = 0; i < 2; ++i)
+    {
+        SeparaCaminho(arquivos[i], &diretorio, &arquivo);
+        bool repetido = false;
+        for (size_t k = 0; k < diretorios.size(); ++k)
+            repetido = repetido || diretorios[k] == diretorio;
+        if (repetido)
+            continue;
+        diretorios.push_back(diretorio);
+
+        // IN_CLOSE_WRITE: gravado no lugar; IN_MOVED_TO: renomeado por cima
+        if (inotify_add_watch(inotify_fd, diretorio.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+        {
+            fprintf(stderr, "WARNING: Cannot watch \"%s\" (%s); polling shader files instead.\n",
+                    diretorio.c_str(), strerror(errno));
+            close(inotify_fd);
+            inotify_fd = -1;
+            return;
+        }
+    }
+#endif
+}
+
+bool RecargaShaders::arquivosMudaram()
+{
+    bool alterado = false;
+
+#ifdef __linux__
+    if (inotify_fd >= 0)
+    {
+        std::string nomes[2], diretorio;
+        for (int i = 0; i < 2; ++i)
+            SeparaCaminho(arquivos[i], &diretorio, &nomes[i]);
+
+        // Os eventos chegam em blocos; read() não bloqueia (IN_NONBLOCK)
+        char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+        ssize_t lidos;
+        while ((lidos = read(inotify_fd, buffer, sizeof(buffer))) > 0)
+        {
+            for (char* p = buffer; p < buffer + lidos; )
+            {
+                const struct inotify_event* evento = (const struct inotify_event*)p;
+                if (evento->len > 0)
+                    for (int i = 0; i < 2; ++i)
+                        alterado = alterado || nomes[i] == evento->name;
+                p += sizeof(struct inotify_event) + evento->len;
+            }
+        }
+        return alterado;
+    }
+#endif
+
+    std::chrono::steady_clock::time_point agora = std::chrono::steady_clock::now();
+    if (agora - ultima_consulta < std::chrono::milliseconds(INTERVALO_CONSULTA_MS))
+        return false;
+    ultima_consulta = agora;
+
+    for (int i = 0; i < 2; ++i)
+    {
+        long long atual = Modificacao(arquivos[i]);
+        if (atual != modificacao[i])
+        {
+            modificacao[i] = atual;
+            alterado = true;
+        }
+    }
+    return alterado;
+}
+
+void RecargaShaders::inicia()
+{
+    std::string fontes[2];
+    for (int i = 0; i < 2; ++i)
+    {
+        // Um arquivo no meio de uma gravação é lido de novo no próximo evento
+        if (!LeArquivoShader(arquivos[i].c_str(), &fontes[i]))
+        {
+            fprintf(stderr, "WARNING: Cannot read \"%s\" to reload program \"%s\".\n", arquivos[i].c_str(), nome.c_str());
+            return;
+        }
+    }
+
+    criacao = g_CacheProgramas.inicia(nome.c_str(), fontes[0], fontes[1]);
+    compilando = true;
+}
+
+GLuint RecargaShaders::atualiza()
+{
+    if (arquivosMudaram())
+        mudou = true;
+
+    GLuint novo_programa = 0;
+    if (compilando)
+    {
+        if (!g_CacheProgramas.pronto(criacao))
+            return 0;
+
+        compilando = false;
+        if (g_CacheProgramas.termina(&criacao))
+        {
+            printf("Programa \"%s\" recarregado.\n", nome.c_str());
+            novo_programa = criacao.program_id;
+        }
+        else
+        {
+            fprintf(stderr, "WARNING: Keeping the previous \"%s\" program.\n", nome.c_str());
+            glDeleteProgram(criacao.program_id);
+        }
+    }
+
+    if (mudou)
+    {
+        mudou = false;
+        inicia();
+    }
+    return novo_programa;
+}
@@ -0,0 +1,402 @@
+#include "Malha.h"
+#include <cmath>
+#include <cstring>
+#include <queue>
+#include <unordered_map>
+#include <glm/vec3.hpp>
+#include <glm/geometric.hpp>
+
+// Simplificação por métrica de erro quádrica (Garland e Heckbert, "Surface
+// Simplification Using Quadric Error Metrics", 1997), com colapsos de meia
+// aresta: um vértice u é sempre levado até um vizinho v que já existe. Assim
+// os níveis simplificados só precisam de índices novos, sobre os mesmos
+// vértices do nível 0, e cabem no mesmo VBO.
+
+// Quádrica simétrica 4x4, guardada pelo triângulo superior:
+//     | a[0] a[1] a[2] a[3] |
+//     |      a[4] a[5] a[6] |
+//     |           a[7] a[8] |
+//     |                a[9] |
+struct Quadrica
+{
+    double a[10];
+
+    Quadrica() { memset(a, 0, sizeof(a)); }
+
+    // Quádrica da distância ao quadrado até o plano n.p + d = 0, com peso
+    static Quadrica Plano(const glm::dvec3& n, double d, double peso)
+    {
+        Quadrica q;
+        q.a[0] = peso*n.x*n.x; q.a[1] = peso*n.x*n.y; q.a[2] = peso*n.x*n.z; q.a[3] = peso*n.x*d;
+        q.a[4] = peso*n.y*n.y; q.a[5] = peso*n.y*n.z; q.a[6] = peso*n.y*d;
+        q.a[7] = peso*n.z*n.z; q.a[8] = peso*n.z*d;
+        q.a[9] = peso*d*d;
+        return q;
+    }
+
+    void soma(const Quadrica& q)
+    {
+        for (int i = 0; i < 10; ++i)
+            a[i] += q.a[i];
+    }
+
+    double erro(const glm::dvec3& p) const
+    {
+        return a[0]*p.x*p.x + 2*a[1]*p.x*p.y + 2*a[2]*p.x*p.z + 2*a[3]*p.x
+             + a[4]*p.y*p.y + 2*a[5]*p.y*p.z + 2*a[6]*p.y
+             + a[7]*p.z*p.z + 2*a[8]*p.z
+             + a[9];
+    }
+};
+
+// Colapso candidato de u até v, com as versões de u e v no momento em que
+// foi calculado: se algum dos dois mudou desde então, o candidato é velho.
+struct Colapso
+{
+    double custo;
+    uint32_t u, v;
+    uint32_t versao_u, versao_v;
+
+    bool operator<(const Colapso& outro) const { return custo > outro.custo; } // Fila de prioridade mínima
+};
+
+// Peso das quádricas das bordas abertas, para que o contorno da malha não
+// encolha antes do interior.
+static const double PESO_BORDA = 10.0;
+
+// Um colapso que gira a normal de algum triângulo mais do que isto
+// (cosseno) é recusado: evita dobras e triângulos virados.
+static const double COSSENO_MINIMO_NORMAL = 0.2;
+
+// Simplificador de um nível: os vértices de mesma posição (separados pela
+// conversão por terem normais diferentes) formam um grupo, e os colapsos são
+// feitos sobre os grupos, para que a malha não se abra nas costuras.
+class Simplificador
+{
+    public:
+        Simplificador(const Malha& malha, const uint32_t* indices, size_t num_indices);
+
+        size_t triangulosVivos() const { return vivos; }
+        void simplificaAte(size_t triangulos_alvo);
+        void indices(std::vector<uint32_t>* saida) const;
+
+    private:
+        const Malha& malha;
+        std::vector<uint32_t> grupo;                     // Grupo de cada vértice
+        std::vector<std::vector<uint32_t> > vertices_do_grupo;
+        std::vector<glm::dvec3> posicao;                 // Por grupo
+        std::vector<Quadrica> quadrica;                  // Por grupo
+        std::vector<uint32_t> versao;                    // Por grupo
+        std::vector<uint8_t> removido;                   // Por grupo
+        std::vector<std::vector<uint32_t> > triangulos_do_grupo;
+
+        std::vector<uint32_t> cantos;                    // Vértices originais, 3 por triângulo
+        std::vector<uint32_t> tri;                       // Grupos atuais, 3 por triângulo
+        std::vector<uint8_t> vivo;
+        size_t vivos;
+
+        std::priority_queue<Colapso> candidatos;
+
+        glm::dvec3 normal(uint32_t a, uint32_t b, uint32_t c) const;
+        bool valido(uint32_t u, uint32_t v) const;
+        void adicionaCandidato(uint32_t u, uint32_t v);
+        void colapsa(uint32_t u, uint32_t v);
+};
+
+struct HashPosicao
+{
+    size_t operator()(const glm::vec3& p) const
+    {
+        uint32_t bits[3];
+        memcpy(bits, &p, sizeof(bits));
+        return (size_t)(bits[0] * 73856093u ^ bits[1] * 19349663u ^ bits[2] * 83492791u);
+    }
+};
+
+Simplificador::Simplificador(const Malha& m, const uint32_t* indices, size_t num_indices)
+    : malha(m)
+{
+    // Grupos de vértices com a mesma posição
+    std::unordered_map<glm::vec3, uint32_t, HashPosicao> grupos;
+    grupo.resize(malha.vertices.size());
+    for (size_t i = 0; i < malha.vertices.size(); ++i)
+    {
+        const float* p = malha.vertices[i].posicao;
+        std::pair<std::unordered_map<glm::vec3, uint32_t, HashPosicao>::iterator, bool> r =
+            grupos.insert(std::make_pair(glm::vec3(p[0], p[1], p[2]), (uint32_t)posicao.size()));
+        if (r.second)
+        {
+            posicao.push_back(glm::dvec3(p[0], p[1], p[2]));
+            vertices_do_grupo.push_back(std::vector<uint32_t>());
+        }
+        grupo[i] = r.first->second;
+        vertices_do_grupo[grupo[i]].push_back((uint32_t)i);
+    }
+
+    const size_t num_grupos = posicao.size();
+    quadrica.resize(num_grupos);
+    versao.assign(num_grupos, 0);
+    removido.assign(num_grupos, 0);
+    triangulos_do_grupo.resize(num_grupos);
+
+    const size_t num_triangulos = num_indices / 3;
+    cantos.assign(indices, indices + 3 * num_triangulos);
+    tri.resize(3 * num_triangulos);
+    vivo.assign(num_triangulos, 1);
+    vivos = 0;
+
+    // Arestas (a, b) com a < b e quantos triângulos as usam, para achar as bordas
+    std::unordered_map<uint64_t, uint32_t> usos_aresta;
+
+    for (size_t t = 0; t < num_triangulos; ++t)
+    {
+        for (int k = 0; k < 3; ++k)
+            tri[3*t + k] = grupo[cantos[3*t + k]];
+
+        const uint32_t a = tri[3*t], b = tri[3*t + 1], c = tri[3*t + 2];
+        if (a == b || b == c || a == c)
+        {
+            vivo[t] = 0;
+            continue;
+        }
+        ++vivos;
+
+        for (int k = 0; k < 3; ++k)
+        {
+            triangulos_do_grupo[tri[3*t + k]].push_back((uint32_t)t);
+            uint32_t x = tri[3*t + k], y = tri[3*t + (k + 1) % 3];
+            if (x > y)
+                std::swap(x, y);
+            ++usos_aresta[((uint64_t)x << 32) | y];
+        }
+
+        // Quádrica do plano do triângulo, com peso pela área
+        glm::dvec3 n = glm::cross(posicao[b] - posicao[a], posicao[c] - posicao[a]);
+        const double dobro_area = glm::length(n);
+        if (dobro_area <= 0.0)
+            continue;
+        n /= dobro_area;
+        Quadrica q = Quadrica::Plano(n, -glm::dot(n, posicao[a]), 0.5 * dobro_area);
+        quadrica[a].soma(q);
+        quadrica[b].soma(q);
+        quadrica[c].soma(q);
+    }
+
+    // Bordas: um plano perpendicular ao triângulo, passando pela aresta
+    for (size_t t = 0; t < num_triangulos; ++t)
+    {
+        if (!vivo[t])
+            continue;
+        const glm::dvec3 n = normal(tri[3*t], tri[3*t + 1], tri[3*t + 2]);
+        for (int k = 0; k < 3; ++k)
+        {
+            uint32_t x = tri[3*t + k], y = tri[3*t + (k + 1) % 3];
+            if (usos_aresta[((uint64_t)std::min(x, y) << 32) | std::max(x, y)] != 1)
+                continue;
+            glm::dvec3 aresta = posicao[y] - posicao[x];
+            const double comprimento = glm::length(aresta);
+            glm::dvec3 np = glm::cross(aresta, n);
+            if (comprimento <= 0.0 || glm::length(np) <= 0.0)
+                continue;
+            np = glm::normalize(np);
+            Quadrica q = Quadrica::Plano(np, -glm::dot(np, posicao[x]), PESO_BORDA * comprimento * comprimento);
+            quadrica[x].soma(q);
+            quadrica[y].soma(q);
+        }
+    }
+
+    for (size_t t = 0; t < num_triangulos; ++t)
+    {
+        if (!vivo[t])
+            continue;
+        for (int k = 0; k < 3; ++k)
+            adicionaCandidato(tri[3*t + k], tri[3*t + (k + 1) % 3]);
+    }
+}
+
+glm::dvec3 Simplificador::normal(uint32_t a, uint32_t b, uint32_t c) const
+{
+    glm::dvec3 n = glm::cross(posicao[b] - posicao[a], posicao[c] - posicao[a]);
+    const double comprimento = glm::length(n);
+    return comprimento > 0.0 ? n / comprimento : n;
+}
+
+// Os dois sentidos da aresta são candidatos; custam diferente, já que o
+// vértice que fica é outro.
+void Simplificador::adicionaCandidato(uint32_t u, uint32_t v)
+{
+    Quadrica q = quadrica[u];
+    q.soma(quadrica[v]);
+
+    Colapso colapso;
+    colapso.versao_u = versao[u];
+    colapso.versao_v = versao[v];
+
+    colapso.u = u;
+    colapso.v = v;
+    colapso.custo = q.erro(posicao[v]);
+    candidatos.push(colapso);
+
+    colapso.u = v;
+    colapso.v = u;
+    colapso.custo = q.erro(posicao[u]);
+    candidatos.push(colapso);
+}
+
+bool Simplificador::valido(uint32_t u, uint32_t v) const
+{
+    const std::vector<uint32_t>& lista = triangulos_do_grupo[u];
+    for (size_t i = 0; i < lista.size(); ++i)
+    {
+        const uint32_t t = lista[i];
+        if (!vivo[t])
+            continue;
+
+        uint32_t g[3] = { tri[3*t], tri[3*t + 1], tri[3*t + 2] };
+        if (g[0] == v || g[1] == v || g[2] == v)
+            continue; // Some no colapso
+
+        const glm::dvec3 antes = normal(g[0], g[1], g[2]);
+        for (int k = 0; k < 3; ++k)
+            if (g[k] == u)
+                g[k] = v;
+        const glm::dvec3 depois = normal(g[0], g[1], g[2]);
+        if (glm::dot(antes, depois) < COSSENO_MINIMO_NORMAL)
+            return false;
+    }
+    return true;
+}
+
+void Simplificador::colapsa(uint32_t u, uint32_t v)
+{
+    removido[u] = 1;
+    quadrica[v].soma(quadrica[u]);
+    ++versao[v];
+
+    std::vector<uint32_t>& lista = triangulos_do_grupo[u];
+    for (size_t i = 0; i < lista.size(); ++i)
+    {
+        const uint32_t t = lista[i];
+        if (!vivo[t])
+            continue;
+
+        uint32_t* g = &tri[3*t];
+        if (g[0] == v || g[1] == v || g[2] == v)
+        {
+            vivo[t] = 0;
+            --vivos;
+            continue;
+        }
+        for (int k = 0; k < 3; ++k)
+            if (g[k] == u)
+                g[k] = v;
+        triangulos_do_grupo[v].push_back(t);
+    }
+    lista.clear();
+
+    // Os triângulos mortos saem da lista de v, e os custos até os vizinhos
+    // são recalculados com a nova quádrica de v
+    std::vector<uint32_t>& lista_v = triangulos_do_grupo[v];
+    size_t restantes = 0;
+    for (size_t i = 0; i < lista_v.size(); ++i)
+    {
+        const uint32_t t = lista_v[i];
+        if (!vivo[t])
+            continue;
+        lista_v[restantes++] = t;
+        for (int k = 0; k < 3; ++k)
+            if (tri[3*t + k] != v)
+                adicionaCandidato(v, tri[3*t + k]);
+    }
+    lista_v.resize(restantes);
+}
+
+void Simplificador::simplificaAte(size_t triangulos_alvo)
+{
+    while (vivos > triangulos_alvo && !candidatos.empty())
+    {
+        const Colapso c = candidatos.top();
+        candidatos.pop();
+
+        if (removido[c.u] || removido[c.v] || c.versao_u != versao[c.u] || c.versao_v != versao[c.v])
+            continue;
+        if (!valido(c.u, c.v))
+            continue;
+
+        colapsa(c.u, c.v);
+    }
+}
+
+// Cada canto de um triângulo restante usa o vértice original, se o grupo dele
+// não foi colapsado, ou o vértice do novo grupo de normal mais parecida.
+void Simplificador::indices(std::vector<uint32_t>* saida) const
+{
+    saida->clear();
+    saida->reserve(3 * vivos);
+    for (size_t t = 0; t < vivo.size(); ++t)
+    {
+        if (!vivo[t])
+            continue;
+        for (int k = 0; k < 3; ++k)
+        {
+            const uint32_t original = cantos[3*t + k];
+            const uint32_t g = tri[3*t + k];
+            if (grupo[original] == g)
+            {
+                saida->push_back(original);
+                continue;
+            }
+
+            const float* n = malha.vertices[original].normal;
+            const std::vector<uint32_t>& candidatos_vertice = vertices_do_grupo[g];
+            uint32_t melhor = candidatos_vertice[0];
+            float melhor_cosseno = -2.0f;
+            for (size_t i = 0; i < candidatos_vertice.size(); ++i)
+            {
+                const float* m = malha.vertices[candidatos_vertice[i]].normal;
+                const float cosseno = n[0]*m[0] + n[1]*m[1] + n[2]*m[2];
+                if (cosseno > melhor_cosseno)
+                {
+                    melhor_cosseno = cosseno;
+                    melhor = candidatos_vertice[i];
+                }
+            }
+            saida->push_back(melhor);
+        }
+    }
+}
+
+void GeraNiveisDeDetalhe(Malha* malha)
+{
+    malha->niveis.clear();
+    NivelMalha completo = { 0, (uint32_t)malha->indices.size() };
+    malha->niveis.push_back(completo);
+
+    const size_t num_triangulos = malha->indices.size() / 3;
+    if (num_triangulos < MINIMO_TRIANGULOS_NIVEIS)
+        return;
+
+    // Cada nível é simplificado a partir do anterior, pela mesma fila de
+    // colapsos
+    Simplificador simplificador(*malha, malha->indices.data(), malha->indices.size());
+    size_t alvo = num_triangulos;
+    size_t anterior = num_triangulos;
+    std::vector<uint32_t> indices;
+    for (int nivel = 1; nivel < MAXIMO_NIVEIS_MALHA; ++nivel)
+    {
+        alvo /= 2;
+        simplificador.simplificaAte(alvo);
+
+        // Um nível que quase não reduziu não vale o espaço
+        if (simplificador.triangulosVivos() > anterior * 3 / 4)
+            break;
+        anterior = simplificador.triangulosVivos();
+
+        simplificador.indices(&indices);
+        OtimizaCacheVertices(&indices, malha->vertices.size());
+
+        NivelMalha simplificado = { (uint32_t)malha->indices.size(), (uint32_t)indices.size() };
+        malha->indices.insert(malha->indices.end(), indices.begin(), indices.end());
+        malha->niveis.push_back(simplificado);
+    }
+}
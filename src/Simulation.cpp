@@ -0,0 +1,241 @@
+#include "Simulation.h"
+#include <cmath>
+
+const double Simulation::DURACAO_PASSO = 1.0 / Simulation::PASSOS_POR_SEGUNDO;
+const double Simulation::TEMPO_LIMITE = 35.0;
+
+// Maior intervalo de tempo real consumido por uma chamada de avanca(). Se o
+// jogo travar (janela arrastada, depurador...), descartamos o excesso em vez
+// de executar centenas de passos de uma vez.
+static const double MAXIMO_AVANCO = 0.25;
+
+// Ângulo do vetor "sentido" no plano XZ, na mesma convenção de
+// Rigida_RotacaoY(): sentido = (sin(a), 0, cos(a)).
+static float AnguloNoPlanoXZ(glm::vec4 v)
+{
+    return atan2f(v.x, v.z);
+}
+
+Simulation::Simulation()
+{
+    pista = NULL;
+    reinicia();
+}
+
+// A pista precisa viver mais que a simulação. Trocar de pista reinicia a
+// corrida, com o carro na largada da nova pista.
+void Simulation::setPista(const Pista* pista)
+{
+    this->pista = pista;
+    reinicia();
+}
+
+void Simulation::reinicia()
+{
+    carro = Carro();
+    carro.setPista(pista);
+    if (pista)
+        carro.posiciona(pista->getLargadaX(), pista->getLargadaZ(), pista->getLargadaAngulo());
+    proximo_checkpoint = 0;
+    fila.clear();
+    for (int i = 0; i < NUM_ACOES; ++i)
+        acoes[i] = false;
+    atual = capturaEstado();
+    anterior = atual;
+    acumulador = 0.0;
+    passos = 0;
+    fim = false;
+    vitoria = false;
+    tempo_final = 0.0;
+}
+
+Simulation::EstadoCarro Simulation::capturaEstado()
+{
+    EstadoCarro estado;
+    estado.transformacao = carro.getTransformacao();
+    estado.escala  = carro.getEscala();
+    estado.posicao = carro.getPosition();
+    estado.sentido = carro.getCameraView();
+    return estado;
+}
+
+void Simulation::enfileira(Acao acao, bool pressionado)
+{
+    ComandoEntrada comando;
+    comando.acao = acao;
+    comando.pressionado = pressionado;
+    fila.push_back(comando);
+}
+
+void Simulation::passo()
+{
+    // Um toque rápido (pressiona e solta antes do próximo passo) ainda deve
+    // mover o carro uma vez, por isso guardamos também quem foi disparado.
+    bool disparou[NUM_ACOES] = { false, false, false, false };
+    while (!fila.empty())
+    {
+        ComandoEntrada comando = fila.front();
+        fila.pop_front();
+        acoes[comando.acao] = comando.pressionado;
+        if (comando.pressionado)
+            disparou[comando.acao] = true;
+    }
+
+    anterior = atual;
+
+    if (fim)
+        return;
+
+    if (acoes[ACAO_ACELERAR] || disparou[ACAO_ACELERAR])
+        carro.moveCarro(tempoDeCorrida());
+    if (acoes[ACAO_RE] || disparou[ACAO_RE])
+        carro.moveCarBack();
+    if (acoes[ACAO_ESQUERDA] || disparou[ACAO_ESQUERDA])
+        carro.turnLeft();
+    if (acoes[ACAO_DIREITA] || disparou[ACAO_DIREITA])
+        carro.turnRight();
+
+    passos++;
+    atual = capturaEstado();
+
+    // A chegada só vale depois de todos os checkpoints, cruzados em ordem
+    const size_t checkpoints = pista ? pista->numeroDeCheckpoints() : 0;
+    if (proximo_checkpoint < checkpoints && carro.cruzouCheckpoint(proximo_checkpoint))
+        proximo_checkpoint++;
+
+    // tempo_final é calculado antes de marcar o fim: com fim == true,
+    // tempoDeCorrida() passa a devolver o próprio tempo_final
+    if (proximo_checkpoint == checkpoints && carro.cruzouChegada())
+    {
+        tempo_final = passos * DURACAO_PASSO;
+        fim = true;
+        vitoria = true;
+    }
+    else if (tempoDeCorrida() > TEMPO_LIMITE)
+    {
+        tempo_final = passos * DURACAO_PASSO;
+        fim = true;
+    }
+}
+
+// Consome "segundos" de tempo real, executando quantos passos fixos couberem.
+// O que sobrar fica no acumulador e vira o fator de interpolação alpha().
+int Simulation::avanca(double segundos)
+{
+    if (segundos > MAXIMO_AVANCO)
+        segundos = MAXIMO_AVANCO;
+    if (segundos < 0.0)
+        segundos = 0.0;
+
+    acumulador += segundos;
+
+    int executados = 0;
+    while (acumulador >= DURACAO_PASSO)
+    {
+        passo();
+        acumulador -= DURACAO_PASSO;
+        executados++;
+    }
+    return executados;
+}
+
+// Executa passos sem consultar relógio algum; usado pelo binário headless.
+void Simulation::executaPassos(unsigned long n)
+{
+    for (unsigned long i = 0; i < n; ++i)
+        passo();
+}
+
+float Simulation::alpha() const
+{
+    return (float)(acumulador / DURACAO_PASSO);
+}
+
+unsigned long Simulation::numeroDePassos() const
+{
+    return passos;
+}
+
+double Simulation::tempoDeCorrida() const
+{
+    if (fim)
+        return tempo_final;
+    return passos * DURACAO_PASSO;
+}
+
+bool Simulation::terminou() const
+{
+    return fim;
+}
+
+bool Simulation::venceu() const
+{
+    return vitoria;
+}
+
+size_t Simulation::checkpointsCruzados() const
+{
+    return proximo_checkpoint;
+}
+
+Carro& Simulation::getCarro()
+{
+    return carro;
+}
+
+// Interpola posição e ângulo do carro entre os dois últimos passos. O ângulo
+// é interpolado pelo menor arco, para não dar uma volta inteira quando passa
+// de -pi para pi.
+void Simulation::interpola(float alpha, glm::vec4* posicao, glm::vec4* sentido, float* angulo) const
+{
+    float delta = AnguloNoPlanoXZ(atual.sentido) - AnguloNoPlanoXZ(anterior.sentido);
+    if (delta > 3.141592f)
+        delta -= 2.0f * 3.141592f;
+    if (delta < -3.141592f)
+        delta += 2.0f * 3.141592f;
+
+    *angulo = alpha * delta;
+    *posicao = anterior.posicao + alpha * (atual.posicao - anterior.posicao);
+    *posicao = glm::vec4(posicao->x, posicao->y, posicao->z, 1.0f);
+
+    float a = AnguloNoPlanoXZ(anterior.sentido) + *angulo;
+    *sentido = glm::vec4(sinf(a), 0.0f, cosf(a), 0.0f);
+}
+
+// Todas as operações de Carro são rotações em torno da sua posição e
+// translações, então matriz = T(posicao) * R(angulo) * B para uma matriz B
+// constante. Assim a matriz interpolada é obtida aplicando à transformação
+// do passo anterior apenas a fração alpha do movimento rígido entre os dois
+// passos.
+glm::mat4 Simulation::getMatrixInterpolada(float alpha) const
+{
+    glm::vec4 posicao, sentido;
+    float angulo;
+    interpola(alpha, &posicao, &sentido, &angulo);
+
+    TransformacaoRigida movida = Rigida_GiraYEmTorno(anterior.transformacao, cosf(angulo), sinf(angulo),
+                                                     glm::vec3(anterior.posicao));
+    movida.translacao += glm::vec3(posicao - anterior.posicao);
+    return Rigida_Matriz(movida, anterior.escala);
+}
+
+// Mesma fórmula de Carro::getCameraPosition(), aplicada ao estado interpolado.
+glm::vec4 Simulation::getCameraPositionInterpolada(float alpha) const
+{
+    glm::vec4 posicao, sentido;
+    float angulo;
+    interpola(alpha, &posicao, &sentido, &angulo);
+
+    glm::vec4 result = posicao;
+    result[1] += 3;
+    result = result - 8.0f*sentido;
+    return result;
+}
+
+glm::vec4 Simulation::getCameraViewInterpolada(float alpha) const
+{
+    glm::vec4 posicao, sentido;
+    float angulo;
+    interpola(alpha, &posicao, &sentido, &angulo);
+    return sentido;
+}
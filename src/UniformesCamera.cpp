@@ -0,0 +1,69 @@
+#include "UniformesCamera.h"
+#include <cstdio>
+
+static const char* NOME_BLOCO = "Camera";
+
+UniformesCamera::UniformesCamera()
+{
+    UBO_id = 0;
+}
+
+UniformesCamera::~UniformesCamera()
+{
+    //dtor
+}
+
+void UniformesCamera::inicializa()
+{
+    glGenBuffers(1, &UBO_id);
+    glBindBuffer(GL_UNIFORM_BUFFER, UBO_id);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(BlocoCamera), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    glBindBufferBase(GL_UNIFORM_BUFFER, PONTO_DE_LIGACAO, UBO_id);
+}
+
+// O GLSL 3.30 não aceita layout(binding = ...): o bloco de cada programa é
+// ligado ao ponto aqui.
+void UniformesCamera::associa(GLuint program_id) const
+{
+    GLuint indice = glGetUniformBlockIndex(program_id, NOME_BLOCO);
+    if (indice == GL_INVALID_INDEX)
+    {
+        fprintf(stderr, "WARNING: Program %u does not declare the uniform block \"%s\".\n", program_id, NOME_BLOCO);
+        return;
+    }
+
+    GLint tamanho = 0;
+    glGetActiveUniformBlockiv(program_id, indice, GL_UNIFORM_BLOCK_DATA_SIZE, &tamanho);
+    if (tamanho != (GLint)sizeof(BlocoCamera))
+        fprintf(stderr, "WARNING: Uniform block \"%s\" has %d bytes in program %u, expected %u.\n",
+                NOME_BLOCO, tamanho, program_id, (unsigned int)sizeof(BlocoCamera));
+
+    glUniformBlockBinding(program_id, indice, PONTO_DE_LIGACAO);
+}
+
+void UniformesCamera::atualiza(const glm::mat4& view, const glm::mat4& projection)
+{
+    bloco.view = view;
+    bloco.projection = projection;
+    bloco.view_projection = projection * view;
+
+    // A view é uma transformação rígida [R | t]: a câmera está em -R^T t,
+    // sem precisar inverter a matriz inteira.
+    glm::vec4 t = view[3];
+    bloco.posicao_camera = glm::vec4(
+        -(view[0][0]*t.x + view[0][1]*t.y + view[0][2]*t.z),
+        -(view[1][0]*t.x + view[1][1]*t.y + view[1][2]*t.z),
+        -(view[2][0]*t.x + view[2][1]*t.y + view[2][2]*t.z),
+        1.0f);
+
+    glBindBuffer(GL_UNIFORM_BUFFER, UBO_id);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(BlocoCamera), &bloco);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+const BlocoCamera& UniformesCamera::getBloco() const
+{
+    return bloco;
+}
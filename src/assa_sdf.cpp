@@ -0,0 +1,45 @@
+// Assa o campo de distância com sinal (SDF) das paredes de uma pista e grava
+// ao lado do arquivo dela (pista.txt -> pista.sdf), onde Pista::carrega() o
+// encontra. Deve ser executado de novo sempre que a pista mudar; um SDF
+// desatualizado é ignorado pelo jogo.
+//
+// Uso: assa_sdf arquivo_da_pista [espaçamento]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "Pista.h"
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Uso: %s arquivo_da_pista [espacamento]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const char* arquivo_pista = argv[1];
+    float passo = 0.05f;
+    if (argc > 2)
+        passo = (float)atof(argv[2]);
+
+    Pista pista;
+    if (!pista.carrega(arquivo_pista))
+        return EXIT_FAILURE;
+
+    std::chrono::steady_clock::time_point inicio = std::chrono::steady_clock::now();
+    if (!pista.assaSdf(passo))
+    {
+        fprintf(stderr, "ERROR: Invalid SDF spacing %f.\n", passo);
+        return EXIT_FAILURE;
+    }
+    double segundos = std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+
+    std::string destino = Pista::CaminhoSdf(arquivo_pista);
+    if (!pista.salvaSdf(destino.c_str()))
+        return EXIT_FAILURE;
+
+    printf("SDF de \"%s\" gravado em \"%s\" (espacamento %.3f, %.2f s).\n", arquivo_pista, destino.c_str(), passo, segundos);
+    return 0;
+}
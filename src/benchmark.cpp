@@ -0,0 +1,652 @@
+// Microbenchmarks da lógica do jogo, sem janela nem OpenGL.
+//
+// Uso: benchmark colisao [arquivo da pista] [consultas]
+//        benchmark obj [arquivo OBJ] [repetições]
+//        benchmark normais [arquivo OBJ] [repetições]
+//        benchmark matrizes [repetições]
+//
+// "colisao" compara, sobre as mesmas poses aleatórias de carro, o teste
+// analítico da pista retangular (TestaColisaoCarro, que substituiu
+// Carro::cruzouLimites), o teste de segmentos pela grade uniforme e as
+// amostras do SDF. Se não houver .sdf ao lado da pista, ele é assado em
+// memória antes da medição.
+//
+// "obj" lê o mesmo OBJ com tinyobj::LoadObj() e com LeObjParalelo(), com uma
+// thread e com todas, e confere que as estruturas lidas são iguais.
+//
+// "normais" mede ComputeNormals() contra a versão escalar anterior no OBJ e
+// em uma grade sintética de ~1 milhão de triângulos, com os vértices na ordem
+// da grade e embaralhados (acesso aleatório, como numa malha mal ordenada).
+// No peso por área o resultado deve coincidir com a referência a menos de
+// arredondamento; o maior ângulo entre as duas normais é impresso.
+//
+// "matrizes" compara os núcleos SSE/AVX de matrices.h e as operações de
+// TransformacaoRigida (Rigida.h) com os produtos de glm::mat4 que eles
+// substituem, sobre as mesmas matrizes aleatórias, e imprime a maior
+// diferença entre os resultados.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "Malha.h"
+#include "Pista.h"
+#include "Rigida.h"
+#include "matrices.h"
+#include <thread>
+
+// Mesmo gerador de headless.cpp, para poses reprodutíveis.
+static unsigned int ProximoAleatorio(unsigned int* estado)
+{
+    *estado = *estado * 1664525u + 1013904223u;
+    return *estado >> 16;
+}
+
+struct Poses
+{
+    std::vector<float> x, z, dir_x, dir_z;
+};
+
+// Mede "consultas" chamadas de Pista::testaCarro() com a configuração atual
+// da pista e guarda os resultados para comparar os métodos entre si.
+static double MedeTestes(const Pista& pista, const Poses& poses, float l, float w, std::vector<uint8_t>* resultados)
+{
+    const size_t n = poses.x.size();
+    resultados->resize(n);
+
+    std::chrono::steady_clock::time_point inicio = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < n; ++i)
+        (*resultados)[i] = (uint8_t)pista.testaCarro(poses.x[i], poses.z[i], poses.dir_x[i], poses.dir_z[i], l, w);
+    std::chrono::steady_clock::time_point fim = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::nano>(fim - inicio).count() / n;
+}
+
+static void ImprimeComparacao(const char* nome, double ns, const std::vector<uint8_t>& resultados,
+                              const std::vector<uint8_t>& referencia)
+{
+    size_t iguais = 0, paredes = 0;
+    for (size_t i = 0; i < resultados.size(); ++i)
+    {
+        iguais += (resultados[i] & COLISAO_PAREDE) == (referencia[i] & COLISAO_PAREDE);
+        paredes += (resultados[i] & COLISAO_PAREDE) != 0;
+    }
+    printf("  %-22s %8.1f ns/consulta  %6.2f%% com parede  %6.2f%% igual a grade\n", nome, ns,
+           100.0 * paredes / resultados.size(), 100.0 * iguais / resultados.size());
+}
+
+static int BenchmarkColisao(const char* arquivo_pista, size_t consultas)
+{
+    Pista pista;
+    if (!pista.carrega(arquivo_pista))
+        return EXIT_FAILURE;
+
+    if (!pista.temSdf())
+    {
+        printf("Sem SDF para \"%s\", assando em memoria.\n", arquivo_pista);
+        pista.assaSdf(0.05f);
+    }
+
+    // Carros com as dimensões de Carro e o centro sobre o asfalto (o SDF
+    // decide quem está no asfalto), como durante o jogo: um carro nunca
+    // chega a ficar inteiro dentro de uma parede.
+    const float l = 1.15f, w = 0.6f;
+    float min_x, min_z, max_x, max_z;
+    pista.getLimites(&min_x, &min_z, &max_x, &max_z);
+
+    Poses poses;
+    unsigned int estado = 1;
+    for (size_t i = 0; i < consultas; ++i)
+    {
+        const float px = min_x + (max_x - min_x) * (ProximoAleatorio(&estado) / 65535.0f);
+        const float pz = min_z + (max_z - min_z) * (ProximoAleatorio(&estado) / 65535.0f);
+        const float angulo = 6.2831853f * (ProximoAleatorio(&estado) / 65535.0f);
+        if (pista.distanciaParede(px, pz) <= 0.0f)
+        {
+            --i;
+            continue;
+        }
+        poses.x.push_back(px);
+        poses.z.push_back(pz);
+        poses.dir_x.push_back(sinf(angulo));
+        poses.dir_z.push_back(cosf(angulo));
+    }
+
+    printf("Pista \"%s\", %lu consultas:\n", arquivo_pista, (unsigned long)consultas);
+
+    std::vector<uint8_t> grade, sdf, analitico;
+
+    pista.setUsaAtalhoRetangular(false);
+    pista.setUsaSdf(false);
+    double ns_grade = MedeTestes(pista, poses, l, w, &grade);
+
+    pista.setUsaSdf(true);
+    double ns_sdf = MedeTestes(pista, poses, l, w, &sdf);
+
+    ImprimeComparacao("segmentos (grade)", ns_grade, grade, grade);
+    ImprimeComparacao("SDF", ns_sdf, sdf, grade);
+
+    if (pista.ehRetangular())
+    {
+        pista.setUsaAtalhoRetangular(true);
+        double ns_analitico = MedeTestes(pista, poses, l, w, &analitico);
+        ImprimeComparacao("analitico (retangulos)", ns_analitico, analitico, grade);
+    }
+    else
+    {
+        printf("  (pista nao retangular: sem teste analitico)\n");
+    }
+
+    return 0;
+}
+
+struct LeituraObj
+{
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+};
+
+// Leitor de OBJ com a assinatura de tinyobj::LoadObj(); threads < 0 usa a tinyobjloader
+static bool LeObj(const char* arquivo, int threads, LeituraObj* leitura)
+{
+    std::string err;
+    leitura->materials.clear();
+    if (threads < 0)
+        return tinyobj::LoadObj(&leitura->attrib, &leitura->shapes, &leitura->materials, &err, arquivo);
+    return LeObjParalelo(&leitura->attrib, &leitura->shapes, &leitura->materials, &err, arquivo, NULL, true, threads);
+}
+
+static bool IndicesIguais(const std::vector<tinyobj::index_t>& a, const std::vector<tinyobj::index_t>& b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); ++i)
+        if (a[i].vertex_index != b[i].vertex_index || a[i].normal_index != b[i].normal_index
+            || a[i].texcoord_index != b[i].texcoord_index)
+            return false;
+    return true;
+}
+
+static bool LeiturasIguais(const LeituraObj& a, const LeituraObj& b)
+{
+    if (a.attrib.vertices != b.attrib.vertices || a.attrib.normals != b.attrib.normals
+        || a.attrib.texcoords != b.attrib.texcoords || a.shapes.size() != b.shapes.size()
+        || a.materials.size() != b.materials.size())
+        return false;
+    for (size_t i = 0; i < a.shapes.size(); ++i)
+    {
+        const tinyobj::mesh_t& ma = a.shapes[i].mesh;
+        const tinyobj::mesh_t& mb = b.shapes[i].mesh;
+        if (a.shapes[i].name != b.shapes[i].name || !IndicesIguais(ma.indices, mb.indices)
+            || ma.num_face_vertices != mb.num_face_vertices || ma.material_ids != mb.material_ids)
+            return false;
+    }
+    return true;
+}
+
+// Menor tempo de "repeticoes" leituras, em milissegundos
+static double MedeLeitura(const char* arquivo, int threads, int repeticoes, LeituraObj* leitura)
+{
+    double melhor = 0.0;
+    for (int r = 0; r < repeticoes; ++r)
+    {
+        std::chrono::steady_clock::time_point inicio = std::chrono::steady_clock::now();
+        if (!LeObj(arquivo, threads, leitura))
+            return -1.0;
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - inicio).count();
+        melhor = r == 0 ? ms : std::min(melhor, ms);
+    }
+    return melhor;
+}
+
+static int BenchmarkObj(const char* arquivo, int repeticoes)
+{
+    LeituraObj referencia, leitura;
+    double ms_tinyobj = MedeLeitura(arquivo, -1, repeticoes, &referencia);
+    if (ms_tinyobj < 0.0)
+    {
+        fprintf(stderr, "ERROR: Cannot read \"%s\".\n", arquivo);
+        return EXIT_FAILURE;
+    }
+
+    size_t triangulos = 0;
+    for (size_t i = 0; i < referencia.shapes.size(); ++i)
+        triangulos += referencia.shapes[i].mesh.num_face_vertices.size();
+    printf("OBJ \"%s\", %lu vertices, %lu triangulos, melhor de %d leituras:\n", arquivo,
+           (unsigned long)(referencia.attrib.vertices.size() / 3), (unsigned long)triangulos, repeticoes);
+    printf("  %-22s %8.2f ms\n", "tinyobjloader", ms_tinyobj);
+
+    const int nucleos = std::max((int)std::thread::hardware_concurrency(), 1);
+    const int threads[2] = { 1, nucleos };
+    for (int i = 0; i < (nucleos > 1 ? 2 : 1); ++i)
+    {
+        double ms = MedeLeitura(arquivo, threads[i], repeticoes, &leitura);
+        char nome[64];
+        snprintf(nome, sizeof(nome), "paralelo (%d thread%s)", threads[i], threads[i] > 1 ? "s" : "");
+        printf("  %-22s %8.2f ms  %5.2fx  %s\n", nome, ms, ms_tinyobj / ms,
+               LeiturasIguais(referencia, leitura) ? "igual" : "DIFERENTE");
+    }
+    return 0;
+}
+
+// Grade de lado x lado vértices em uma superfície ondulada, dois triângulos
+// por célula. Com "embaralha", os índices dos vértices são permutados. No
+// fim vai um triângulo degenerado (aresta de comprimento zero) sobre vértices
+// da grade; com 2 * (lado-1)^2 + 1 triângulos, ele cai no resto processado
+// sem SIMD.
+static void GradeSintetica(int lado, bool embaralha, ObjModel* model)
+{
+    std::vector<uint32_t> permutacao(lado * lado);
+    for (size_t i = 0; i < permutacao.size(); ++i)
+        permutacao[i] = (uint32_t)i;
+    unsigned int estado = 12345;
+    if (embaralha)
+        for (size_t i = permutacao.size() - 1; i > 0; --i)
+            std::swap(permutacao[i], permutacao[ProximoAleatorio(&estado) % (i + 1)]);
+
+    model->attrib.vertices.resize(3 * permutacao.size());
+    for (int i = 0; i < lado; ++i)
+        for (int j = 0; j < lado; ++j)
+        {
+            float* v = &model->attrib.vertices[3 * permutacao[i * lado + j]];
+            v[0] = (float)j;
+            v[1] = sinf(0.1f * i) * cosf(0.07f * j) * 4.0f;
+            v[2] = (float)i;
+        }
+
+    model->shapes.resize(1);
+    tinyobj::mesh_t& mesh = model->shapes[0].mesh;
+    for (int i = 0; i + 1 < lado; ++i)
+        for (int j = 0; j + 1 < lado; ++j)
+        {
+            const int cantos[6] = { i * lado + j, (i + 1) * lado + j, i * lado + j + 1,
+                                    i * lado + j + 1, (i + 1) * lado + j, (i + 1) * lado + j + 1 };
+            for (int c = 0; c < 6; ++c)
+            {
+                tinyobj::index_t indice;
+                indice.vertex_index = (int)permutacao[cantos[c]];
+                indice.normal_index = -1;
+                indice.texcoord_index = -1;
+                mesh.indices.push_back(indice);
+            }
+            mesh.num_face_vertices.push_back(3);
+            mesh.num_face_vertices.push_back(3);
+        }
+
+    const int degenerado[3] = { 0, 0, 1 };
+    for (int c = 0; c < 3; ++c)
+    {
+        tinyobj::index_t indice;
+        indice.vertex_index = (int)permutacao[degenerado[c]];
+        indice.normal_index = -1;
+        indice.texcoord_index = -1;
+        mesh.indices.push_back(indice);
+    }
+    mesh.num_face_vertices.push_back(3);
+}
+
+// Menor tempo de "repeticoes" cálculos de normais, em milissegundos. threads
+// < 0 usa ComputeNormalsEscalar().
+static double MedeNormais(const ObjModel& original, int threads, PesoNormais peso, int repeticoes, ObjModel* model)
+{
+    double melhor = 0.0;
+    for (int r = 0; r < repeticoes; ++r)
+    {
+        *model = original;
+        std::chrono::steady_clock::time_point inicio = std::chrono::steady_clock::now();
+        if (threads < 0)
+            ComputeNormalsEscalar(model);
+        else
+            ComputeNormals(model, peso, threads);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - inicio).count();
+        melhor = r == 0 ? ms : std::min(melhor, ms);
+    }
+    return melhor;
+}
+
+// Referência para PESO_ANGULO: as mesmas contas, uma de cada vez, em double.
+// Triângulos degenerados (normal ou aresta nula) não contribuem.
+static void NormaisAnguloEscalar(const ObjModel& original, ObjModel* model)
+{
+    *model = original;
+    const std::vector<float>& v = model->attrib.vertices;
+    std::vector<double> soma(v.size(), 0.0);
+    for (size_t s = 0; s < model->shapes.size(); ++s)
+    {
+        std::vector<tinyobj::index_t>& indices = model->shapes[s].mesh.indices;
+        for (size_t t = 0; t + 2 < indices.size(); t += 3)
+        {
+            int k[3];
+            double p[3][3];
+            for (int c = 0; c < 3; ++c)
+            {
+                k[c] = indices[t + c].vertex_index;
+                indices[t + c].normal_index = k[c];
+                for (int e = 0; e < 3; ++e)
+                    p[c][e] = v[3 * k[c] + e];
+            }
+            double ab[3], bc[3], ac[3];
+            for (int e = 0; e < 3; ++e)
+            {
+                ab[e] = p[1][e] - p[0][e];
+                bc[e] = p[2][e] - p[1][e];
+                ac[e] = p[2][e] - p[0][e];
+            }
+            double n[3] = { ab[1] * bc[2] - ab[2] * bc[1], ab[2] * bc[0] - ab[0] * bc[2], ab[0] * bc[1] - ab[1] * bc[0] };
+            const double l_n = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            const double l_ab = sqrt(ab[0] * ab[0] + ab[1] * ab[1] + ab[2] * ab[2]);
+            const double l_bc = sqrt(bc[0] * bc[0] + bc[1] * bc[1] + bc[2] * bc[2]);
+            const double l_ac = sqrt(ac[0] * ac[0] + ac[1] * ac[1] + ac[2] * ac[2]);
+            if (l_n == 0.0 || l_ab == 0.0 || l_bc == 0.0 || l_ac == 0.0)
+                continue;
+            const double cossenos[3] = {
+                (ab[0] * ac[0] + ab[1] * ac[1] + ab[2] * ac[2]) / (l_ab * l_ac),
+                -(ab[0] * bc[0] + ab[1] * bc[1] + ab[2] * bc[2]) / (l_ab * l_bc),
+                (ac[0] * bc[0] + ac[1] * bc[1] + ac[2] * bc[2]) / (l_ac * l_bc)
+            };
+            for (int c = 0; c < 3; ++c)
+            {
+                const double angulo = acos(std::min(std::max(cossenos[c], -1.0), 1.0));
+                for (int e = 0; e < 3; ++e)
+                    soma[3 * k[c] + e] += angulo * n[e] / l_n;
+            }
+        }
+    }
+    model->attrib.normals.resize(v.size());
+    for (size_t i = 0; i + 2 < soma.size(); i += 3)
+    {
+        const double l = sqrt(soma[i] * soma[i] + soma[i + 1] * soma[i + 1] + soma[i + 2] * soma[i + 2]);
+        for (int e = 0; e < 3; ++e)
+            model->attrib.normals[i + e] = l > 0.0 ? (float)(soma[i + e] / l) : 0.0f;
+    }
+}
+
+// Maior ângulo, em graus, entre as normais de mesmo índice de dois modelos.
+// Uma normal que não é finita conta como 180 graus.
+static double MaiorDiferencaNormais(const ObjModel& a, const ObjModel& b)
+{
+    double maior = 0.0;
+    for (size_t i = 0; i + 2 < a.attrib.normals.size(); i += 3)
+    {
+        const float* na = &a.attrib.normals[i];
+        const float* nb = &b.attrib.normals[i];
+        double cosseno = (double)na[0] * nb[0] + (double)na[1] * nb[1] + (double)na[2] * nb[2];
+        if (!std::isfinite(cosseno))
+            return 180.0;
+        maior = std::max(maior, acos(std::min(std::max(cosseno, -1.0), 1.0)) * 180.0 / M_PI);
+    }
+    return maior;
+}
+
+static void ComparaNormais(const char* nome, const ObjModel& original, int repeticoes)
+{
+    size_t triangulos = 0;
+    for (size_t i = 0; i < original.shapes.size(); ++i)
+        triangulos += original.shapes[i].mesh.num_face_vertices.size();
+    printf("%s, %lu vertices, %lu triangulos, melhor de %d:\n", nome,
+           (unsigned long)(original.attrib.vertices.size() / 3), (unsigned long)triangulos, repeticoes);
+
+    ObjModel referencia, referencia_angulo, model;
+    double ms_escalar = MedeNormais(original, -1, PESO_AREA, repeticoes, &referencia);
+    printf("  %-26s %8.2f ms\n", "escalar (referencia)", ms_escalar);
+    NormaisAnguloEscalar(original, &referencia_angulo);
+
+    const int nucleos = std::max((int)std::thread::hardware_concurrency(), 1);
+    const int threads[2] = { 1, nucleos };
+    const PesoNormais pesos[2] = { PESO_AREA, PESO_ANGULO };
+    for (int p = 0; p < 2; ++p)
+        for (int i = 0; i < (nucleos > 1 ? 2 : 1); ++i)
+        {
+            double ms = MedeNormais(original, threads[i], pesos[p], repeticoes, &model);
+            char nome_medida[64];
+            snprintf(nome_medida, sizeof(nome_medida), "%s (%d thread%s)", pesos[p] == PESO_AREA ? "area" : "angulo",
+                     threads[i], threads[i] > 1 ? "s" : "");
+            printf("  %-26s %8.2f ms  %5.2fx", nome_medida, ms, ms_escalar / ms);
+            printf("  diferenca maxima %.2g graus\n",
+                   MaiorDiferencaNormais(pesos[p] == PESO_AREA ? referencia : referencia_angulo, model));
+        }
+}
+
+static int BenchmarkNormais(const char* arquivo, int repeticoes)
+{
+    ObjModel model;
+    std::string err;
+    if (!LeObjParalelo(&model.attrib, &model.shapes, &model.materials, &err, arquivo))
+    {
+        fprintf(stderr, "ERROR: Cannot read \"%s\".\n", arquivo);
+        return EXIT_FAILURE;
+    }
+    // As normais do arquivo são descartadas: queremos medir o cálculo
+    model.attrib.normals.clear();
+    for (size_t s = 0; s < model.shapes.size(); ++s)
+        for (size_t i = 0; i < model.shapes[s].mesh.indices.size(); ++i)
+            model.shapes[s].mesh.indices[i].normal_index = -1;
+
+    char nome[256];
+    snprintf(nome, sizeof(nome), "OBJ \"%s\"", arquivo);
+    ComparaNormais(nome, model, repeticoes);
+
+    // 708 x 708 vértices: 2 * 707 * 707 ~ 1 milhão de triângulos
+    const int lado = 708;
+    const int repeticoes_grade = std::max(repeticoes / 5, 1);
+    ObjModel grade;
+    GradeSintetica(lado, false, &grade);
+    ComparaNormais("Grade sintetica", grade, repeticoes_grade);
+    ObjModel embaralhada;
+    GradeSintetica(lado, true, &embaralhada);
+    ComparaNormais("Grade sintetica embaralhada", embaralhada, repeticoes_grade);
+    return 0;
+}
+
+// Entradas aleatórias das medições de matrizes: movimentos rígidos (giros em
+// torno de Y, como os de Carro, e em torno de eixos quaisquer), pontos e
+// matrizes homogêneas quaisquer
+struct EntradasMatrizes
+{
+    std::vector<TransformacaoRigida> rigidas, outras_rigidas;
+    std::vector<glm::mat4> matrizes_rigidas, outras_matrizes_rigidas;
+    std::vector<glm::mat4> matrizes, outras_matrizes;
+    std::vector<glm::vec4> pontos;
+    std::vector<float> cossenos, senos;
+};
+
+static float Aleatorio(unsigned int* estado, float minimo, float maximo)
+{
+    return minimo + (maximo - minimo) * (ProximoAleatorio(estado) & 0xffff) / 65535.0f;
+}
+
+static TransformacaoRigida RigidaAleatoria(unsigned int* estado)
+{
+    glm::vec4 eixo(Aleatorio(estado, -1, 1), Aleatorio(estado, -1, 1), Aleatorio(estado, -1, 1), 0.0f);
+    eixo.y += 2.0f; // Nunca nulo
+    glm::mat4 rotacao = Matrix_Rotate(Aleatorio(estado, -3.14f, 3.14f), eixo);
+    TransformacaoRigida r;
+    r.rotacao = glm::mat3(rotacao);
+    r.translacao = glm::vec3(Aleatorio(estado, -50, 50), Aleatorio(estado, -1, 1), Aleatorio(estado, -50, 50));
+    return r;
+}
+
+static void GeraEntradasMatrizes(size_t n, EntradasMatrizes* e)
+{
+    unsigned int estado = 4242;
+    for (size_t i = 0; i < n; ++i)
+    {
+        e->rigidas.push_back(RigidaAleatoria(&estado));
+        e->outras_rigidas.push_back(RigidaAleatoria(&estado));
+        e->matrizes_rigidas.push_back(Rigida_Matriz(e->rigidas.back()));
+        e->outras_matrizes_rigidas.push_back(Rigida_Matriz(e->outras_rigidas.back()));
+
+        glm::mat4 m, o;
+        for (int k = 0; k < 16; ++k)
+        {
+            m[k / 4][k % 4] = Aleatorio(&estado, -2, 2);
+            o[k / 4][k % 4] = Aleatorio(&estado, -2, 2);
+        }
+        e->matrizes.push_back(m);
+        e->outras_matrizes.push_back(o);
+
+        e->pontos.push_back(glm::vec4(Aleatorio(&estado, -10, 10), Aleatorio(&estado, -10, 10),
+                                      Aleatorio(&estado, -10, 10), 1.0f));
+        const float angulo = Aleatorio(&estado, -0.3f, 0.3f);
+        e->cossenos.push_back(cosf(angulo));
+        e->senos.push_back(sinf(angulo));
+    }
+}
+
+// Tempo por operação, em nanossegundos, do melhor de "repeticoes" passadas
+// de "calcula" sobre as n entradas
+template <typename Funcao>
+static double MedeOperacao(size_t n, int repeticoes, Funcao calcula)
+{
+    double melhor = 0.0;
+    for (int r = 0; r < repeticoes; ++r)
+    {
+        std::chrono::steady_clock::time_point inicio = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < n; ++i)
+            calcula(i);
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - inicio).count() / n;
+        melhor = r == 0 ? ns : std::min(melhor, ns);
+    }
+    return melhor;
+}
+
+static double MaiorDiferenca(const std::vector<glm::mat4>& a, const std::vector<glm::mat4>& b)
+{
+    double maior = 0.0;
+    for (size_t i = 0; i < a.size(); ++i)
+        for (int k = 0; k < 16; ++k)
+            maior = std::max(maior, (double)fabsf(a[i][k / 4][k % 4] - b[i][k / 4][k % 4]));
+    return maior;
+}
+
+static double MaiorDiferenca(const std::vector<glm::vec4>& a, const std::vector<glm::vec4>& b)
+{
+    double maior = 0.0;
+    for (size_t i = 0; i < a.size(); ++i)
+        for (int k = 0; k < 4; ++k)
+            maior = std::max(maior, (double)fabsf(a[i][k] - b[i][k]));
+    return maior;
+}
+
+static void ImprimeOperacao(const char* nome, double ns_glm, double ns, double diferenca)
+{
+    printf("  %-32s %7.2f ns  %7.2f ns  %5.2fx  diferenca maxima %.2g\n", nome, ns_glm, ns, ns_glm / ns, diferenca);
+}
+
+static int BenchmarkMatrizes(int repeticoes)
+{
+    const size_t n = 4096;
+    EntradasMatrizes e;
+    GeraEntradasMatrizes(n, &e);
+    std::vector<glm::mat4> referencia(n), resultado(n);
+    std::vector<glm::vec4> pontos_referencia(n), pontos(n);
+    std::vector<TransformacaoRigida> rigidas(n);
+
+#if defined(MATRICES_AVX)
+    const char* nucleo = "AVX";
+#elif defined(MATRICES_SSE2)
+    const char* nucleo = "SSE2";
+#else
+    const char* nucleo = "escalar";
+#endif
+    printf("Matrizes (%s), %lu entradas, melhor de %d:\n", nucleo, (unsigned long)n, repeticoes);
+    printf("  %-32s %10s  %10s\n", "", "glm::mat4", "novo");
+
+    double ns_glm = MedeOperacao(n, repeticoes, [&](size_t i) { referencia[i] = e.matrizes[i] * e.outras_matrizes[i]; });
+    double ns = MedeOperacao(n, repeticoes, [&](size_t i) { resultado[i] = Matrix_Multiply(e.matrizes[i], e.outras_matrizes[i]); });
+    ImprimeOperacao("Matrix_Multiply", ns_glm, ns, MaiorDiferenca(referencia, resultado));
+
+    ns_glm = MedeOperacao(n, repeticoes, [&](size_t i) { pontos_referencia[i] = e.matrizes[i] * e.pontos[i]; });
+    ns = MedeOperacao(n, repeticoes, [&](size_t i) { pontos[i] = Matrix_Multiply_Vector(e.matrizes[i], e.pontos[i]); });
+    ImprimeOperacao("Matrix_Multiply_Vector", ns_glm, ns, MaiorDiferenca(pontos_referencia, pontos));
+
+    ns_glm = MedeOperacao(n, repeticoes, [&](size_t i) { referencia[i] = e.matrizes_rigidas[i] * e.outras_matrizes_rigidas[i]; });
+    ns = MedeOperacao(n, repeticoes, [&](size_t i) { rigidas[i] = Rigida_Compoe(e.rigidas[i], e.outras_rigidas[i]); });
+    for (size_t i = 0; i < n; ++i)
+        resultado[i] = Rigida_Matriz(rigidas[i]);
+    ImprimeOperacao("Rigida_Compoe", ns_glm, ns, MaiorDiferenca(referencia, resultado));
+
+    ns_glm = MedeOperacao(n, repeticoes, [&](size_t i) { referencia[i] = glm::inverse(e.matrizes_rigidas[i]); });
+    ns = MedeOperacao(n, repeticoes, [&](size_t i) { rigidas[i] = Rigida_Inversa(e.rigidas[i]); });
+    for (size_t i = 0; i < n; ++i)
+        resultado[i] = Rigida_Matriz(rigidas[i]);
+    ImprimeOperacao("Rigida_Inversa (glm::inverse)", ns_glm, ns, MaiorDiferenca(referencia, resultado));
+
+    ns_glm = MedeOperacao(n, repeticoes, [&](size_t i) { pontos_referencia[i] = e.matrizes_rigidas[i] * e.pontos[i]; });
+    ns = MedeOperacao(n, repeticoes, [&](size_t i) {
+        pontos[i] = glm::vec4(Rigida_AplicaPonto(e.rigidas[i], glm::vec3(e.pontos[i])), 1.0f);
+    });
+    ImprimeOperacao("Rigida_AplicaPonto", ns_glm, ns, MaiorDiferenca(pontos_referencia, pontos));
+
+    // O giro de Carro::turnLeft() antes desta mudança: três produtos de
+    // glm::mat4 por giro em torno da posição do carro
+    ns_glm = MedeOperacao(n, repeticoes, [&](size_t i) {
+        const float c = e.cossenos[i], s = e.senos[i];
+        const glm::vec4 p = e.pontos[i];
+        glm::mat4 rotacao(c, 0, -s, 0,  0, 1, 0, 0,  s, 0, c, 0,  0, 0, 0, 1);
+        glm::mat4 ida(1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  -p.x, -p.y, -p.z, 1);
+        glm::mat4 volta(1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  p.x, p.y, p.z, 1);
+        referencia[i] = volta * rotacao * ida * e.matrizes_rigidas[i];
+    });
+    ns = MedeOperacao(n, repeticoes, [&](size_t i) {
+        rigidas[i] = Rigida_GiraYEmTorno(e.rigidas[i], e.cossenos[i], e.senos[i], glm::vec3(e.pontos[i]));
+    });
+    for (size_t i = 0; i < n; ++i)
+        resultado[i] = Rigida_Matriz(rigidas[i]);
+    ImprimeOperacao("Rigida_GiraYEmTorno (Carro)", ns_glm, ns, MaiorDiferenca(referencia, resultado));
+
+    // CarFleet::calculaMatrizes(): T(posicao) * Ry * B * S, antes com um
+    // produto de glm::mat4 por carro
+    const glm::mat4 escala = Matrix_Scale(0.5f, 0.5f, 0.5f);
+    ns_glm = MedeOperacao(n, repeticoes, [&](size_t i) {
+        const float c = e.cossenos[i], s = e.senos[i];
+        const glm::vec4 p = e.pontos[i];
+        glm::mat4 movimento(c, 0, -s, 0,  0, 1, 0, 0,  s, 0, c, 0,  p.x, p.y, p.z, 1);
+        referencia[i] = movimento * (e.matrizes_rigidas[0] * escala);
+    });
+    ns = MedeOperacao(n, repeticoes, [&](size_t i) {
+        Rigida_EscreveMatrizGiradaY(e.rigidas[0], e.cossenos[i], e.senos[i], glm::vec3(e.pontos[i]), 0.5f, &resultado[i]);
+    });
+    ImprimeOperacao("Rigida_EscreveMatrizGiradaY", ns_glm, ns, MaiorDiferenca(referencia, resultado));
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc >= 2 && strcmp(argv[1], "obj") == 0)
+    {
+        const char* arquivo_obj = argc > 2 ? argv[2] : "utilities/cow.obj";
+        int repeticoes = argc > 3 ? atoi(argv[3]) : 10;
+        return BenchmarkObj(arquivo_obj, std::max(repeticoes, 1));
+    }
+
+    if (argc >= 2 && strcmp(argv[1], "normais") == 0)
+    {
+        const char* arquivo_obj = argc > 2 ? argv[2] : "utilities/cow.obj";
+        int repeticoes = argc > 3 ? atoi(argv[3]) : 10;
+        return BenchmarkNormais(arquivo_obj, std::max(repeticoes, 1));
+    }
+
+    if (argc >= 2 && strcmp(argv[1], "matrizes") == 0)
+    {
+        int repeticoes = argc > 2 ? atoi(argv[2]) : 200;
+        return BenchmarkMatrizes(std::max(repeticoes, 1));
+    }
+
+    if (argc < 2 || strcmp(argv[1], "colisao") != 0)
+    {
+        fprintf(stderr, "Uso: %s colisao [arquivo_da_pista] [consultas]\n", argv[0]);
+        fprintf(stderr, "     %s obj [arquivo_obj] [repeticoes]\n", argv[0]);
+        fprintf(stderr, "     %s normais [arquivo_obj] [repeticoes]\n", argv[0]);
+        fprintf(stderr, "     %s matrizes [repeticoes]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const char* arquivo_pista = argc > 2 ? argv[2] : "utilities/pista.txt";
+    size_t consultas = argc > 3 ? (size_t)strtoul(argv[3], NULL, 10) : 1000000;
+    return BenchmarkColisao(arquivo_pista, consultas);
+}
@@ -0,0 +1,90 @@
+// Converte modelos OBJ para o cache binário lido pelo Carregador do jogo
+// (Car.obj -> Car.malha), para que a primeira execução do jogo já
+// não precise interpretar os OBJ. O jogo também grava o cache sozinho quando
+// ele falta ou está desatualizado; esta ferramenta só adianta esse trabalho.
+//
+// Uso: converte_malha [-n] [-f] arquivo.obj [-n] [-f] arquivo.obj ...
+//
+// -n descarta as normais do OBJ seguinte e as recalcula, como BuildCar().
+// -f grava os vértices do OBJ seguinte em float (VerticeMalha, 40 bytes) em
+//    vez do formato compacto (VerticeCompacto, 20 bytes).
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "Malha.h"
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Uso: %s [-n] [-f] arquivo.obj [[-n] [-f] arquivo.obj ...]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    bool recalcula_normais = false;
+    FormatoVertice formato = VERTICE_COMPACTO;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-n") == 0)
+        {
+            recalcula_normais = true;
+            continue;
+        }
+        if (strcmp(argv[i], "-f") == 0)
+        {
+            formato = VERTICE_FLOAT;
+            continue;
+        }
+
+        const char* arquivo_obj = argv[i];
+        std::chrono::steady_clock::time_point inicio = std::chrono::steady_clock::now();
+
+        Malha malha;
+        RelatorioMalha relatorio;
+        try
+        {
+            ConverteObj(arquivo_obj, recalcula_normais, &malha, &relatorio);
+        }
+        catch (const std::exception& e)
+        {
+            fprintf(stderr, "ERROR: Cannot convert \"%s\": %s\n", arquivo_obj, e.what());
+            return EXIT_FAILURE;
+        }
+        double segundos = std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+
+        std::string destino = ArquivoMalha::CaminhoCache(arquivo_obj);
+        if (!ArquivoMalha::Salva(destino.c_str(), arquivo_obj, recalcula_normais, malha, formato))
+            return EXIT_FAILURE;
+
+        // Confere que o cache gravado é aceito e mede quanto custa abri-lo
+        ArquivoMalha cache;
+        inicio = std::chrono::steady_clock::now();
+        if (!cache.abre(destino.c_str(), arquivo_obj, recalcula_normais, formato))
+        {
+            fprintf(stderr, "ERROR: Mesh cache \"%s\" was not accepted after writing.\n", destino.c_str());
+            return EXIT_FAILURE;
+        }
+        double segundos_cache = std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+
+        printf("Malha de \"%s\" gravada em \"%s\": %u vertices de %u bytes, %u indices de %u bytes "
+               "(OBJ: %.1f ms, cache: %.3f ms).\n",
+               arquivo_obj, destino.c_str(), cache.numeroDeVertices(), (unsigned int)BytesPorVertice(cache.formato()),
+               cache.numeroDeIndices(), cache.bytesPorIndice(), 1000.0 * segundos, 1000.0 * segundos_cache);
+        printf("  soldagem: %u -> %u vertices; ACMR (cache FIFO de %d): %.3f -> %.3f soldado -> %.3f reordenado.\n",
+               (unsigned int)relatorio.vertices_antes, (unsigned int)relatorio.vertices_depois, TAMANHO_CACHE_VERTICES,
+               relatorio.acmr_antes, relatorio.acmr_soldado, relatorio.acmr_depois);
+        printf("  niveis de detalhe:");
+        for (uint32_t nivel = 0; nivel < cache.numeroDeNiveis(); ++nivel)
+            printf(" %u", cache.getNivel(nivel).num_indices / 3);
+        printf(" triangulos.\n");
+
+        recalcula_normais = false;
+        formato = VERTICE_COMPACTO;
+    }
+
+    return 0;
+}
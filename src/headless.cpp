@@ -0,0 +1,173 @@
+// Executa a simulação da corrida sem janela e sem contexto OpenGL. Serve para
+// medir o desempenho da lógica do carro e para deixá-la rodando por milhões de
+// passos ("soak test") em máquinas sem monitor.
+//
+// Uso: headless [passos] [semente] [carros] [arquivo da pista]
+//
+// Com carros > 0, em vez do carro do jogador é simulada uma frota (CarFleet)
+// com esse número de carros, cada um com seu próprio piloto automático. A
+// pista padrão é utilities/pista.txt, relativa ao diretório atual.
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "Simulation.h"
+#include "CarFleet.h"
+
+// Gerador pseudo-aleatório linear congruente. Não usamos rand() para que o
+// resultado seja idêntico em qualquer plataforma com a mesma semente.
+static unsigned int ProximoAleatorio(unsigned int* estado)
+{
+    *estado = *estado * 1664525u + 1013904223u;
+    return *estado >> 16;
+}
+
+static int SimulaFrota(const Pista& pista, unsigned long total, unsigned int semente, size_t carros)
+{
+    CarFleet frota;
+    frota.setPista(&pista);
+
+    // Grade de 8x4 carros a partir da largada, enfileirados no sentido da pista
+    const float angulo = pista.getLargadaAngulo();
+    const float sx = sinf(angulo), sz = cosf(angulo);
+    for (size_t i = 0; i < carros; ++i)
+    {
+        const float adiante = 0.5f * (i % 8);
+        const float lado = 0.5f * ((i / 8) % 4) - 0.75f;
+        frota.adiciona(pista.getLargadaX() + adiante * sx + lado * sz,
+                       pista.getLargadaZ() + adiante * sz - lado * sx, angulo);
+    }
+
+    std::vector<uint8_t> entradas(carros, ENTRADA_ACELERAR);
+    unsigned int estado = semente;
+
+    std::chrono::steady_clock::time_point inicio = std::chrono::steady_clock::now();
+
+    for (unsigned long i = 0; i < total; ++i)
+    {
+        // Cada carro sorteia nova entrada a cada meio segundo de jogo, mas
+        // não todos no mesmo passo.
+        for (size_t c = i % 15; c < carros; c += 15)
+        {
+            static const uint8_t opcoes[4] = {
+                ENTRADA_ACELERAR,
+                ENTRADA_ACELERAR | ENTRADA_ESQUERDA,
+                ENTRADA_ACELERAR | ENTRADA_DIREITA,
+                ENTRADA_RE
+            };
+            entradas[c] = opcoes[ProximoAleatorio(&estado) % 4];
+        }
+
+        frota.step((float)Simulation::DURACAO_PASSO, entradas.data());
+    }
+
+    std::chrono::steady_clock::time_point fim = std::chrono::steady_clock::now();
+    double segundos = std::chrono::duration<double>(fim - inicio).count();
+
+    double soma_posicoes = 0.0;
+    for (size_t c = 0; c < carros; ++c)
+        soma_posicoes += frota.getX()[c] + frota.getZ()[c];
+
+    printf("Passos executados: %lu com %lu carros (%.1f s de jogo)\n", total, (unsigned long)carros, total * Simulation::DURACAO_PASSO);
+    printf("Tempo real: %.3f s (%.0f passos/s, %.0f carros*passos/s)\n", segundos,
+           segundos > 0.0 ? total / segundos : 0.0, segundos > 0.0 ? total * (double)carros / segundos : 0.0);
+    printf("Checksum das posicoes: %.6f\n", soma_posicoes);
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    unsigned long total = 1000000;
+    unsigned int semente = 1;
+    size_t carros = 0;
+    const char* arquivo_pista = "utilities/pista.txt";
+
+    if (argc > 1)
+        total = strtoul(argv[1], NULL, 10);
+    if (argc > 2)
+        semente = (unsigned int)strtoul(argv[2], NULL, 10);
+    if (argc > 3)
+        carros = (size_t)strtoul(argv[3], NULL, 10);
+    if (argc > 4)
+        arquivo_pista = argv[4];
+
+    Pista pista;
+    if (!pista.carrega(arquivo_pista))
+        return EXIT_FAILURE;
+    printf("Pista: %s (%s)\n", arquivo_pista, pista.ehRetangular() ? "retangular, teste vetorizado"
+                                             : pista.temSdf() ? "campo de distancia" : "grade uniforme");
+
+    if (carros > 0)
+        return SimulaFrota(pista, total, semente, carros);
+
+    Simulation simulacao;
+    simulacao.setPista(&pista);
+
+    unsigned int estado = semente;
+    unsigned long corridas = 0;
+    unsigned long vitorias = 0;
+    unsigned long tempos_errados = 0;
+    unsigned long passos_na_corrida = 0;
+    double soma_posicoes = 0.0;
+
+    // Piloto automático: acelera quase sempre e, a cada meio segundo de jogo,
+    // sorteia se vai virar para algum dos lados.
+    simulacao.enfileira(ACAO_ACELERAR, true);
+
+    std::chrono::steady_clock::time_point inicio = std::chrono::steady_clock::now();
+
+    for (unsigned long i = 0; i < total; ++i)
+    {
+        if (i % (Simulation::PASSOS_POR_SEGUNDO / 2) == 0)
+        {
+            unsigned int sorteio = ProximoAleatorio(&estado) % 4;
+            simulacao.enfileira(ACAO_ESQUERDA, sorteio == 1);
+            simulacao.enfileira(ACAO_DIREITA, sorteio == 2);
+            simulacao.enfileira(ACAO_RE, sorteio == 3);
+        }
+
+        simulacao.executaPassos(1);
+        passos_na_corrida++;
+
+        glm::vec4 p = simulacao.getCarro().getPosition();
+        soma_posicoes += p.x + p.z;
+
+        if (simulacao.terminou())
+        {
+            // O tempo final de uma corrida, vencida ou encerrada pelo limite,
+            // é o número de passos dela vezes a duração do passo
+            const double esperado = passos_na_corrida * Simulation::DURACAO_PASSO;
+            if (!(simulacao.tempoDeCorrida() > 0.0) || fabs(simulacao.tempoDeCorrida() - esperado) > 1e-9)
+            {
+                if (tempos_errados == 0)
+                    fprintf(stderr, "ERRO: corrida de %lu passos terminou com tempo %f (esperado %f)\n",
+                            passos_na_corrida, simulacao.tempoDeCorrida(), esperado);
+                tempos_errados++;
+            }
+            passos_na_corrida = 0;
+            corridas++;
+            if (simulacao.venceu())
+                vitorias++;
+            simulacao.reinicia();
+            simulacao.enfileira(ACAO_ACELERAR, true);
+        }
+    }
+
+    std::chrono::steady_clock::time_point fim = std::chrono::steady_clock::now();
+    double segundos = std::chrono::duration<double>(fim - inicio).count();
+
+    printf("Passos executados: %lu (%.1f s de jogo)\n", total, total * Simulation::DURACAO_PASSO);
+    printf("Tempo real: %.3f s (%.0f passos/s)\n", segundos, segundos > 0.0 ? total / segundos : 0.0);
+    printf("Corridas: %lu, vitorias: %lu\n", corridas, vitorias);
+    printf("Checksum das posicoes: %.6f\n", soma_posicoes);
+
+    if (tempos_errados > 0)
+    {
+        fprintf(stderr, "ERRO: %lu corridas com tempo final errado\n", tempos_errados);
+        return EXIT_FAILURE;
+    }
+    return 0;
+}
@@ -1,11 +1,9 @@
+#include <algorithm>
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
-#include <map>
 #include <string>
 #include <limits>
-#include <fstream>
-#include <sstream>
 #include <glad/glad.h>   // Criação de contexto OpenGL 3.3
 #include <GLFW/glfw3.h>  // Criação de janelas do sistema operacional
 #include <glm/mat4x4.hpp>
@@ -15,49 +13,31 @@
 #include "matrices.h"
 #include <iostream>
 #include <vector>
-#include "Carro.h"
-#include <tiny_obj_loader.h>
-#include <stb_image.h>
-#include <time.h>
+#include "Simulation.h"
+#include "Pista.h"
+#include "CarFleet.h"
+#include "Instancias.h"
+#include "Malha.h"
+#include "Profiler.h"
+#include "TextMesh.h"
+#include "UniformesCamera.h"
+#include "CenaVirtual.h"
+#include "FilaRender.h"
+#include "CacheProgramas.h"
+#include "RecargaShaders.h"
+#include "Carregador.h"
 
 using namespace std;
 
-struct ObjModel
-{
-    tinyobj::attrib_t                 attrib;
-    std::vector<tinyobj::shape_t>     shapes;
-    std::vector<tinyobj::material_t>  materials;
-
-    // Este construtor lê o modelo de um arquivo utilizando a biblioteca tinyobjloader.
-    // Veja: https://github.com/syoyo/tinyobjloader
-    ObjModel(const char* filename, const char* basepath = NULL, bool triangulate = true)
-    {
-        printf("Carregando modelo \"%s\"... ", filename);
-
-        std::string err;
-        bool ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &err, filename, basepath, triangulate);
-
-        if (!err.empty())
-            fprintf(stderr, "\n%s\n", err.c_str());
-
-        if (!ret)
-            throw std::runtime_error("Erro ao carregar modelo.");
-
-        printf("OK.\n");
-    }
-};
-
-GLuint BuildCubo(); // Constrói triângulos para renderização
-GLuint BuildCar(); // Constrói triângulos para renderização
-GLuint BuildChao(); // Constrói triângulos para renderização
-GLuint BuildPista(); // Constrói triângulos para renderização
-GLuint BuildCow(); // Constrói triângulos para renderização
-GLuint LoadShader_Vertex(const char* filename);   // Carrega um vertex shader
-GLuint LoadShader_Fragment(const char* filename); // Carrega um fragment shader
-void LoadShader(const char* filename, GLuint shader_id); // Função utilizada pelas duas acima
-GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id); // Cria um programa de GPU
+IdObjeto BuildCubo(); // Constrói triângulos para renderização
+IdObjeto BuildCar(); // Constrói triângulos para renderização
+IdObjeto BuildChao(); // Constrói triângulos para renderização
+IdObjeto BuildPista(const Pista& pista); // Constrói triângulos para renderização
+IdObjeto BuildCow(); // Constrói triângulos para renderização
+void ConfiguraPrograma(GLuint program_id, UniformesCamera* uniformes_camera); // Uniforms fixos do programa principal
 
 void TextRendering_Init();
+void TextRendering_Flush();
 float TextRendering_LineHeight(GLFWwindow* window);
 float TextRendering_CharWidth(GLFWwindow* window);
 void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float x, float y, float scale = 1.0f);
@@ -70,6 +50,7 @@ void TextRendering_ShowModelViewProjection(GLFWwindow* window, glm::mat4 project
 void TextRendering_ShowEulerAngles(GLFWwindow* window);
 void TextRendering_ShowProjection(GLFWwindow* window);
 void TextRendering_ShowFramesPerSecond(GLFWwindow* window);
+void TextRendering_ShowProfiler(GLFWwindow* window);
 
 void FramebufferSizeCallback(GLFWwindow* window, int width, int height);
 void ErrorCallback(int error, const char* description);
@@ -78,15 +59,13 @@ void MouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
 void CursorPosCallback(GLFWwindow* window, double xpos, double ypos);
 void ScrollCallback(GLFWwindow* window, double xoffset, double yoffset);
 
-struct SceneObject
-{
-    const char*  name;        // Nome do objeto
-    void*        first_index; // Índice do primeiro vértice dentro do vetor indices[] definido em BuildTriangles()
-    int          num_indices; // Número de índices do objeto dentro do vetor indices[] definido em BuildTriangles()
-    GLenum       rendering_mode; // Modo de rasterização (GL_TRIANGLES, GL_TRIANGLE_STRIP, etc.)
-};
+// Objetos da cena (ver SceneObject e CenaVirtual em "CenaVirtual.h"). Cada
+// função Build*() devolve o IdObjeto do que construiu; o laço de
+// renderização só usa esses IdObjeto.
+CenaVirtual g_VirtualScene;
 
-std::map<const char*, SceneObject> g_VirtualScene;
+// Fila de desenho dos objetos da cena; ver FilaRender em "FilaRender.h"
+FilaRender g_FilaRender;
 
 float g_ScreenRatio = 1.0f;
 
@@ -110,59 +89,55 @@ glm::vec4 camera_view_vector; // Vetor "view", sentido para onde a câmera está
 glm::vec4 camera_up_vector; // Vetor "up" fixado para apontar para o "céu" (eito Y global)
 
 bool g_ShowInfoText = true;
+bool g_ShowProfiler = false; // Tecla P: tempos do quadro na tela (ver Profiler.h)
 
-Carro car;
+Pista g_Pista;
+Simulation g_Simulacao;
 
-void LoadTextureImage(const char* filename)
+// Textos fixos do HUD, cada um diagramado em um VBO próprio (ver TextMesh).
+// Ficam aqui, e não em estáticas das funções que os desenham, para que main()
+// os libere enquanto o contexto OpenGL ainda existe.
+struct TextosFixos
 {
-    printf("Carregando imagem \"%s\"... ", filename);
+    TextMesh titulo_model, titulo_view, titulo_projection;
+    TextMesh nome_projecao;
+    TextMesh nomes_profiler;
 
-    // Primeiro fazemos a leitura da imagem do disco
-    stbi_set_flip_vertically_on_load(true);
-    int width;
-    int height;
-    int channels;
-    unsigned char *data = stbi_load(filename, &width, &height, &channels, 3);
-
-    if ( data == NULL )
+    void libera()
     {
-        fprintf(stderr, "ERROR: Cannot open image file \"%s\".\n", filename);
-        std::exit(EXIT_FAILURE);
+        titulo_model.libera();
+        titulo_view.libera();
+        titulo_projection.libera();
+        nome_projecao.libera();
+        nomes_profiler.libera();
     }
-
-    printf("OK (%dx%d).\n", width, height);
-
-    // Agora criamos objetos na GPU com OpenGL para armazenar a textura
-    GLuint texture_id;
-    GLuint sampler_id;
-    glGenTextures(1, &texture_id);
-    glGenSamplers(1, &sampler_id);
-
-    // Veja slide 160 do documento "Aula_20_e_21_Mapeamento_de_Texturas.pdf"
-    glSamplerParameteri(sampler_id, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glSamplerParameteri(sampler_id, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-    // Parâmetros de amostragem da textura. Falaremos sobre eles em uma próxima aula.
-    glSamplerParameteri(sampler_id, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glSamplerParameteri(sampler_id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    // Agora enviamos a imagem lida do disco para a GPU
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
-    glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
-    glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
-
-    GLuint textureunit = 0;
-    glActiveTexture(GL_TEXTURE0 + textureunit);
-    glBindTexture(GL_TEXTURE_2D, texture_id);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    glBindSampler(textureunit, sampler_id);
-
-    stbi_image_free(data);
-}
-
-int main()
+};
+static TextosFixos g_TextosFixos;
+
+// Tempo de cada quadro gasto enviando à GPU o que o Carregador já leu
+static const double ORCAMENTO_CARREGAMENTO_MS = 2.0;
+
+// Matrizes que não dependem de nada em tempo de execução, calculadas pelo
+// compilador (ver Matriz4 em matrices.h)
+static constexpr Matriz4 MODEL_CHAO = Matrix_Translate(0,0,5);
+static constexpr Matriz4 MODEL_PISTA = Matrix_Identity(); // O asfalto já é gerado em coordenadas do mundo (ver BuildPista)
+
+// Projeção perspectiva: near, far e campo de visão (60 graus) são fixos, então
+// só o elemento (0,0), que divide pela razão de aspecto da janela, é calculado
+// a cada quadro. 0.57735014f é tanf(field_of_view / 2) para
+// field_of_view = 3.141592 / 3.0f.
+static constexpr float NEAR_PLANE = -0.1f;  // Posição do "near plane"
+static constexpr float FAR_PLANE  = -40.0f; // Posição do "far plane"
+static constexpr float TANGENTE_MEIO_FOV = 0.57735014f;
+static constexpr Matriz4 PROJECAO_ASPECTO_1 = Matrix_Perspective_Tangente(TANGENTE_MEIO_FOV, 1.0f, NEAR_PLANE, FAR_PLANE);
+static_assert(PROJECAO_ASPECTO_1(3,2) == -1.0f && PROJECAO_ASPECTO_1(0,0) == PROJECAO_ASPECTO_1(1,1),
+              "com aspecto 1 a projeção é simétrica em X e Y, e w = -z");
+
+// Uso: main [carros]
+//
+// Com carros > 0, além do jogador correm essa quantidade de carros de uma
+// frota (CarFleet) com piloto automático, desenhados por instanciamento.
+int main(int argc, char* argv[])
 {
     int success = glfwInit();
     if (!success)
@@ -209,29 +184,123 @@ int main()
 
     printf("GPU: %s, %s, OpenGL %s, GLSL %s\n", vendor, renderer, glversion, glslversion);
 
-    GLuint vertex_shader_id = LoadShader_Vertex("../../src/shader_vertex.glsl");
-    GLuint fragment_shader_id = LoadShader_Fragment("../../src/shader_fragment.glsl");
+    g_Profiler.inicializaGpu();
+
+    // Imagens e malhas são lidas por threads de trabalho e enviadas aos
+    // poucos, a cada quadro; até lá a cena desenha substitutos cinzas
+    g_Carregador.inicializa(&g_VirtualScene);
+    g_Carregador.carregaTextura("../../utilities/490.jpg", 0);
+    const IdObjeto id_carro = BuildCar();
+    const IdObjeto id_vaca  = BuildCow();
+
+    // Os programas linkados ficam em bin/Linux (ou bin/macOS): na segunda
+    // execução o GLSL não é compilado de novo
+    const char* arquivo_vertex = "../../src/shader_vertex.glsl";
+    const char* arquivo_fragment = "../../src/shader_fragment.glsl";
+    g_CacheProgramas.inicializa(".");
+    GLuint program_id = g_CacheProgramas.criaDeArquivos("principal", arquivo_vertex, arquivo_fragment);
+
+    // Editar um dos arquivos GLSL recompila o programa com o jogo rodando
+    RecargaShaders recarga_shaders;
+    recarga_shaders.vigia("principal", arquivo_vertex, arquivo_fragment);
+
+    // View, projection e posição da câmera vão para os shaders por um UBO
+    // atualizado uma vez por quadro
+    UniformesCamera uniformes_camera;
+    uniformes_camera.inicializa();
+
+    // Colisão, voltas e malhas da pista saem todas deste arquivo
+    if (!g_Pista.carrega("../../utilities/pista.txt"))
+        std::exit(EXIT_FAILURE);
+    g_Simulacao.setPista(&g_Pista);
+
+    const IdObjeto id_chao  = BuildChao();
+    const IdObjeto id_pista = BuildPista(g_Pista);
+    const IdObjeto id_cubo  = BuildCubo();
+
+    // Todas as cópias do carro e da vaca são desenhadas por instanciamento:
+    // um glDrawElementsInstanced() por modelo e nível de detalhe, em vez de
+    // um glDrawElements() e um glUniformMatrix4fv() por cópia.
+    LoteInstancias lotes_carros[MAXIMO_NIVEIS_OBJETO];
+    LoteInstancias lotes_vacas[MAXIMO_NIVEIS_OBJETO];
+    // Carros (rígidos) e vacas (escala uniforme) só têm semelhanças: a matriz
+    // das normais é a parte 3x3 de "model", sem inversa
+    for (int nivel = 0; nivel < g_VirtualScene[id_carro].num_niveis; ++nivel)
+        lotes_carros[nivel].inicializa(g_VirtualScene[g_VirtualScene[id_carro].niveis[nivel]].vertex_array_object_id, true);
+    for (int nivel = 0; nivel < g_VirtualScene[id_vaca].num_niveis; ++nivel)
+        lotes_vacas[nivel].inicializa(g_VirtualScene[g_VirtualScene[id_vaca].niveis[nivel]].vertex_array_object_id, true);
+
+    // As vacas não se movem: as matrizes são calculadas uma vez só, e o lote
+    // é remontado a cada quadro só com as vacas visíveis
+    const std::vector<Vaca>& vacas = g_Pista.getVacas();
+    std::vector<glm::mat4> models_vacas(vacas.size());
+    std::vector<int> niveis_vacas(vacas.size(), 0); // Nível de detalhe do quadro anterior
+    for (size_t i = 0; i < vacas.size(); ++i)
+    {
+        models_vacas[i] = Matrix_Translate(vacas[i].x, 0.5f*vacas[i].escala, vacas[i].z)
+                          *Matrix_Rotate_Y(vacas[i].angulo)
+                          *Matrix_Scale(vacas[i].escala, vacas[i].escala, vacas[i].escala);
+    }
 
-    GLuint program_id = CreateGpuProgram(vertex_shader_id, fragment_shader_id);
+    // Frota de adversários, enfileirada a partir da largada como em headless.cpp
+    CarFleet frota;
+    frota.setPista(&g_Pista);
+    size_t numero_de_carros = argc > 1 ? (size_t)strtoul(argv[1], NULL, 10) : 0;
 
-    glUseProgram(program_id);
-    glUniform1i(glGetUniformLocation(program_id, "TextureImage0"), 0);
-    glUseProgram(0);
+    // Objetos além desta distância da câmera não são desenhados; 0 desenha
+    // tudo o que estiver no volume de visão
+    float distancia_maxima = argc > 2 ? (float)atof(argv[2]) : 0.0f;
+    {
+        const float angulo = g_Pista.getLargadaAngulo();
+        const float sx = sin(angulo), sz = cos(angulo);
+        for (size_t i = 0; i < numero_de_carros; ++i)
+        {
+            const float adiante = 0.5f * (i % 8) + 1.5f;
+            const float lado = 0.5f * ((i / 8) % 4) - 0.75f;
+            frota.adiciona(g_Pista.getLargadaX() + adiante * sx + lado * sz,
+                           g_Pista.getLargadaZ() + adiante * sz - lado * sx, angulo);
+        }
+    }
+    std::vector<uint8_t> entradas_frota(numero_de_carros, ENTRADA_ACELERAR);
+    std::vector<glm::mat4> matrizes_frota(numero_de_carros);
+    std::vector<int> niveis_carros(numero_de_carros + 1, 0); // O do jogador é o último
 
-    LoadTextureImage("../../utilities/490.jpg");
+    // Cores dos carros da frota; o carro do jogador é vermelho
+    const glm::vec4 cores_frota[] =
+    {
+        glm::vec4(0.1f, 0.3f, 1.0f, 1.0f),
+        glm::vec4(0.1f, 0.8f, 0.2f, 1.0f),
+        glm::vec4(1.0f, 0.8f, 0.1f, 1.0f),
+        glm::vec4(0.8f, 0.2f, 0.9f, 1.0f),
+        glm::vec4(0.1f, 0.8f, 0.9f, 1.0f),
+        glm::vec4(1.0f, 0.5f, 0.1f, 1.0f),
+        glm::vec4(0.9f, 0.9f, 0.9f, 1.0f),
+        glm::vec4(0.3f, 0.3f, 0.3f, 1.0f)
+    };
 
-    GLuint vertex_array_object_id = BuildCar();
-    GLuint vertex_array_object_id2 = BuildChao();
-    GLuint vertex_array_object_id3 = BuildPista();
-    GLuint vertex_array_object_id4 = BuildCubo();
-    GLuint vertex_array_object_id5 = BuildCow();
+    TextRendering_Init();
 
-    //TextRendering_Init();
+    // "model", "normal_matrix", "isGourard" e "usaInstancias" são definidos
+    // pela fila de desenho
+    g_FilaRender.registraPrograma(program_id);
+    ConfiguraPrograma(program_id, &uniformes_camera);
 
-    GLint model_uniform           = glGetUniformLocation(program_id, "model"); // Variável da matriz "model"
-    GLint view_uniform            = glGetUniformLocation(program_id, "view"); // Variável da matriz "view" em shader_vertex.glsl
-    GLint projection_uniform      = glGetUniformLocation(program_id, "projection"); // Variável da matriz "projection" em shader_vertex.glsl
-    GLint isGourard               = glGetUniformLocation(program_id, "isGourard");
+    // Os objetos fixos têm suas matrizes calculadas em tempo de compilação
+    const glm::mat4 model_chao = MODEL_CHAO;
+    const glm::mat4 model_pista = MODEL_PISTA;
+
+    // Paredes: um cubo escalado por bloco, todos gerados a partir da pista.
+    // A escala não é uniforme: a matriz das normais precisa da inversa transposta.
+    const std::vector<BlocoParede>& blocos = g_Pista.getBlocosParede();
+    std::vector<glm::mat4> models_paredes(blocos.size());
+    std::vector<glm::mat3> normais_paredes(blocos.size());
+    for (size_t i = 0; i < blocos.size(); ++i)
+    {
+        models_paredes[i] = Matrix_Translate(blocos[i].centro_x, 0.5f, blocos[i].centro_z)
+                            *Matrix_Rotate_Y(blocos[i].angulo)
+                            *Matrix_Scale(blocos[i].comprimento, 1, 1);
+        normais_paredes[i] = MatrizNormal(models_paredes[i], false);
+    }
 
     glEnable(GL_DEPTH_TEST);
 
@@ -251,264 +320,150 @@ int main()
 
 
 
-    clock_t inicio = clock();
-    bool venceu = false;
+    // O relógio de parede (glfwGetTime) só decide quantos passos fixos da
+    // simulação executar; o tempo da corrida é contado pela própria simulação.
+    double tempo_anterior = glfwGetTime();
 
-    while (!glfwWindowShouldClose(window) && !venceu)
+    while (!glfwWindowShouldClose(window) && !g_Simulacao.terminou())
     {
-        if(camera_lookat)
+        g_Profiler.iniciaQuadro();
+
+        // O programa antigo fica em uso até o novo terminar de compilar; se
+        // a compilação falha, ele continua
+        GLuint programa_recarregado = recarga_shaders.atualiza();
+        if (programa_recarregado != 0)
         {
-            camera_position_c = car.getCameraPosition();
-            camera_view_vector = car.getCameraView();
+            ConfiguraPrograma(programa_recarregado, &uniformes_camera);
+            g_FilaRender.substituiPrograma(program_id, programa_recarregado);
+            glDeleteProgram(program_id);
+            program_id = programa_recarregado;
         }
-        //           R     G     B     A
-        glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
-
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        glUseProgram(program_id);
-
-        glBindVertexArray(vertex_array_object_id);
-
-        glm::mat4 view = Matrix_Camera_View(camera_position_c, camera_view_vector, camera_up_vector);
-
-        glm::mat4 projection;
-
-        float nearplane = -0.1f;  // Posição do "near plane"
-        float farplane  = -40.0f; // Posição do "far plane"
-
-        float field_of_view = 3.141592 / 3.0f;
-        projection = Matrix_Perspective(field_of_view, g_ScreenRatio, nearplane, farplane);
-
-        glUniformMatrix4fv(view_uniform, 1, GL_FALSE, glm::value_ptr(view));
-        glUniformMatrix4fv(projection_uniform, 1, GL_FALSE, glm::value_ptr(projection));
-        glm::mat4 model;
-
-        model = car.getMatrix();
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-
-        glUniform1i(isGourard, 0);
-
-        glDrawElements(
-            g_VirtualScene["carro"].rendering_mode, // Veja slide 160 do documento "Aula_04_Modelagem_Geometrica_3D.pdf".
-            g_VirtualScene["carro"].num_indices,    //
-            GL_UNSIGNED_INT,
-            (void*)g_VirtualScene["carro"].first_index
-        );
-
-
-        glBindVertexArray(vertex_array_object_id2);
-
-        model = Matrix_Translate(0,0,5);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-
-        glUniform1i(isGourard, 0);
-
-        glDrawElements(
-            g_VirtualScene["chao"].rendering_mode, // Veja slide 160 do documento "Aula_04_Modelagem_Geometrica_3D.pdf".
-            g_VirtualScene["chao"].num_indices,    //
-            GL_UNSIGNED_INT,
-            (void*)g_VirtualScene["chao"].first_index
-        );
-
-        glBindVertexArray(vertex_array_object_id3);
-
-        projection = Matrix_Perspective(field_of_view, g_ScreenRatio, nearplane, farplane);
-
-        model = Matrix_Translate(0,0,5);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-
-        glDrawElements(
-            g_VirtualScene["pista"].rendering_mode, // Veja slide 160 do documento "Aula_04_Modelagem_Geometrica_3D.pdf".
-            g_VirtualScene["pista"].num_indices,    //
-            GL_UNSIGNED_INT,
-            (void*)g_VirtualScene["pista"].first_index
-        );
-
-        ///////////
-        glBindVertexArray(vertex_array_object_id4);
-
-        model = model
-                *Matrix_Translate(0,0.5,-9.5)
-                *Matrix_Scale(20,1,1);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-
-        glUniform1i(isGourard, 1);
-
-        glDrawElements(
-            g_VirtualScene["cubo"].rendering_mode, // Veja slide 160 do documento "Aula_04_Modelagem_Geometrica_3D.pdf".
-            g_VirtualScene["cubo"].num_indices,    //
-            GL_UNSIGNED_INT,
-            (void*)g_VirtualScene["cubo"].first_index
-        );
-
-        /////////////
-        glBindVertexArray(vertex_array_object_id4);
-
-        model = Matrix_Identity()
-                *Matrix_Translate(0,0.5,14.5)
-                *Matrix_Scale(20,1,1);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-
-        glUniform1i(isGourard, 1);
-
-        glDrawElements(
-            g_VirtualScene["cubo"].rendering_mode, // Veja slide 160 do documento "Aula_04_Modelagem_Geometrica_3D.pdf".
-            g_VirtualScene["cubo"].num_indices,    //
-            GL_UNSIGNED_INT,
-            (void*)g_VirtualScene["cubo"].first_index
-        );
-
-        /////////////
-        glBindVertexArray(vertex_array_object_id4);
-
-        model = Matrix_Identity()
-                *Matrix_Translate(-9.5,0.5,5)
-                *Matrix_Scale(1,1,18);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-
-        glUniform1i(isGourard, 1);
-
-        glDrawElements(
-            g_VirtualScene["cubo"].rendering_mode, // Veja slide 160 do documento "Aula_04_Modelagem_Geometrica_3D.pdf".
-            g_VirtualScene["cubo"].num_indices,    //
-            GL_UNSIGNED_INT,
-            (void*)g_VirtualScene["cubo"].first_index
-        );
-
-        /////////////
-
-        glBindVertexArray(vertex_array_object_id4);
-
-        model = Matrix_Identity()
-                *Matrix_Translate(+9.5,0.5,5)
-                *Matrix_Scale(1,1,18);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-
-        glUniform1i(isGourard, 1);
-
-        glDrawElements(
-            g_VirtualScene["cubo"].rendering_mode, // Veja slide 160 do documento "Aula_04_Modelagem_Geometrica_3D.pdf".
-            g_VirtualScene["cubo"].num_indices,    //
-            GL_UNSIGNED_INT,
-            (void*)g_VirtualScene["cubo"].first_index
-        );
-
-        /////////////
-        //Internas
-
-        glBindVertexArray(vertex_array_object_id4);
-
-        model = Matrix_Identity()
-                *Matrix_Translate(0,0.5,0.5)
-                *Matrix_Scale(10,1,1);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-
-        glUniform1i(isGourard, 1);
-
-        glDrawElements(
-            g_VirtualScene["cubo"].rendering_mode, // Veja slide 160 do documento "Aula_04_Modelagem_Geometrica_3D.pdf".
-            g_VirtualScene["cubo"].num_indices,    //
-            GL_UNSIGNED_INT,
-            (void*)g_VirtualScene["cubo"].first_index
-        );
-
-        /////////////
-
-        glBindVertexArray(vertex_array_object_id4);
-
-        model = Matrix_Identity()
-                *Matrix_Translate(0,0.5,9.5)
-                *Matrix_Scale(10,1,1);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-
-        glUniform1i(isGourard, 1);
-
-        glDrawElements(
-            g_VirtualScene["cubo"].rendering_mode, // Veja slide 160 do documento "Aula_04_Modelagem_Geometrica_3D.pdf".
-            g_VirtualScene["cubo"].num_indices,    //
-            GL_UNSIGNED_INT,
-            (void*)g_VirtualScene["cubo"].first_index
-        );
-
-        /////////////
-        glBindVertexArray(vertex_array_object_id4);
-
-        model = Matrix_Identity()
-                *Matrix_Translate(-4.5,0.5,5)
-                *Matrix_Scale(1,1,8);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-
-        glUniform1i(isGourard, 1);
 
-        glDrawElements(
-            g_VirtualScene["cubo"].rendering_mode, // Veja slide 160 do documento "Aula_04_Modelagem_Geometrica_3D.pdf".
-            g_VirtualScene["cubo"].num_indices,    //
-            GL_UNSIGNED_INT,
-            (void*)g_VirtualScene["cubo"].first_index
-        );
-
-        /////////////
-        glBindVertexArray(vertex_array_object_id4);
+        {
+            PROFILER_ESCOPO("Carregamento");
+            g_Carregador.envia(ORCAMENTO_CARREGAMENTO_MS);
+        }
 
-        model = Matrix_Identity()
-                *Matrix_Translate(4.5,0.5,5)
-                *Matrix_Scale(1,1,8);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
+        {
+            PROFILER_ESCOPO("Simulacao");
 
-        glUniform1i(isGourard, 1);
+            double tempo_atual = glfwGetTime();
+            int passos = g_Simulacao.avanca(tempo_atual - tempo_anterior);
+            tempo_anterior = tempo_atual;
 
-        glDrawElements(
-            g_VirtualScene["cubo"].rendering_mode, // Veja slide 160 do documento "Aula_04_Modelagem_Geometrica_3D.pdf".
-            g_VirtualScene["cubo"].num_indices,    //
-            GL_UNSIGNED_INT,
-            (void*)g_VirtualScene["cubo"].first_index
-        );
-        /////////////
-        //COW
-        glBindVertexArray(vertex_array_object_id5);
+            // A frota anda os mesmos passos fixos da simulação. O piloto
+            // automático sorteia uma nova entrada para cada carro de vez em quando.
+            for (int p = 0; p < passos && numero_de_carros > 0; ++p)
+            {
+                static const uint8_t opcoes[4] = {
+                    ENTRADA_ACELERAR,
+                    ENTRADA_ACELERAR | ENTRADA_ESQUERDA,
+                    ENTRADA_ACELERAR | ENTRADA_DIREITA,
+                    ENTRADA_RE
+                };
+                entradas_frota[rand() % numero_de_carros] = opcoes[rand() % 4];
+                frota.step((float)Simulation::DURACAO_PASSO, entradas_frota.data());
+            }
+        }
 
-        model = Matrix_Identity()
-                *Matrix_Translate(0,0.5,5);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
+        // Fração do próximo passo já decorrida, para interpolar o carro
+        float alpha = g_Simulacao.alpha();
 
-        glUniform1i(isGourard, 0);
+        if(camera_lookat)
+        {
+            camera_position_c = g_Simulacao.getCameraPositionInterpolada(alpha);
+            camera_view_vector = g_Simulacao.getCameraViewInterpolada(alpha);
+        }
+        //           R     G     B     A
+        glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
 
-        glDrawElements(
-            g_VirtualScene["cow"].rendering_mode, // Veja slide 160 do documento "Aula_04_Modelagem_Geometrica_3D.pdf".
-            g_VirtualScene["cow"].num_indices,    //
-            GL_UNSIGNED_INT,
-            (void*)g_VirtualScene["cow"].first_index
-        );
-        /////////////
+        {
+            PROFILER_ESCOPO_GPU("Limpa tela");
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        }
 
+        glm::mat4 view = Matrix_Camera_View(camera_position_c, camera_view_vector, camera_up_vector);
 
-        model = Matrix_Identity();
+        glm::mat4 projection = PROJECAO_ASPECTO_1;
+        projection[0][0] /= g_ScreenRatio;
 
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
+        uniformes_camera.atualiza(view, projection);
+        // Coleta: cada objeto vai para a fila, que ordena por estado na hora
+        // de desenhar
+        {
+            PROFILER_ESCOPO("Coleta");
+
+            int largura_tela, altura_tela;
+            glfwGetFramebufferSize(window, &largura_tela, &altura_tela);
+            g_FilaRender.limpa(camera_position_c, uniformes_camera.getBloco().view_projection, distancia_maxima);
+            g_FilaRender.defineTela(projection, altura_tela);
+
+            // Carros: o do jogador e os da frota, uma chamada por nível de
+            // detalhe. Cada cópia fora da tela fica fora dos lotes.
+            const SceneObject& carro = g_VirtualScene[id_carro];
+            for (int nivel = 0; nivel < carro.num_niveis; ++nivel)
+                lotes_carros[nivel].limpa();
+            g_FilaRender.adicionaInstancia(carro, g_Simulacao.getMatrixInterpolada(alpha), glm::vec4(1.0f, 0.0f, 0.0f, 1.0f),
+                                           lotes_carros, &niveis_carros[numero_de_carros]);
+            frota.calculaMatrizes(matrizes_frota.data());
+            for (size_t i = 0; i < numero_de_carros; ++i)
+                g_FilaRender.adicionaInstancia(carro, matrizes_frota[i], cores_frota[i % 8], lotes_carros, &niveis_carros[i]);
+            g_FilaRender.adicionaLotes(program_id, g_VirtualScene, carro, lotes_carros);
+
+            // Vacas, com as matrizes calculadas antes do laço
+            const SceneObject& vaca = g_VirtualScene[id_vaca];
+            for (int nivel = 0; nivel < vaca.num_niveis; ++nivel)
+                lotes_vacas[nivel].limpa();
+            for (size_t i = 0; i < models_vacas.size(); ++i)
+                g_FilaRender.adicionaInstancia(vaca, models_vacas[i], glm::vec4(1.0f, 0.0f, 0.0f, 1.0f), lotes_vacas, &niveis_vacas[i]);
+            g_FilaRender.adicionaLotes(program_id, g_VirtualScene, vaca, lotes_vacas);
+
+            g_FilaRender.adiciona(program_id, g_VirtualScene[id_chao], model_chao, MatrizNormal(model_chao, true));
+            g_FilaRender.adiciona(program_id, g_VirtualScene[id_pista], model_pista, MatrizNormal(model_pista, true));
+
+            const SceneObject& cubo = g_VirtualScene[id_cubo];
+            for (size_t i = 0; i < models_paredes.size(); ++i)
+                g_FilaRender.adiciona(program_id, cubo, models_paredes[i], normais_paredes[i]);
+        }
 
-        glBindVertexArray(0);
+        {
+            PROFILER_ESCOPO_GPU("Desenho");
+            g_FilaRender.envia();
+        }
 
         glm::vec4 p_model(0.5f, 0.5f, 0.5f, 1.0f);
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        {
+            PROFILER_ESCOPO_GPU("Texto");
+            TextRendering_ShowProfiler(window);
+            TextRendering_Flush();
+        }
 
-        clock_t now = clock();
+        {
+            PROFILER_ESCOPO("SwapBuffers");
+            glfwSwapBuffers(window);
+        }
 
-        if(car.cruzouChegada())
         {
-            clock_t fim = now;
-            printf("\n\n --------------------FIM---------------------\n Voce terminou a corrida em %1f segundos.\n", ( (double) (fim - inicio) ) / CLOCKS_PER_SEC);
-            venceu = true;
-        }else if(((double) (now - inicio) ) / CLOCKS_PER_SEC > 35){
-            printf("\n\n --------------------FIM---------------------\n Voce perdeu a corrida\n", ( (double) (now - inicio) ) / CLOCKS_PER_SEC);
-            venceu = true;
+            PROFILER_ESCOPO("Entrada");
+            glfwPollEvents();
         }
 
+        g_Profiler.terminaQuadro();
+    }
 
+    if (g_Profiler.capturando())
+        g_Profiler.terminaCaptura("trace.json");
+
+    if(g_Simulacao.venceu())
+    {
+        printf("\n\n --------------------FIM---------------------\n Voce terminou a corrida em %1f segundos.\n", g_Simulacao.tempoDeCorrida());
+    }else if(g_Simulacao.terminou()){
+        printf("\n\n --------------------FIM---------------------\n Voce perdeu a corrida\n");
     }
 
+    g_Carregador.encerra();
+    g_TextosFixos.libera();
     glfwTerminate();
 
     getchar();
@@ -516,70 +471,7 @@ int main()
     return 0;
 }
 
-void ComputeNormals(ObjModel* model)
-{
-    if ( !model->attrib.normals.empty() )
-        return;
-
-    // Primeiro computamos as normais para todos os TRIÂNGULOS.
-    // Segundo, computamos as normais dos VÉRTICES através do método proposto
-    // por Gourad, onde a normal de cada vértice vai ser a média das normais de
-    // todas as faces que compartilham este vértice.
-
-    size_t num_vertices = model->attrib.vertices.size() / 3;
-
-    std::vector<int> num_triangles_per_vertex(num_vertices, 0);
-    std::vector<glm::vec4> vertex_normals(num_vertices, glm::vec4(0.0f,0.0f,0.0f,0.0f));
-
-    for (size_t shape = 0; shape < model->shapes.size(); ++shape)
-    {
-        size_t num_triangles = model->shapes[shape].mesh.num_face_vertices.size();
-
-        for (size_t triangle = 0; triangle < num_triangles; ++triangle)
-        {
-            assert(model->shapes[shape].mesh.num_face_vertices[triangle] == 3);
-
-            glm::vec4  vertices[3];
-            for (size_t vertex = 0; vertex < 3; ++vertex)
-            {
-                tinyobj::index_t idx = model->shapes[shape].mesh.indices[3*triangle + vertex];
-                const float vx = model->attrib.vertices[3*idx.vertex_index + 0];
-                const float vy = model->attrib.vertices[3*idx.vertex_index + 1];
-                const float vz = model->attrib.vertices[3*idx.vertex_index + 2];
-                vertices[vertex] = glm::vec4(vx,vy,vz,1.0);
-            }
-
-            const glm::vec4  a = vertices[0];
-            const glm::vec4  b = vertices[1];
-            const glm::vec4  c = vertices[2];
-
-            // PREENCHA AQUI o cálculo da normal de um triângulo cujos vértices
-            // estão nos pontos "a", "b", e "c", definidos no sentido anti-horário.
-            const glm::vec4  n = crossproduct(b-a, c-b);
-
-            for (size_t vertex = 0; vertex < 3; ++vertex)
-            {
-                tinyobj::index_t idx = model->shapes[shape].mesh.indices[3*triangle + vertex];
-                num_triangles_per_vertex[idx.vertex_index] += 1;
-                vertex_normals[idx.vertex_index] += n;
-                model->shapes[shape].mesh.indices[3*triangle + vertex].normal_index = idx.vertex_index;
-            }
-        }
-    }
-
-    model->attrib.normals.resize( 3*num_vertices );
-
-    for (size_t i = 0; i < vertex_normals.size(); ++i)
-    {
-        glm::vec4 n = vertex_normals[i] / (float)num_triangles_per_vertex[i];
-        n /= norm(n);
-        model->attrib.normals[3*i + 0] = n.x;
-        model->attrib.normals[3*i + 1] = n.y;
-        model->attrib.normals[3*i + 2] = n.z;
-    }
-}
-
-GLuint BuildCubo()
+IdObjeto BuildCubo()
 {
     GLuint vertex_array_object_id;
     glGenVertexArrays(1, &vertex_array_object_id);
@@ -685,9 +577,14 @@ GLuint BuildCubo()
     cube_faces.first_index    = (void*)0; // Primeiro índice está em indices[0]
     cube_faces.num_indices    = 36;       // Último índice está em indices[35]; total de 36 índices.
     cube_faces.rendering_mode = GL_TRIANGLES; // Índices correspondem ao tipo de rasterização GL_TRIANGLES.
+    cube_faces.index_type     = GL_UNSIGNED_INT;
+    cube_faces.material       = MATERIAL_GOURAUD;
+    cube_faces.bbox_min       = glm::vec3(-0.5f, -0.5f, -0.5f);
+    cube_faces.bbox_max       = glm::vec3( 0.5f,  0.5f,  0.5f);
+    cube_faces.vertex_array_object_id = vertex_array_object_id;
 
     // Adicionamos o objeto criado acima na nossa cena virtual (g_VirtualScene).
-    g_VirtualScene["cubo"] = cube_faces;
+    IdObjeto id = g_VirtualScene.adiciona("cubo", cube_faces);
 
     GLuint indices_id;
     glGenBuffers(1, &indices_id);
@@ -696,77 +593,54 @@ GLuint BuildCubo()
     glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, sizeof(indices), indices);
     glBindVertexArray(0);
 
-    return vertex_array_object_id;
+    return id;
 }
 
 
 
-GLuint BuildPista()
+// Asfalto: cada polígono convexo de Pista::getAreas() vira um leque de
+// triângulos, já em coordenadas do mundo e um pouco acima do chão.
+IdObjeto BuildPista(const Pista& pista)
 {
     GLuint vertex_array_object_id;
     glGenVertexArrays(1, &vertex_array_object_id);
     glBindVertexArray(vertex_array_object_id);
-    GLfloat model_coefficients[] =
-    {
-        // Vértices do chao
-        //    X      Y     Z     W
-        5.0f, 0.1f, 5.0f, 1.0f, // posição do vértice 1
-        9.0f, 0.1f, 5.0f,1.0f,
-        5.0f, 0.1f, -5.0f,1.0f,
-        9.0f, 0.1f, -5.0f,1.0f,
-        -5.0f, 0.1f, 5.0f, 1.0f, // posição do vértice 1
-        -9.0f, 0.1f, 5.0f,1.0f,
-        -5.0f, 0.1f, -5.0f,1.0f,
-        -9.0f, 0.1f, -5.0f,1.0f,
-        9.0f,0.1f,9.0f,1.0f,
-        -9.0f,0.1f,9.0f,1.0f,
-        9.0f,0.1f,-9.0f,1.0f,
-        -9.0f,0.1f,-9.0f,1.0f
-    };
 
-    GLfloat color_coefficients[]=
-    {
-        0.2f, 0.2f, 0.2f, 1.0f, // cor do vértice 1
-        0.2f, 0.2f, 0.2f, 1.0f, // cor do vértice 1 // cor do vértice 2
-        0.2f, 0.2f, 0.2f, 1.0f, // cor do vértice 1 // cor do vértice 3
-        0.2f, 0.2f, 0.2f, 1.0f, // cor do vértice 1
-        0.2f, 0.2f, 0.2f, 1.0f, // cor do vértice 1
-        0.2f, 0.2f, 0.2f, 1.0f, // cor do vértice 1 // cor do vértice 2
-        0.2f, 0.2f, 0.2f, 1.0f, // cor do vértice 1
-        0.2f, 0.2f, 0.2f, 1.0f,
-        0.2f, 0.2f, 0.2f, 1.0f,
-        0.2f, 0.2f, 0.2f, 1.0f, // cor do vértice 1
-        0.2f, 0.2f, 0.2f, 1.0f,
-        0.2f, 0.2f, 0.2f, 1.0f
-    };
+    std::vector<GLfloat> model_coefficients;
+    std::vector<GLfloat> color_coefficients;
+    std::vector<GLfloat> normal_coefficients;
+    std::vector<GLuint> indices;
+    glm::vec3 bbox_min( std::numeric_limits<float>::max());
+    glm::vec3 bbox_max(-std::numeric_limits<float>::max());
 
-    GLuint indices[]=
+    const std::vector< std::vector<glm::vec2> >& areas = pista.getAreas();
+    for (size_t i = 0; i < areas.size(); ++i)
     {
-        0,1,2,1,2,3,4,5,6,5,6,7,1,8,9,1,9,5,3,10,11,3,11,7
-
-    };
-
-    float normal_coefficients[]=
-    {
-        0,1,0,0,
-        0,1,0,0,
-        0,1,0,0,
-        0,1,0,0,
-        0,1,0,0,
-        0,1,0,0,
-        0,1,0,0,
-        0,1,0,0,
-        0,1,0,0,
-        0,1,0,0,
-        0,1,0,0,
-        0,1,0,0,
-    };
+        GLuint primeiro = (GLuint)(model_coefficients.size() / 4);
+        for (size_t j = 0; j < areas[i].size(); ++j)
+        {
+            GLfloat posicao[] = { areas[i][j].x, 0.1f, areas[i][j].y, 1.0f };
+            GLfloat cor[] = { 0.2f, 0.2f, 0.2f, 1.0f }; // Reconhecida pelo fragment shader para aplicar a textura
+            GLfloat normal[] = { 0.0f, 1.0f, 0.0f, 0.0f };
+            model_coefficients.insert(model_coefficients.end(), posicao, posicao + 4);
+            color_coefficients.insert(color_coefficients.end(), cor, cor + 4);
+            normal_coefficients.insert(normal_coefficients.end(), normal, normal + 4);
+            bbox_min = glm::min(bbox_min, glm::vec3(posicao[0], posicao[1], posicao[2]));
+            bbox_max = glm::max(bbox_max, glm::vec3(posicao[0], posicao[1], posicao[2]));
+        }
+        for (size_t j = 1; j + 1 < areas[i].size(); ++j)
+        {
+            indices.push_back(primeiro);
+            indices.push_back(primeiro + (GLuint)j);
+            indices.push_back(primeiro + (GLuint)j + 1);
+        }
+    }
 
     GLuint VBO_model_coefficients_id;
     glGenBuffers(1, &VBO_model_coefficients_id);
     glBindBuffer(GL_ARRAY_BUFFER, VBO_model_coefficients_id);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(model_coefficients), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(model_coefficients), model_coefficients);
+    glBufferData(GL_ARRAY_BUFFER, model_coefficients.size() * sizeof(GLfloat), NULL, GL_STATIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, model_coefficients.size() * sizeof(GLfloat), model_coefficients.data());
     GLuint location = 0; // "(location = 0)" em "shader_vertex.glsl"
     GLint  number_of_dimensions = 4; // vec4 em "shader_vertex.glsl"
     glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
@@ -776,8 +650,8 @@ GLuint BuildPista()
     GLuint VBO_color_coefficients_id;
     glGenBuffers(1, &VBO_color_coefficients_id);
     glBindBuffer(GL_ARRAY_BUFFER, VBO_color_coefficients_id);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(color_coefficients), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(color_coefficients), color_coefficients);
+    glBufferData(GL_ARRAY_BUFFER, color_coefficients.size() * sizeof(GLfloat), NULL, GL_STATIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, color_coefficients.size() * sizeof(GLfloat), color_coefficients.data());
     location = 1; // "(location = 1)" em "shader_vertex.glsl"
     number_of_dimensions = 4; // vec4 em "shader_vertex.glsl"
     glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
@@ -787,35 +661,40 @@ GLuint BuildPista()
     GLuint VBO_normal_coefficients_id;
     glGenBuffers(1, &VBO_normal_coefficients_id);
     glBindBuffer(GL_ARRAY_BUFFER, VBO_normal_coefficients_id);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(normal_coefficients), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(normal_coefficients), normal_coefficients);
+    glBufferData(GL_ARRAY_BUFFER, normal_coefficients.size() * sizeof(GLfloat), NULL, GL_STATIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, normal_coefficients.size() * sizeof(GLfloat), normal_coefficients.data());
     location = 2; // "(location = 2)" em "shader_vertex.glsl"
     number_of_dimensions = 4; // vec4 em "shader_vertex.glsl"
     glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
     glEnableVertexAttribArray(location);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-    SceneObject cube_faces;
-    cube_faces.name           = "Cubo (faces coloridas)";
-    cube_faces.first_index    = (void*)0; // Primeiro índice está em indices[0]
-    cube_faces.num_indices    = 24;       // Último índice está em indices[35]; total de 36 índices.
-    cube_faces.rendering_mode = GL_TRIANGLES; // Índices correspondem ao tipo de rasterização GL_TRIANGLES.
+    SceneObject asfalto;
+    asfalto.name           = "Asfalto da pista";
+    asfalto.first_index    = (void*)0; // Primeiro índice está em indices[0]
+    asfalto.num_indices    = indices.size();
+    asfalto.rendering_mode = GL_TRIANGLES; // Índices correspondem ao tipo de rasterização GL_TRIANGLES.
+    asfalto.index_type     = GL_UNSIGNED_INT;
+    asfalto.material       = MATERIAL_PHONG;
+    asfalto.bbox_min       = bbox_min;
+    asfalto.bbox_max       = bbox_max;
+    asfalto.vertex_array_object_id = vertex_array_object_id;
 
     // Adicionamos o objeto criado acima na nossa cena virtual (g_VirtualScene).
-    g_VirtualScene["pista"] = cube_faces;
+    IdObjeto id = g_VirtualScene.adiciona("pista", asfalto);
 
     GLuint indices_id;
     glGenBuffers(1, &indices_id);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices_id);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, sizeof(indices), indices);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), NULL, GL_STATIC_DRAW);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indices.size() * sizeof(GLuint), indices.data());
     glBindVertexArray(0);
 
-    return vertex_array_object_id;
+    return id;
 
 }
 
-GLuint BuildChao()
+IdObjeto BuildChao()
 {
     GLuint vertex_array_object_id;
     glGenVertexArrays(1, &vertex_array_object_id);
@@ -892,9 +771,14 @@ GLuint BuildChao()
     cube_faces.first_index    = (void*)0; // Primeiro índice está em indices[0]
     cube_faces.num_indices    = 6;       // Último índice está em indices[35]; total de 36 índices.
     cube_faces.rendering_mode = GL_TRIANGLES; // Índices correspondem ao tipo de rasterização GL_TRIANGLES.
+    cube_faces.index_type     = GL_UNSIGNED_INT;
+    cube_faces.material       = MATERIAL_PHONG;
+    cube_faces.bbox_min       = glm::vec3(-10.0f, 0.0f, -10.0f);
+    cube_faces.bbox_max       = glm::vec3( 10.0f, 0.0f,  10.0f);
+    cube_faces.vertex_array_object_id = vertex_array_object_id;
 
     // Adicionamos o objeto criado acima na nossa cena virtual (g_VirtualScene).
-    g_VirtualScene["chao"] = cube_faces;
+    IdObjeto id = g_VirtualScene.adiciona("chao", cube_faces);
 
     GLuint indices_id;
     glGenBuffers(1, &indices_id);
@@ -903,389 +787,34 @@ GLuint BuildChao()
     glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, sizeof(indices), indices);
     glBindVertexArray(0);
 
-    return vertex_array_object_id;
-
-}
-
-GLuint BuildCar()
-{
-
-    char* filename = "../../utilities/Car.obj";
-    ObjModel model(filename);
-
-    GLuint vertex_array_object_id;
-    glGenVertexArrays(1, &vertex_array_object_id);
-    glBindVertexArray(vertex_array_object_id);
-
-    std::vector<GLuint> indices;
-    std::vector<float>  model_coefficients;
-    std::vector<float>  normal_coefficients;
-    std::vector<float>  color_coefficients;
-
-    model.attrib.normals.clear();
-
-    ComputeNormals(&model);
-
-    for (size_t shape = 0; shape < model.shapes.size(); ++shape)
-    {
-        size_t first_index = indices.size();
-        size_t num_triangles = model.shapes[shape].mesh.num_face_vertices.size();
-
-        for (size_t triangle = 0; triangle < num_triangles; ++triangle)
-        {
-            assert(model.shapes[shape].mesh.num_face_vertices[triangle] == 3);
-
-            for (size_t vertex = 0; vertex < 3; ++vertex)
-            {
-                tinyobj::index_t idx = model.shapes[shape].mesh.indices[3*triangle + vertex];
-
-                indices.push_back(first_index + 3*triangle + vertex);
-
-                const float vx = model.attrib.vertices[3*idx.vertex_index + 0];
-                const float vy = model.attrib.vertices[3*idx.vertex_index + 1];
-                const float vz = model.attrib.vertices[3*idx.vertex_index + 2];
-                //printf("tri %d vert %d = (%.2f, %.2f, %.2f)\n", (int)triangle, (int)vertex, vx, vy, vz);
-                model_coefficients.push_back( vx ); // X
-                model_coefficients.push_back( vy ); // Y
-                model_coefficients.push_back( vz ); // Z
-                model_coefficients.push_back( 1.0f ); // W
-
-                // Inspecionando o código da tinyobjloader, o aluno Bernardo
-                // Sulzbach (2017/1) apontou que a maneira correta de testar se
-                // existem normais e coordenadas de textura no ObjModel é
-                // comparando se o índice retornado é -1. Fazemos isso abaixo.
-
-                if ( idx.normal_index != -1 )
-                {
-                    const float nx = model.attrib.normals[3*idx.normal_index + 0];
-                    const float ny = model.attrib.normals[3*idx.normal_index + 1];
-                    const float nz = model.attrib.normals[3*idx.normal_index + 2];
-                    normal_coefficients.push_back( nx ); // X
-                    normal_coefficients.push_back( ny ); // Y
-                    normal_coefficients.push_back( nz ); // Z
-                    normal_coefficients.push_back( 0.0f ); // W
-                }
-                color_coefficients.push_back(1);
-                color_coefficients.push_back(0);
-                color_coefficients.push_back(0);
-                color_coefficients.push_back(1);
-            }
-        }
-    }
-
-    cout << sizeof(indices) << endl;
-
-    GLuint VBO_model_coefficients_id;
-    glGenBuffers(1, &VBO_model_coefficients_id);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_model_coefficients_id);
-    glBufferData(GL_ARRAY_BUFFER, model_coefficients.size() * sizeof(float), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, model_coefficients.size() * sizeof(float), model_coefficients.data());
-    GLuint location = 0; // "(location = 0)" em "shader_vertex.glsl"
-    GLint  number_of_dimensions = 4; // vec4 em "shader_vertex.glsl"
-    glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(location);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-    GLuint VBO_color_coefficients_id;
-    glGenBuffers(1, &VBO_color_coefficients_id);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_color_coefficients_id);
-    glBufferData(GL_ARRAY_BUFFER, color_coefficients.size()*sizeof(float), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, color_coefficients.size()*sizeof(float), color_coefficients.data());
-    location = 1; // "(location = 1)" em "shader_vertex.glsl"
-    number_of_dimensions = 4; // vec4 em "shader_vertex.glsl"
-    glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(location);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-    GLuint VBO_normal_coefficients_id;
-    glGenBuffers(1, &VBO_normal_coefficients_id);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_normal_coefficients_id);
-    glBufferData(GL_ARRAY_BUFFER, normal_coefficients.size() * sizeof(float), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, normal_coefficients.size() * sizeof(float), normal_coefficients.data());
-    location = 2; // "(location = 2)" em "shader_vertex.glsl"
-    number_of_dimensions = 4; // vec4 em "shader_vertex.glsl"
-    glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(location);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-    SceneObject cube_faces;
-    cube_faces.name           = "Cubo (faces coloridas)";
-    cube_faces.first_index    = (void*)0; // Primeiro índice está em indices[0]
-    cube_faces.num_indices    = indices.size();       // Último índice está em indices[35]; total de 36 índices.
-    cube_faces.rendering_mode = GL_TRIANGLES; // Índices correspondem ao tipo de rasterização GL_TRIANGLES.
-
-// Adicionamos o objeto criado acima na nossa cena virtual (g_VirtualScene).
-    g_VirtualScene["carro"] = cube_faces;
-
-    GLuint indices_id;
-    glGenBuffers(1, &indices_id);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices_id);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size()*sizeof(GLuint), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indices.size()*sizeof(GLuint), indices.data());
-    glBindVertexArray(0);
-
-    return vertex_array_object_id;
-}
-
-GLuint BuildCow()
-{
-    char* filename = "../../utilities/cow.obj";
-    ObjModel model(filename);
-
-    GLuint vertex_array_object_id;
-    glGenVertexArrays(1, &vertex_array_object_id);
-    glBindVertexArray(vertex_array_object_id);
-
-    std::vector<GLuint> indices;
-    std::vector<float>  model_coefficients;
-    std::vector<float>  normal_coefficients;
-    std::vector<float>  color_coefficients;
-
-    ComputeNormals(&model);
-
-    for (size_t shape = 0; shape < model.shapes.size(); ++shape)
-    {
-        size_t first_index = indices.size();
-        size_t num_triangles = model.shapes[shape].mesh.num_face_vertices.size();
-
-        for (size_t triangle = 0; triangle < num_triangles; ++triangle)
-        {
-            assert(model.shapes[shape].mesh.num_face_vertices[triangle] == 3);
-
-            for (size_t vertex = 0; vertex < 3; ++vertex)
-            {
-                tinyobj::index_t idx = model.shapes[shape].mesh.indices[3*triangle + vertex];
-
-                indices.push_back(first_index + 3*triangle + vertex);
-
-                const float vx = model.attrib.vertices[3*idx.vertex_index + 0];
-                const float vy = model.attrib.vertices[3*idx.vertex_index + 1];
-                const float vz = model.attrib.vertices[3*idx.vertex_index + 2];
-                //printf("tri %d vert %d = (%.2f, %.2f, %.2f)\n", (int)triangle, (int)vertex, vx, vy, vz);
-                model_coefficients.push_back( vx ); // X
-                model_coefficients.push_back( vy ); // Y
-                model_coefficients.push_back( vz ); // Z
-                model_coefficients.push_back( 1.0f ); // W
-
-                // Inspecionando o código da tinyobjloader, o aluno Bernardo
-                // Sulzbach (2017/1) apontou que a maneira correta de testar se
-                // existem normais e coordenadas de textura no ObjModel é
-                // comparando se o índice retornado é -1. Fazemos isso abaixo.
-
-                if ( idx.normal_index != -1 )
-                {
-                    const float nx = model.attrib.normals[3*idx.normal_index + 0];
-                    const float ny = model.attrib.normals[3*idx.normal_index + 1];
-                    const float nz = model.attrib.normals[3*idx.normal_index + 2];
-                    normal_coefficients.push_back( nx ); // X
-                    normal_coefficients.push_back( ny ); // Y
-                    normal_coefficients.push_back( nz ); // Z
-                    normal_coefficients.push_back( 0.0f ); // W
-                }
-                color_coefficients.push_back(1);
-                color_coefficients.push_back(0);
-                color_coefficients.push_back(0);
-                color_coefficients.push_back(1);
-            }
-        }
-    }
-
-    GLuint VBO_model_coefficients_id;
-    glGenBuffers(1, &VBO_model_coefficients_id);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_model_coefficients_id);
-    glBufferData(GL_ARRAY_BUFFER, model_coefficients.size() * sizeof(float), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, model_coefficients.size() * sizeof(float), model_coefficients.data());
-    GLuint location = 0; // "(location = 0)" em "shader_vertex.glsl"
-    GLint  number_of_dimensions = 4; // vec4 em "shader_vertex.glsl"
-    glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(location);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-    GLuint VBO_color_coefficients_id;
-    glGenBuffers(1, &VBO_color_coefficients_id);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_color_coefficients_id);
-    glBufferData(GL_ARRAY_BUFFER, color_coefficients.size()*sizeof(float), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, color_coefficients.size()*sizeof(float), color_coefficients.data());
-    location = 1; // "(location = 1)" em "shader_vertex.glsl"
-    number_of_dimensions = 4; // vec4 em "shader_vertex.glsl"
-    glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(location);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-    GLuint VBO_normal_coefficients_id;
-    glGenBuffers(1, &VBO_normal_coefficients_id);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_normal_coefficients_id);
-    glBufferData(GL_ARRAY_BUFFER, normal_coefficients.size() * sizeof(float), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, normal_coefficients.size() * sizeof(float), normal_coefficients.data());
-    location = 2; // "(location = 2)" em "shader_vertex.glsl"
-    number_of_dimensions = 4; // vec4 em "shader_vertex.glsl"
-    glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(location);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-    SceneObject cube_faces;
-    cube_faces.name           = "Cubo (faces coloridas)";
-    cube_faces.first_index    = (void*)0; // Primeiro índice está em indices[0]
-    cube_faces.num_indices    = indices.size();       // Último índice está em indices[35]; total de 36 índices.
-    cube_faces.rendering_mode = GL_TRIANGLES; // Índices correspondem ao tipo de rasterização GL_TRIANGLES.
-
-// Adicionamos o objeto criado acima na nossa cena virtual (g_VirtualScene).
-    g_VirtualScene["cow"] = cube_faces;
-
-    GLuint indices_id;
-    glGenBuffers(1, &indices_id);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices_id);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size()*sizeof(GLuint), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indices.size()*sizeof(GLuint), indices.data());
-    glBindVertexArray(0);
-
-    return vertex_array_object_id;
-}
-
-// Carrega um Vertex Shader de um arquivo GLSL. Veja definição de LoadShader() abaixo.
-GLuint LoadShader_Vertex(const char* filename)
-{
-    // Criamos um identificador (ID) para este shader, informando que o mesmo
-    // será aplicado nos vértices.
-    GLuint vertex_shader_id = glCreateShader(GL_VERTEX_SHADER);
+    return id;
 
-    // Carregamos e compilamos o shader
-    LoadShader(filename, vertex_shader_id);
-
-    // Retorna o ID gerado acima
-    return vertex_shader_id;
 }
 
-// Carrega um Fragment Shader de um arquivo GLSL . Veja definição de LoadShader() abaixo.
-GLuint LoadShader_Fragment(const char* filename)
+IdObjeto BuildCar()
 {
-    // Criamos um identificador (ID) para este shader, informando que o mesmo
-    // será aplicado nos fragmentos.
-    GLuint fragment_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
-
-    // Carregamos e compilamos o shader
-    LoadShader(filename, fragment_shader_id);
-
-    // Retorna o ID gerado acima
-    return fragment_shader_id;
+    return g_Carregador.carregaMalha("../../utilities/Car.obj", "carro", true, VERTICE_COMPACTO);
 }
 
-// Função auxilar, utilizada pelas duas funções acima. Carrega código de GPU de
-// um arquivo GLSL e faz sua compilação.
-void LoadShader(const char* filename, GLuint shader_id)
+IdObjeto BuildCow()
 {
-    // Lemos o arquivo de texto indicado pela variável "filename"
-    // e colocamos seu conteúdo em memória, apontado pela variável
-    // "shader_string".
-    std::ifstream file;
-    try
-    {
-        file.exceptions(std::ifstream::failbit);
-        file.open(filename);
-    }
-    catch ( std::exception& e )
-    {
-        fprintf(stderr, "ERROR: Cannot open file \"%s\".\n", filename);
-        std::exit(EXIT_FAILURE);
-    }
-    std::stringstream shader;
-    shader << file.rdbuf();
-    std::string str = shader.str();
-    const GLchar* shader_string = str.c_str();
-    const GLint   shader_string_length = static_cast<GLint>( str.length() );
-
-    // Define o código do shader GLSL, contido na string "shader_string"
-    glShaderSource(shader_id, 1, &shader_string, &shader_string_length);
-
-    // Compila o código do shader GLSL (em tempo de execução)
-    glCompileShader(shader_id);
-
-    // Verificamos se ocorreu algum erro ou "warning" durante a compilação
-    GLint compiled_ok;
-    glGetShaderiv(shader_id, GL_COMPILE_STATUS, &compiled_ok);
-
-    GLint log_length = 0;
-    glGetShaderiv(shader_id, GL_INFO_LOG_LENGTH, &log_length);
-
-    // Alocamos memória para guardar o log de compilação.
-    // A chamada "new" em C++ é equivalente ao "malloc()" do C.
-    GLchar* log = new GLchar[log_length];
-    glGetShaderInfoLog(shader_id, log_length, &log_length, log);
-
-    // Imprime no terminal qualquer erro ou "warning" de compilação
-    if ( log_length != 0 )
-    {
-        std::string  output;
-
-        if ( !compiled_ok )
-        {
-            output += "ERROR: OpenGL compilation of \"";
-            output += filename;
-            output += "\" failed.\n";
-            output += "== Start of compilation log\n";
-            output += log;
-            output += "== End of compilation log\n";
-        }
-        else
-        {
-            output += "WARNING: OpenGL compilation of \"";
-            output += filename;
-            output += "\".\n";
-            output += "== Start of compilation log\n";
-            output += log;
-            output += "== End of compilation log\n";
-        }
-
-        fprintf(stderr, "%s", output.c_str());
-    }
-
-    // A chamada "delete" em C++ é equivalente ao "free()" do C
-    delete [] log;
+    return g_Carregador.carregaMalha("../../utilities/cow.obj", "cow", false, VERTICE_COMPACTO);
 }
 
-GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id)
+// Uniforms que não mudam durante o jogo. Chamada de novo quando o programa
+// é recarregado, porque o programa novo começa com todos os uniforms zerados.
+void ConfiguraPrograma(GLuint program_id, UniformesCamera* uniformes_camera)
 {
-    // Criamos um identificador (ID) para este programa de GPU
-    GLuint program_id = glCreateProgram();
-
-    // Definição dos dois shaders GLSL que devem ser executados pelo programa
-    glAttachShader(program_id, vertex_shader_id);
-    glAttachShader(program_id, fragment_shader_id);
-
-    // Linkagem dos shaders acima ao programa
-    glLinkProgram(program_id);
-
-    // Verificamos se ocorreu algum erro durante a linkagem
-    GLint linked_ok = GL_FALSE;
-    glGetProgramiv(program_id, GL_LINK_STATUS, &linked_ok);
+    GLint limites_pista_uniform = glGetUniformLocation(program_id, "limites_pista"); // Retângulo da textura do asfalto
 
-    // Imprime no terminal qualquer erro de linkagem
-    if ( linked_ok == GL_FALSE )
-    {
-        GLint log_length = 0;
-        glGetProgramiv(program_id, GL_INFO_LOG_LENGTH, &log_length);
-
-        // Alocamos memória para guardar o log de compilação.
-        // A chamada "new" em C++ é equivalente ao "malloc()" do C.
-        GLchar* log = new GLchar[log_length];
-
-        glGetProgramInfoLog(program_id, log_length, &log_length, log);
-
-        std::string output;
-
-        output += "ERROR: OpenGL linking of program failed.\n";
-        output += "== Start of link log\n";
-        output += log;
-        output += "\n== End of link log\n";
-
-        // A chamada "delete" em C++ é equivalente ao "free()" do C
-        delete [] log;
-
-        fprintf(stderr, "%s", output.c_str());
-    }
+    float pista_min_x, pista_min_z, pista_max_x, pista_max_z;
+    g_Pista.getLimites(&pista_min_x, &pista_min_z, &pista_max_x, &pista_max_z);
+    glUseProgram(program_id);
+    glUniform1i(glGetUniformLocation(program_id, "TextureImage0"), 0);
+    glUniform4f(limites_pista_uniform, pista_min_x, pista_min_z, pista_max_x, pista_max_z);
+    glUseProgram(0);
 
-    // Retornamos o ID gerado acima
-    return program_id;
+    uniformes_camera->associa(program_id);
 }
 
 void FramebufferSizeCallback(GLFWwindow* window, int width, int height)
@@ -1356,27 +885,48 @@ void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mod)
 
     float delta = 3.141592 / 16; // 22.5 graus, em radianos.
 
-    if (key == GLFW_KEY_W && (action == GLFW_PRESS || action == GLFW_REPEAT))
+    // O carro não é movido aqui: apenas registramos na simulação quais teclas
+    // estão pressionadas. GLFW_REPEAT é ignorado, pois a simulação repete a
+    // ação a cada passo enquanto a tecla não for solta.
+    if (key == GLFW_KEY_W && (action == GLFW_PRESS || action == GLFW_RELEASE))
     {
-        car.moveCarro(glfwGetTime());
+        g_Simulacao.enfileira(ACAO_ACELERAR, action == GLFW_PRESS);
     }
-    if (key == GLFW_KEY_S && (action == GLFW_PRESS || action == GLFW_REPEAT))
+    if (key == GLFW_KEY_S && (action == GLFW_PRESS || action == GLFW_RELEASE))
     {
-        car.moveCarBack();
+        g_Simulacao.enfileira(ACAO_RE, action == GLFW_PRESS);
     }
-    if (key == GLFW_KEY_A && (action == GLFW_PRESS || action == GLFW_REPEAT))
+    if (key == GLFW_KEY_A && (action == GLFW_PRESS || action == GLFW_RELEASE))
     {
-        car.turnLeft();
+        g_Simulacao.enfileira(ACAO_ESQUERDA, action == GLFW_PRESS);
     }
-    if (key == GLFW_KEY_D && (action == GLFW_PRESS || action == GLFW_REPEAT))
+    if (key == GLFW_KEY_D && (action == GLFW_PRESS || action == GLFW_RELEASE))
     {
-        car.turnRight();
+        g_Simulacao.enfileira(ACAO_DIREITA, action == GLFW_PRESS);
     }
 
     if (key == GLFW_KEY_C && action == GLFW_PRESS)
     {
         camera_lookat = !camera_lookat;
     }
+
+    // Tempos do quadro na tela e captura para o chrome://tracing
+    if (key == GLFW_KEY_P && action == GLFW_PRESS)
+    {
+        g_ShowProfiler = !g_ShowProfiler;
+    }
+    if (key == GLFW_KEY_T && action == GLFW_PRESS)
+    {
+        if (!g_Profiler.capturando())
+        {
+            g_Profiler.iniciaCaptura();
+            printf("Capturando trace... (T de novo para gravar)\n");
+        }
+        else if (g_Profiler.terminaCaptura("trace.json"))
+        {
+            printf("Trace gravado em \"trace.json\".\n");
+        }
+    }
     if (key == GLFW_KEY_UP && action == GLFW_PRESS)
     {
         camera_position_c += camera_view_vector;
@@ -1420,13 +970,21 @@ void TextRendering_ShowModelViewProjection(
 
     float pad = TextRendering_LineHeight(window);
 
-    TextRendering_PrintString(window, " Model matrix             Model     World", -1.0f, 1.0f-pad, 1.0f);
+    // Os títulos não mudam: ficam diagramados em VBOs próprios
+    TextMesh& titulo_model = g_TextosFixos.titulo_model;
+    TextMesh& titulo_view = g_TextosFixos.titulo_view;
+    TextMesh& titulo_projection = g_TextosFixos.titulo_projection;
+    titulo_model.setTexto(" Model matrix             Model     World");
+    titulo_view.setTexto(" View matrix              World     Camera");
+    titulo_projection.setTexto(" Projection matrix        Camera                   NDC");
+
+    titulo_model.desenha(window, -1.0f, 1.0f-pad);
     TextRendering_PrintMatrixVectorProduct(window, model, p_model, -1.0f, 1.0f-2*pad, 1.0f);
 
-    TextRendering_PrintString(window, " View matrix              World     Camera", -1.0f, 1.0f-7*pad, 1.0f);
+    titulo_view.desenha(window, -1.0f, 1.0f-7*pad);
     TextRendering_PrintMatrixVectorProduct(window, view, p_world, -1.0f, 1.0f-8*pad, 1.0f);
 
-    TextRendering_PrintString(window, " Projection matrix        Camera                   NDC", -1.0f, 1.0f-13*pad, 1.0f);
+    titulo_projection.desenha(window, -1.0f, 1.0f-13*pad);
     TextRendering_PrintMatrixVectorProductDivW(window, projection, p_camera, -1.0f, 1.0f-14*pad, 1.0f);
 }
 
@@ -1454,10 +1012,10 @@ void TextRendering_ShowProjection(GLFWwindow* window)
     float lineheight = TextRendering_LineHeight(window);
     float charwidth = TextRendering_CharWidth(window);
 
-    if ( g_UsePerspectiveProjection )
-        TextRendering_PrintString(window, "Perspective", 1.0f-13*charwidth, -1.0f+2*lineheight/10, 1.0f);
-    else
-        TextRendering_PrintString(window, "Orthographic", 1.0f-13*charwidth, -1.0f+2*lineheight/10, 1.0f);
+    // Só é diagramado de novo quando a projeção muda
+    TextMesh& nome_projecao = g_TextosFixos.nome_projecao;
+    nome_projecao.setTexto(g_UsePerspectiveProjection ? "Perspective" : "Orthographic");
+    nome_projecao.desenha(window, 1.0f-13*charwidth, -1.0f+2*lineheight/10);
 }
 
 // Escrevemos na tela o número de quadros renderizados por segundo (frames per
@@ -1495,3 +1053,47 @@ void TextRendering_ShowFramesPerSecond(GLFWwindow* window)
 
     TextRendering_PrintString(window, buffer, 1.0f-(numchars + 1)*charwidth, 1.0f-lineheight, 1.0f);
 }
+
+// Escrevemos na tela o tempo médio de cada escopo do Profiler, na CPU e na
+// GPU, e o tempo total do quadro.
+void TextRendering_ShowProfiler(GLFWwindow* window)
+{
+    if ( !g_ShowProfiler )
+        return;
+
+    float lineheight = TextRendering_LineHeight(window);
+    float charwidth = TextRendering_CharWidth(window);
+
+    // A coluna de nomes (e os títulos das colunas) só muda quando os escopos
+    // mudam; fica em um TextMesh, que só é diagramado de novo quando o texto
+    // for diferente, e só os números são diagramados a cada quadro.
+    TextMesh& nomes = g_TextosFixos.nomes_profiler;
+    const std::vector<LinhaProfiler>& linhas = g_Profiler.getLinhas();
+    std::string texto = "Quadro        ms     CPU      GPU";
+    for (size_t i = 0; i < linhas.size(); ++i)
+        texto += "\n" + std::string(2*linhas[i].profundidade, ' ') + linhas[i].nome;
+    nomes.setTexto(texto);
+    nomes.desenha(window, -1.0f+charwidth, 1.0f-lineheight);
+
+    // Os números começam na coluna 7 (quadro) e na coluna 19 (escopos)
+    char buffer[80];
+    snprintf(buffer, 80, "%6.2f", g_Profiler.getQuadroMs());
+    TextRendering_PrintString(window, buffer, -1.0f+8*charwidth, 1.0f-lineheight, 1.0f);
+
+    for (size_t i = 0; i < linhas.size(); ++i)
+    {
+        char gpu[16] = "      -";
+        if (linhas[i].gpu_ms >= 0.0)
+            snprintf(gpu, 16, "%7.3f", linhas[i].gpu_ms);
+        snprintf(buffer, 80, "%7.3f  %s", linhas[i].cpu_ms, gpu);
+        TextRendering_PrintString(window, buffer, -1.0f+20*charwidth, 1.0f-(i+2)*lineheight, 1.0f);
+    }
+
+    const ContadoresFila& fila = g_FilaRender.getContadores();
+    snprintf(buffer, 80, "Fila: %u itens, %u descartados, %u desenhos, %u triangulos",
+             fila.itens, fila.descartados, fila.desenhos, fila.triangulos);
+    TextRendering_PrintString(window, buffer, -1.0f+charwidth, 1.0f-(linhas.size()+2)*lineheight, 1.0f);
+    snprintf(buffer, 80, "Trocas: %u programas, %u VAOs, %u uniforms, %u evitadas",
+             fila.trocas_programa, fila.trocas_vao, fila.trocas_uniform, fila.evitadas);
+    TextRendering_PrintString(window, buffer, -1.0f+charwidth, 1.0f-(linhas.size()+3)*lineheight, 1.0f);
+}
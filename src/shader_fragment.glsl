@@ -9,9 +9,20 @@ in vec4 position_world;
 in vec4 normal;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+// Dados da câmera, iguais para todos os objetos do quadro: vêm de um uniform
+// buffer object compartilhado por todos os programas (veja BlocoCamera em
+// "UniformesCamera.h"). A posição da câmera já vem calculada, sem inverse(view).
+layout (std140) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    mat4 view_projection;
+    vec4 posicao_camera;
+};
+
 uniform int isGourard;
+uniform vec4 limites_pista; // (min x, min z, max x, max z) da pista, ver Pista::getLimites
 
 // O valor de saída ("out") de um Fragment Shader é a cor final do fragmento.
 out vec4 color;
@@ -20,8 +31,7 @@ uniform sampler2D TextureImage;
 
 void main()
 {
-    vec4 origin = vec4(0.0, 0.0, 0.0, 1.0);
-    vec4 camera_position = inverse(view) * origin;
+    vec4 camera_position = posicao_camera;
 
     vec4 p = position_world;
 
@@ -40,14 +50,11 @@ void main()
 
     if(isGourard == 0){
     if(cor_interpolada_pelo_rasterizador == vec4(0.2,0.2,0.2,1.0)){
-        float minx = -9;
-        float maxx = 9;
-
-        float miny = 0.1;
-        float maxy = 0.1;
+        float minx = limites_pista.x;
+        float maxx = limites_pista.z;
 
-        float minz = -4;
-        float maxz = 14;
+        float minz = limites_pista.y;
+        float maxz = limites_pista.w;
 
         float U =(p[0] -minx)/(maxx-minx);
         float V =(p[2] -minz)/(maxz-minz);
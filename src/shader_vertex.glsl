@@ -6,11 +6,37 @@ layout (location = 0) in vec4 model_coefficients;
 layout (location = 1) in vec4 color_coefficients;
 layout (location = 2) in vec4 normal_coefficients;
 
+// As malhas carregadas por BuildMalha() usam um VBO intercalado, em float ou
+// compacto (ver FormatoVertice em "Malha.h"): posio vec3 float, cor RGBA8 e
+// normal GL_INT_2_10_10_10_REV, ambas normalizadas. Nos dois casos os
+// atributos chegam aqui como vec4: o OpenGL completa a posio com w = 1 e
+// converte a cor e a normal compactas para float em [0,1] e [-1,1].
+
+// Atributos por instncia, usados quando usaInstancias == 1 (veja
+// LoteInstancias em "Instancias.cpp"): a matriz "model" de cada cpia do
+// objeto ocupa as locations 3 a 6, a cor que multiplica a dos vrtices, a 7,
+// e a matriz das normais, as locations 8 a 10.
+layout (location = 3) in mat4 instancia_model;
+layout (location = 7) in vec4 instancia_cor;
+layout (location = 8) in mat3 instancia_normal_matrix;
+
 // Matrizes computadas no cdigo C++ e enviadas para a GPU
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+uniform mat3 normal_matrix; // Calculada uma vez por objeto, ver MatrizNormal()
+
+// Dados da cmera, iguais para todos os objetos do quadro: vm de um uniform
+// buffer object compartilhado por todos os programas (veja BlocoCamera em
+// "UniformesCamera.h"). A posio da cmera j vem calculada, sem inverse(view).
+layout (std140) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    mat4 view_projection;
+    vec4 posicao_camera;
+};
+
 uniform int isGourard;
+uniform int usaInstancias;
 
 // Atributos de vrtice que sero gerados como sada ("out") pelo Vertex Shader.
 // ** Estes sero interpolados pelo rasterizador! ** gerando, assim, valores
@@ -23,16 +49,23 @@ out vec4 cor_interpolada_pelo_rasterizador;
 void main()
 {
 
-    gl_Position = projection * view * model * model_coefficients;
-    position_world = model * model_coefficients;
-    normal = inverse(transpose(model)) * normal_coefficients;
-    normal.w = 0.0;
+    mat4 M = model;
+    mat3 N = normal_matrix;
+    vec4 cor = color_coefficients;
+    if(usaInstancias == 1){
+        M = instancia_model;
+        N = instancia_normal_matrix;
+        cor = color_coefficients * instancia_cor;
+    }
+
+    position_world = M * model_coefficients;
+    gl_Position = view_projection * position_world;
+    normal = vec4(N * normal_coefficients.xyz, 0.0);
 
     //gourard = isGourard;
 
     if(isGourard == 1){
-        vec4 origin = vec4(0.0, 0.0, 0.0, 1.0);
-        vec4 camera_position = inverse(view) * origin;
+        vec4 camera_position = posicao_camera;
 
         vec4 p = position_world;
 
@@ -44,7 +77,7 @@ void main()
 
         vec4 r = normalize(2*dot(n,l)*n-l);
 
-        vec4 Kd = color_coefficients;
+        vec4 Kd = cor;
         vec4 Ks = vec4(0.8,0.8,0.8,0);
         float q = 32.0;
 
@@ -57,6 +90,6 @@ void main()
 
         cor_interpolada_pelo_rasterizador = color;
     }else{
-        cor_interpolada_pelo_rasterizador = color_coefficients;
+        cor_interpolada_pelo_rasterizador = cor;
     }
 }
@@ -1,6 +1,7 @@
 // Based on http://hamelot.io/visualization/opengl-text-without-any-external-libraries/
 //   and on https://github.com/rougier/freetype-gl
 #include <string>
+#include <vector>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -10,16 +11,17 @@
 
 #include "utils.h"
 #include "dejavufont.h"
-
-GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id); // Função definida em main.cpp
+#include "TextMesh.h"
+#include "CacheProgramas.h"
 
 const GLchar* const textvertexshader_source = ""
 "#version 330\n"
 "layout (location = 0) in vec4 position;\n"
+"uniform vec2 offset;\n"
 "out vec2 texCoords;\n"
 "void main()\n"
 "{\n"
-    "gl_Position = vec4(position.xy, 0, 1);\n"
+    "gl_Position = vec4(position.xy + offset, 0, 1);\n"
     "texCoords = position.zw;\n"
 "}\n"
 "\0";
@@ -35,58 +37,38 @@ const GLchar* const textfragmentshader_source = ""
 "}\n"
 "\0";
 
-void TextRendering_LoadShader(const GLchar* const shader_string, GLuint shader_id)
-{
-    // Define o código do shader, contido na string "shader_string"
-    glShaderSource(shader_id, 1, &shader_string, NULL);
-
-    // Compila o código do shader (em tempo de execução)
-    glCompileShader(shader_id);
+GLuint textVAO;
+GLuint textVBO;
+GLuint textprogram_id;
+GLuint texttexture_id;
+GLint textoffset_uniform; // Deslocamento do texto em NDC, usado por TextMesh
 
-    // Verificamos se ocorreu algum erro ou "warning" durante a compilação
-    GLint compiled_ok;
-    glGetShaderiv(shader_id, GL_COMPILE_STATUS, &compiled_ok);
+// O texto de um quadro inteiro é acumulado em textvertices (x, y, s, t por
+// vértice, seis vértices por caractere) e desenhado com uma única chamada em
+// TextRendering_Flush(). O VBO só cresce.
+std::vector<float> textvertices;
+size_t textvbo_capacity = 0; // Em bytes
 
-    GLint log_length = 0;
-    glGetShaderiv(shader_id, GL_INFO_LOG_LENGTH, &log_length);
+// Glifo de cada caractere ASCII, indexado pelo código, em vez de uma busca
+// linear em dejavufont.glyphs por caractere impresso.
+texture_glyph_t* textglyphs[128];
 
-    // Alocamos memória para guardar o log de compilação.
-    // A chamada "new" em C++ é equivalente ao "malloc()" do C.
-    GLchar* log = new GLchar[log_length];
-    glGetShaderInfoLog(shader_id, log_length, &log_length, log);
+// Tamanho da janela, lido uma vez por quadro: glfwGetWindowSize() pode
+// precisar de uma ida e volta ao servidor gráfico.
+GLFWwindow* textwindow = NULL;
+int textwindow_width, textwindow_height;
 
-    // Imprime no terminal qualquer erro ou "warning" de compilação
-    if ( log_length != 0 )
+static void TextRendering_WindowSize(GLFWwindow* window, int* width, int* height)
+{
+    if (window != textwindow)
     {
-        std::string  output;
-
-        if ( !compiled_ok )
-        {
-            output += "ERROR: OpenGL compilation failed.\n";
-            output += "== Start of compilation log\n";
-            output += log;
-            output += "== End of compilation log\n";
-        }
-        else
-        {
-            output += "ERROR: OpenGL compilation failed.\n";
-            output += "== Start of compilation log\n";
-            output += log;
-            output += "== End of compilation log\n";
-        }
-
-        fprintf(stderr, "%s", output.c_str());
+        glfwGetWindowSize(window, &textwindow_width, &textwindow_height);
+        textwindow = window;
     }
-
-    // A chamada "delete" em C++ é equivalente ao "free()" do C
-    delete [] log;
+    *width = textwindow_width;
+    *height = textwindow_height;
 }
 
-GLuint textVAO;
-GLuint textVBO;
-GLuint textprogram_id;
-GLuint texttexture_id;
-
 void TextRendering_Init()
 {
     GLuint sampler;
@@ -101,38 +83,32 @@ void TextRendering_Init()
     glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glCheckError();
 
-    GLuint textvertexshader_id = glCreateShader(GL_VERTEX_SHADER);
-    TextRendering_LoadShader(textvertexshader_source, textvertexshader_id);
-    glCheckError();
-
-    GLuint textfragmentshader_id = glCreateShader(GL_FRAGMENT_SHADER);
-    TextRendering_LoadShader(textfragmentshader_source, textfragmentshader_id);
-    glCheckError();
-
-    textprogram_id = CreateGpuProgram(textvertexshader_id, textfragmentshader_id);
-    glLinkProgram(textprogram_id);
+    textprogram_id = g_CacheProgramas.cria("texto", textvertexshader_source, textfragmentshader_source);
     glCheckError();
 
     GLuint texttex_uniform;
     texttex_uniform = glGetUniformLocation(textprogram_id, "tex");
+    textoffset_uniform = glGetUniformLocation(textprogram_id, "offset");
     glCheckError();
 
-    glActiveTexture(GL_TEXTURE0);
+    // A fonte usa a unidade de textura 1: a unidade 0 é a do asfalto (ver
+    // carregaTextura() em main.cpp).
+    glActiveTexture(GL_TEXTURE1);
     glBindTexture(GL_TEXTURE_2D, texttexture_id);
     glTexImage2D( GL_TEXTURE_2D, 0, GL_R8, dejavufont.tex_width, dejavufont.tex_height, 0, GL_RED, GL_UNSIGNED_BYTE, dejavufont.tex_data);
-    glBindSampler(0, sampler);
+    glBindSampler(1, sampler);
+    glActiveTexture(GL_TEXTURE0);
     glCheckError();
 
     glBindVertexArray(textVAO);
 
     glBindBuffer(GL_ARRAY_BUFFER, textVBO);
-    glBufferData(GL_ARRAY_BUFFER, 24 * sizeof(float), NULL, GL_DYNAMIC_DRAW);
     glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, 0);
     glEnableVertexAttribArray(0);
     glCheckError();
 
     glUseProgram(textprogram_id);
-    glUniform1i(texttex_uniform, 0);
+    glUniform1i(texttex_uniform, 1);
     glUseProgram(0);
     glCheckError();
 
@@ -142,30 +118,43 @@ void TextRendering_Init()
 
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    for (size_t c = 0; c < 128; ++c)
+        textglyphs[c] = NULL;
+    for (size_t j = dejavufont.glyphs_count; j-- > 0; )
+    {
+        if (dejavufont.glyphs[j].codepoint < 128)
+            textglyphs[dejavufont.glyphs[j].codepoint] = &dejavufont.glyphs[j];
+    }
 }
 
 float textscale = 1.5f;
 
-void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float x, float y, float scale = 1.0f)
+// Gera seis vértices (x, y, s, t) por caractere de "str" no fim de
+// "vertices". Uma quebra de linha volta para x e desce uma linha.
+static void TextRendering_Layout(GLFWwindow* window, const std::string &str, float x, float y, float scale, std::vector<float>* vertices)
 {
     scale *= textscale;
     int width, height;
-    glfwGetWindowSize(window, &width, &height);
+    TextRendering_WindowSize(window, &width, &height);
     float sx = scale / width;
     float sy = scale / height;
+    const float x_inicial = x;
+
+    vertices->reserve(vertices->size() + 24 * str.size());
 
     for (size_t i = 0; i < str.size(); i++)
     {
-        // Find the glyph for the character we are looking for
-        texture_glyph_t *glyph = 0;
-        for (size_t j = 0; j < dejavufont.glyphs_count; ++j)
+        if (str[i] == '\n')
         {
-            if (dejavufont.glyphs[j].codepoint == (uint32_t)str[i])
-            {
-                glyph = &dejavufont.glyphs[j];
-                break;
-            }
+            x = x_inicial;
+            y -= dejavufont.height * sy;
+            continue;
         }
+
+        // Caracteres fora do ASCII não têm glifo na fonte
+        unsigned char c = (unsigned char)str[i];
+        texture_glyph_t *glyph = c < 128 ? textglyphs[c] : 0;
         if (!glyph) {
             continue;
         }
@@ -180,47 +169,170 @@ void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float
         float s1 = glyph->s1 - 0.5f/dejavufont.tex_width;
         float t1 = glyph->t1 - 0.5f/dejavufont.tex_height;
 
-        struct {float x, y, s, t;} data[6] = {
-            { x0, y0, s0, t0 },
-            { x0, y1, s0, t1 },
-            { x1, y1, s1, t1 },
-            { x0, y0, s0, t0 },
-            { x1, y1, s1, t1 },
-            { x1, y0, s1, t0 }
+        const float data[24] = {
+            x0, y0, s0, t0,
+            x0, y1, s0, t1,
+            x1, y1, s1, t1,
+            x0, y0, s0, t0,
+            x1, y1, s1, t1,
+            x1, y0, s1, t0
         };
+        vertices->insert(vertices->end(), data, data + 24);
 
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-        glDepthFunc(GL_ALWAYS);
-        glBindBuffer(GL_ARRAY_BUFFER, textVBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, 24 * sizeof(float), data);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        x += (glyph->advance_x * sx);
+    }
+}
+
+// Só acumula os quadriláteros dos caracteres; eles aparecem na tela na
+// próxima chamada de TextRendering_Flush().
+void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float x, float y, float scale = 1.0f)
+{
+    TextRendering_Layout(window, str, x, y, scale, &textvertices);
+}
 
-        glUseProgram(textprogram_id);
-        glBindVertexArray(textVAO);
-        glBindTexture(GL_TEXTURE_2D, texttexture_id);
+// Desenha todo o texto acumulado desde a última chamada, com um único
+// glDrawArrays(). Deve ser chamada uma vez por quadro, depois de todos os
+// TextRendering_Print*().
+void TextRendering_Flush()
+{
+    // O tamanho da janela pode mudar até o próximo quadro
+    textwindow = NULL;
 
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+    if (textvertices.empty())
+        return;
 
+    // O armazenamento é realocado a cada quadro ("orphaning"), para não
+    // esperar a GPU terminar de ler o texto do quadro anterior.
+    size_t bytes = textvertices.size() * sizeof(float);
+    if (bytes > textvbo_capacity)
+        textvbo_capacity = bytes;
+
+    glBindBuffer(GL_ARRAY_BUFFER, textVBO);
+    glBufferData(GL_ARRAY_BUFFER, textvbo_capacity, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, textvertices.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glDepthFunc(GL_ALWAYS);
+    glUseProgram(textprogram_id);
+    glUniform2f(textoffset_uniform, 0.0f, 0.0f);
+    glBindVertexArray(textVAO);
+
+    glDrawArrays(GL_TRIANGLES, 0, (GLsizei)(textvertices.size() / 4));
+
+    glBindVertexArray(0);
+    glUseProgram(0);
+    glDepthFunc(GL_LESS);
+
+    textvertices.clear();
+}
+
+TextMesh::TextMesh()
+{
+    escala = 1.0f;
+    valida = false;
+    largura_janela = altura_janela = 0;
+    vertex_array_object_id = 0;
+    VBO_id = 0;
+    num_vertices = 0;
+}
+
+TextMesh::~TextMesh()
+{
+    libera();
+}
+
+void TextMesh::libera()
+{
+    if (vertex_array_object_id != 0)
+    {
+        glDeleteVertexArrays(1, &vertex_array_object_id);
+        glDeleteBuffers(1, &VBO_id);
+    }
+    vertex_array_object_id = 0;
+    VBO_id = 0;
+    num_vertices = 0;
+    valida = false;
+}
+
+void TextMesh::setTexto(const std::string& novo_texto, float scale)
+{
+    if (novo_texto == texto && scale == escala)
+        return;
+
+    texto = novo_texto;
+    escala = scale;
+    valida = false;
+}
+
+const std::string& TextMesh::getTexto() const
+{
+    return texto;
+}
+
+// Diagrama a partir da origem; a posição na tela vem do uniform "offset".
+void TextMesh::diagrama(GLFWwindow* window)
+{
+    std::vector<float> vertices;
+    TextRendering_Layout(window, texto, 0.0f, 0.0f, escala, &vertices);
+
+    if (vertex_array_object_id == 0)
+    {
+        glGenVertexArrays(1, &vertex_array_object_id);
+        glGenBuffers(1, &VBO_id);
+        glBindVertexArray(vertex_array_object_id);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO_id);
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, 0);
+        glEnableVertexAttribArray(0);
         glBindVertexArray(0);
-        glBindTexture(GL_TEXTURE_2D, 0);
-        glUseProgram(0);
-        glDepthFunc(GL_LESS);
+    }
 
-        x += (glyph->advance_x * sx);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO_id);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    num_vertices = (GLsizei)(vertices.size() / 4);
+    valida = true;
+}
+
+void TextMesh::desenha(GLFWwindow* window, float x, float y)
+{
+    int width, height;
+    TextRendering_WindowSize(window, &width, &height);
+    if (!valida || width != largura_janela || height != altura_janela)
+    {
+        largura_janela = width;
+        altura_janela = height;
+        diagrama(window);
     }
+
+    if (num_vertices == 0)
+        return;
+
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glDepthFunc(GL_ALWAYS);
+    glUseProgram(textprogram_id);
+    glUniform2f(textoffset_uniform, x, y);
+    glBindVertexArray(vertex_array_object_id);
+
+    glDrawArrays(GL_TRIANGLES, 0, num_vertices);
+
+    glBindVertexArray(0);
+    glUseProgram(0);
+    glDepthFunc(GL_LESS);
 }
 
 float TextRendering_LineHeight(GLFWwindow* window)
 {
     int width, height;
-    glfwGetWindowSize(window, &width, &height);
+    TextRendering_WindowSize(window, &width, &height);
     return dejavufont.height / height * textscale;
 }
 
 float TextRendering_CharWidth(GLFWwindow* window)
 {
     int width, height;
-    glfwGetWindowSize(window, &width, &height);
+    TextRendering_WindowSize(window, &width, &height);
     return dejavufont.glyphs[32].advance_x / width * textscale;
 }
 